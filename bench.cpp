@@ -0,0 +1,277 @@
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <chrono>
+#include <algorithm>
+
+#include "src/wkq.h"
+#include "src/State_t.h"
+#include "src/Leg.h"
+
+/*
+ * main() for micro-benchmarking the kinematics entry points on the host
+ *
+ * To compile run $ make bin/bench 		- builds bin/bench (2 DOF) and bin/bench_dof3
+ * 				  $ make bin/bench LEG_BATCH=1 	- adds the LegBatch row and the error of the batch kernel
+ *
+ * "LegBatch x6" times the batch of a gait half cycle. Without IK_TABLES that is the single precision
+ * polynomial kernel, the same code as on the mbed apart from arm_sqrt_f32(). Its maximum error against
+ * configureAngles() without the batch is reported over the reachable range of the leg
+ *
+ * Every entry point is timed over BENCH_SAMPLES samples of BENCH_OPS calls each, after BENCH_WARMUP untimed calls.
+ * The state is restored before every call (Leg::copyState(), State_t::operator=, Point copy) so each call does the
+ * same work. The restore is timed on its own in the same way and its median is subtracted from the reported median
+ * and minimum alike, so the minimum never exceeds the median
+ *
+ * Reported per entry point:
+ * 	- median ns/op over the samples, minimum ns/op and the median absolute deviation (MAD) as a spread measure
+ * 	- calls per op of each libm transcendental function. The calls are counted by wrapping the libm symbols at link
+ * 	  time (-Wl,--wrap) and the bench is compiled with -fno-builtin so that no call is inlined away - same as on the
+ * 	  Cortex-M3 where every one of them is a library call
+ *
+ */
+
+const int BENCH_WARMUP 		= 1000;
+const int BENCH_SAMPLES 	= 31;
+const int BENCH_OPS 		= 2000;
+
+
+/* ================================================= CALL COUNTING ================================================= */
+
+enum MathFn{ FN_SQRT, FN_SIN, FN_COS, FN_ASIN, FN_ACOS, FN_ATAN, FN_ATAN2, FN_POW, FN_COUNT };
+const char* fn_names[FN_COUNT] = { "sqrt", "sin", "cos", "asin", "acos", "atan", "atan2", "pow" };
+
+static unsigned long fn_calls[FN_COUNT];
+
+// double and float versions of each function are counted together
+#define BENCH_WRAP_1(name, fn) \
+	double __real_##name(double); \
+	float __real_##name##f(float); \
+	double __wrap_##name(double x){ fn_calls[fn]++; return __real_##name(x); } \
+	float __wrap_##name##f(float x){ fn_calls[fn]++; return __real_##name##f(x); }
+
+#define BENCH_WRAP_2(name, fn) \
+	double __real_##name(double, double); \
+	float __real_##name##f(float, float); \
+	double __wrap_##name(double x, double y){ fn_calls[fn]++; return __real_##name(x, y); } \
+	float __wrap_##name##f(float x, float y){ fn_calls[fn]++; return __real_##name##f(x, y); }
+
+extern "C" {
+	BENCH_WRAP_1(sqrt, FN_SQRT)
+	BENCH_WRAP_1(sin, FN_SIN)
+	BENCH_WRAP_1(cos, FN_COS)
+	BENCH_WRAP_1(asin, FN_ASIN)
+	BENCH_WRAP_1(acos, FN_ACOS)
+	BENCH_WRAP_1(atan, FN_ATAN)
+	BENCH_WRAP_2(atan2, FN_ATAN2)
+	BENCH_WRAP_2(pow, FN_POW)
+}
+
+
+/* ================================================= TIMING ================================================= */
+
+struct BenchResult{
+	double median;
+	double min;
+	double mad;
+	double calls[FN_COUNT];
+};
+
+double median(double* values, int count){
+	std::sort(values, values + count);
+	return values[count/2];
+}
+
+/*  @ Notes:
+	op() is preceded by restore() on every call. Returns the statistics of the ns per (restore + op) and the libm calls
+	per (restore + op); the caller subtracts the restore-only numbers
+*/
+template<typename Op, typename Restore>
+BenchResult measure(Op op, Restore restore){
+	BenchResult result;
+	double samples[BENCH_SAMPLES];
+	double deviations[BENCH_SAMPLES];
+
+	for(int i=0; i<BENCH_WARMUP; i++){
+		restore();
+		op();
+	}
+
+	memset(fn_calls, 0, sizeof(fn_calls));
+	for(int s=0; s<BENCH_SAMPLES; s++){
+		auto start = std::chrono::steady_clock::now();
+		for(int i=0; i<BENCH_OPS; i++){
+			restore();
+			op();
+		}
+		auto end = std::chrono::steady_clock::now();
+		samples[s] = std::chrono::duration<double, std::nano>(end - start).count() / BENCH_OPS;
+	}
+	for(int f=0; f<FN_COUNT; f++) result.calls[f] = fn_calls[f] / (double)(BENCH_SAMPLES * BENCH_OPS);
+
+	result.median = median(samples, BENCH_SAMPLES);
+	result.min = samples[0];
+	for(int s=0; s<BENCH_SAMPLES; s++) deviations[s] = fabs(samples[s] - result.median);
+	result.mad = median(deviations, BENCH_SAMPLES);
+	return result;
+}
+
+template<typename Op, typename Restore>
+void bench(const char* name, Op op, Restore restore){
+	BenchResult overhead = measure([](){}, restore);
+	BenchResult result = measure(op, restore);
+
+	printf("%-32s %10.1f %10.1f %8.1f  ", name, result.median - overhead.median, result.min - overhead.median, result.mad);
+	for(int f=0; f<FN_COUNT; f++){
+		double calls = result.calls[f] - overhead.calls[f];
+		if(calls > 0.0) printf(" %s:%.2f", fn_names[f], calls);
+	}
+	printf("\n\r");
+}
+
+
+#ifdef LEG_BATCH
+/*  @ Notes:
+	Sweeps the leg over its reachable range at the height of state_ref. The setters solve every position without a
+	batch, then the same position is solved again through the LegBatch kernel. The error is reported for the inner
+	98% of the range and for all of it: at the ends the leg is fully stretched or folded, the slope of acos() goes to
+	infinity and the rounding of the float inputs dominates
+*/
+void batchError(const State_t& state_ref){
+	const int steps = 100000;
+	State_t state = state_ref;
+	double max_knee[2] = { 0.0, 0.0 }, max_hip[2] = { 0.0, 0.0 }; 		// inner range, whole range
+
+#ifdef DOF3
+	double lo = std::max((double)state_ref.vars.height, fabs(state_ref.params.FEMUR - state_ref.params.TIBIA));
+	double hi = state_ref.params.FEMUR + state_ref.params.TIBIA;
+#else
+	double lo = state_ref.params.FEMUR - state_ref.params.TIBIA;
+	double hi = state_ref.params.FEMUR + state_ref.params.TIBIA;
+#endif
+	for(int i=0; i<=steps; i++){
+		double dist = lo + (hi - lo)*i/steps;
+#ifdef DOF3
+		state.setHipToEnd(dist);
+#else
+		state.setHipGroundToEf(dist, dist*dist);
+#endif
+		LegAngles exact = state.servo_angles;
+		State_t::beginBatch();
+		state.configureAngles();
+		State_t::endBatch();
+		bool inner = (i >= steps/100 && i <= steps - steps/100);
+		for(int r = inner ? 0 : 1; r<2; r++){
+			max_knee[r] = std::max(max_knee[r], fabs((double)(state.servo_angles.knee - exact.knee)));
+#ifdef DOF3
+			max_hip[r] = std::max(max_hip[r], fabs((double)(state.servo_angles.hip - exact.hip)));
+#endif
+		}
+	}
+	printf("LegBatch max error, inner 98%% of the range: knee %.2e rad, hip %.2e rad\n\r", max_knee[0], max_hip[0]);
+	printf("LegBatch max error, whole range: knee %.2e rad, hip %.2e rad\n\r", max_knee[1], max_hip[1]);
+}
+#endif
+
+
+int main(){
+
+	BodyParams robot_params;
+	static ServoMap servo_map;
+	double init_height;
+
+	// Same parameters as simulation.cpp
+#ifdef DOF3
+	robot_params.DIST_CENTER 		= 10.95;
+	robot_params.COXA 				= 2.65;
+	robot_params.FEMUR 				= 17.1;
+	robot_params.TIBIA 				= 30;
+	robot_params.KNEE_TO_MOTOR_DIST = 2.6;
+	robot_params.MIN_HEIGHT = robot_params.TIBIA - robot_params.FEMUR*sin(wkq::radians(70));
+	robot_params.MAX_HEIGHT = robot_params.FEMUR*sin(wkq::radians(70)) + robot_params.TIBIA;
+	init_height 	= 15.0;
+	printf("Kinematics micro-benchmarks: DOF3\n\r");
+#else
+	robot_params.DIST_CENTER = 10.95 + 2.15;
+	robot_params.FEMUR = 17.1;
+	robot_params.TIBIA = 12 + 1.85;
+	robot_params.KNEE_TO_MOTOR_DIST = 2.6;
+	robot_params.MIN_HEIGHT = robot_params.TIBIA*cos(wkq::radians(60));
+	robot_params.MAX_HEIGHT = robot_params.TIBIA;
+	init_height 	= robot_params.TIBIA;
+	printf("Kinematics micro-benchmarks: DOF2\n\r");
+#endif
+	robot_params.compute_squares();
+
+	// The Legs initialize their servos on a simulated bus
+	DnxHAL bench_bus(DNX_PROTOCOL_1, 1000000);
+	servo_map[wkq::KNEE_LEFT_FRONT] = servo_map[wkq::HIP_LEFT_FRONT] = servo_map[wkq::ARM_LEFT_FRONT] = &bench_bus;
+
+#ifdef DOF3
+	Leg leg(wkq::KNEE_LEFT_FRONT, wkq::HIP_LEFT_FRONT, wkq::ARM_LEFT_FRONT, servo_map, init_height, robot_params);
+	Leg leg_ref(wkq::KNEE_LEFT_FRONT, wkq::HIP_LEFT_FRONT, wkq::ARM_LEFT_FRONT, servo_map, init_height, robot_params);
+#else
+	Leg leg(wkq::KNEE_LEFT_FRONT, wkq::HIP_LEFT_FRONT, servo_map, init_height, robot_params);
+	Leg leg_ref(wkq::KNEE_LEFT_FRONT, wkq::HIP_LEFT_FRONT, servo_map, init_height, robot_params);
+#endif
+	State_t state(init_height, robot_params);
+	State_t state_ref(init_height, robot_params);
+	wkq::Point point(3.0, 4.0), point_ref(3.0, 4.0), delta(0.5, -0.25);
+	LegAngles joint_vel;
+	volatile double sink;
+
+	double step_size = 0.7 * State_t::max_step_size;
+	double angle = State_t::max_rotation_angle;
+
+	auto restore_leg = [&](){ leg.copyState(leg_ref); };
+	auto restore_state = [&](){ state = state_ref; };
+	auto restore_point = [&](){ point = point_ref; };
+
+	State_t batch_states[LEG_BATCH_SIZE] = { state_ref, state_ref, state_ref, state_ref, state_ref, state_ref };
+	auto restore_batch = [&](){ for(int i=0; i<LEG_BATCH_SIZE; i++) batch_states[i] = state_ref; };
+
+	printf("%-32s %10s %10s %8s   %s\n\r", "entry point", "ns/op", "min ns/op", "MAD", "libm calls/op");
+
+	bench("Leg::bodyForward", [&](){ leg.bodyForward(step_size); }, restore_leg);
+	bench("Leg::stepForward", [&](){ leg.stepForward(2*step_size); }, restore_leg);
+	bench("Leg::bodyRotate", [&](){ leg.bodyRotate(angle); }, restore_leg);
+#ifndef DOF3
+	bench("Leg::stepRotate", [&](){ leg.stepRotate(2*angle); }, restore_leg);
+#endif
+	bench("Leg::raiseBody", [&](){ leg.raiseBody(1.0); }, restore_leg);
+	bench("Leg::jointVelocities", [&](){ leg.jointVelocities(0.0, -10.0, 0.0, joint_vel); }, restore_leg);
+
+	// The setters derive the dependent vars and call configureAngles() exactly once
+	bench("State_t::configureAngles", [&](){ state.configureAngles(); }, restore_state);
+	// The six legs of a gait half cycle one by one and through the LegBatch kernel of the build
+	bench("configureAngles x6", [&](){
+		for(int i=0; i<LEG_BATCH_SIZE; i++) batch_states[i].configureAngles();
+	}, restore_batch);
+#ifdef LEG_BATCH
+	bench("LegBatch x6", [&](){
+		State_t::beginBatch();
+		for(int i=0; i<LEG_BATCH_SIZE; i++) batch_states[i].configureAngles();
+		State_t::endBatch();
+	}, restore_batch);
+#endif
+#ifdef DOF3
+	bench("State_t::setHipToEnd", [&](){ state.setHipToEnd(state_ref.vars.hip_to_end + 0.5); }, restore_state);
+#else
+	bench("State_t::setHipGroundToEf", [&](){
+		wkq::real_t dist = state_ref.vars.hip_ground_to_ef + 0.5;
+		state.setHipGroundToEf(dist, dist*dist);
+	}, restore_state);
+#endif
+	bench("State_t::centerLeg", [&](){ state.centerLeg(init_height - 1.0); }, restore_state);
+
+	bench("wkq::Point::translate", [&](){ point.translate(delta); }, restore_point);
+	bench("wkq::Point::translate + get_arg", [&](){ point.translate(delta); sink = point.get_arg(); }, restore_point);
+	bench("wkq::Point::rotate", [&](){ point.rotate(0.1); }, restore_point);
+
+#ifdef LEG_BATCH
+	batchError(state_ref);
+#endif
+
+	(void)sink;
+	return 0;
+}
@@ -1,9 +1,11 @@
 
 #include "src/wkq.h"
 #include "src/ServoJoint.h"
+#include "src/Trace.h"
 #include "src/Leg.h"
 #include "src/Tripod.h"
 #include "src/Robot.h"
+#include "src/Airtime.h"
 
 #include "src/Master.h"
 
@@ -16,13 +18,16 @@ int main(int argc, char **argv){
 
 	printf("MAIN started\n\r");
 	int baud, baud_xl320;
+	int baud_master 	= 115200;
 	double init_height;
 	DnxHAL* front_legs;
 	DnxHAL* back_legs;
+	DnxBus* front_bus;
+	DnxBus* back_bus;
 	Master* pixhawk;
 	BodyParams robot_params;
 	Robot* wk_quad;
-	unordered_map<int, DnxHAL*> servo_map;
+	static ServoMap servo_map;
 
 #ifdef DOF3
 	robot_params.DIST_CENTER 		= 10.95;
@@ -36,11 +41,14 @@ int main(int argc, char **argv){
 
 	baud 			= 10000000;
 	init_height 	= 15.0;	
-	pixhawk 		= new Master();
+	pixhawk 		= new Master(p28, p27, baud_master); 		// UART2
 
 	front_legs 	= new SerialAX12(DnxHAL::Port_t(p9, p10), baud);
 	back_legs 	= new SerialXL320(DnxHAL::Port_t(p13, p14), baud);
 
+	front_bus 	= new DnxBus(front_legs, p9, baud, DNX_PROTOCOL_1);
+	back_bus 	= new DnxBus(back_legs, p13, baud, DNX_PROTOCOL_2);
+
 #else 
 	robot_params.DIST_CENTER = 10.95 + 2.15;
 	robot_params.FEMUR = 17.1;
@@ -53,10 +61,13 @@ int main(int argc, char **argv){
 	//baud 			= 115200;
 	baud 			= 1000000;
 	init_height 	= robot_params.TIBIA;	
-	pixhawk 		= new Master();
+	pixhawk 		= new Master(p28, p27, baud_master); 		// UART2
 
 	front_legs 	= new SerialAX12(DnxHAL::Port_t(p9, p10), baud);
 	back_legs 	= new SerialAX12(DnxHAL::Port_t(p13, p14), baud);
+
+	front_bus 	= new DnxBus(front_legs, p9, baud, DNX_PROTOCOL_1);
+	back_bus 	= new DnxBus(back_legs, p13, baud, DNX_PROTOCOL_1);
 	
 	servo_map[wkq::KNEE_LEFT_FRONT] 	= front_legs;
 	servo_map[wkq::KNEE_LEFT_MIDDLE] 	= back_legs;
@@ -87,7 +98,11 @@ int main(int argc, char **argv){
 	//wk_quad->setState(wkq::RS_DEFAULT);
 
 
+	Trace::drain();								// servo writes of the initialization
 	printf("MAIN: Robot Initialized\n\r");
+	Airtime::report("initialization");
+	front_bus->printStats();
+	back_bus->printStats();
 
 	//wait(10);
 	//wk_quad->makeMovement(wkq::RM_HEXAPOD_GAIT, .7);
@@ -116,6 +131,10 @@ int main(int argc, char **argv){
 	//wk_quad->WalkForward(0.5);
 
 */
+	// The commands of the Master are applied by the ControlLoop, so it must keep running
+	printf("MAIN: Serving the Master\n\r");
+	while(true) ControlLoop::run(1.0);
+
 	printf("End of Program\n\r");
 	return 0;
 }
@@ -0,0 +1,215 @@
+#include <cstdio>
+#include <cstdlib>
+#include <chrono>
+
+#include "src/wkq.h"
+#include "src/Fixed.h"
+#include "src/robot_types.h"
+#include "src/Kinematics.h"
+
+/*
+ * main() for comparing the accuracy and the speed of the geometry core in double, float and Q16.16 fixed point
+ *
+ * To compile run $ make bin/precision 		(DOF2 equations)
+ * 				  $ make bin/precision DOF=3 	(DOF3 equations)
+ *
+ * Every algorithm of Kinematics is run over the same set of leg states for each scalar type. Errors are the maximum
+ * absolute difference in degrees of the resulting servo angles against the double instantiation
+ *
+ * The timings are host timings. With a hardware FPU double is cheap, so wkq::Fixed comes out 5-25 times slower than
+ * double here - Fixed is in the table for its precision, its speed says nothing about the FPU-less Cortex-M3
+ *
+ */
+
+const int SAMPLES 		= 4096;
+const int REPEATS 		= 200;
+
+
+template<typename T>
+struct Sample{
+	DynamicVarsT<T> vars;
+	LegAnglesT<T> angles;
+	T angle_offset;
+	T step_size;
+	T rotation;
+};
+
+enum Algorithm { ALG_CONFIGURE_ANGLES, ALG_CENTER_ANGLES, ALG_BODY_FORWARD, ALG_BODY_ROTATE,
+#ifndef DOF3
+	ALG_STEP_FORWARD, ALG_STEP_ROTATE,
+#endif
+	ALG_COUNT };
+
+const char* algorithm_names[] = { "configureAngles", "centerAngles", "bodyForward", "bodyRotate",
+#ifndef DOF3
+	"stepForward", "stepRotate",
+#endif
+};
+
+
+/* ================================================= SAMPLES ================================================= */
+
+double uniform(double min, double max){
+	return min + (max - min) * (rand() / (double)RAND_MAX);
+}
+
+/*  @ Notes:
+	Leg states are generated in double the same way State_t::configureVars() does it: height and servo angles first,
+	the remaining vars are derived from them
+*/
+void generateSamples(const BodyParamsT<double>& params, Sample<double>* samples){
+	srand(1);
+	for(int i=0; i<SAMPLES; i++){
+		Sample<double>& s = samples[i];
+		s.vars.height = uniform(params.MIN_HEIGHT, params.MAX_HEIGHT);
+		Kinematics<double>::centerAngles(params, s.vars.height, s.angles);
+
+#ifdef DOF3
+		s.angles.arm = wkq::radians(uniform(-15.0, 15.0));
+		s.vars.hip_to_end_sq = params.FEMUR_SQ + params.TIBIA_SQ - 2*params.FEMUR*params.TIBIA*cos(wkq::PI - s.angles.knee);
+		s.vars.hip_to_end = sqrt(s.vars.hip_to_end_sq);
+		s.vars.arm_ground_to_ef = sqrt(s.vars.hip_to_end_sq - s.vars.height*s.vars.height) + params.COXA;
+		s.vars.arm_ground_to_ef_sq = s.vars.arm_ground_to_ef*s.vars.arm_ground_to_ef;
+		s.vars.ef_center = s.vars.arm_ground_to_ef + params.DIST_CENTER;
+#else
+		s.angles.hip = wkq::radians(uniform(-15.0, 15.0));
+		s.vars.hip_ground_to_ef = params.FEMUR + params.TIBIA * sin(wkq::PI/2 - s.angles.knee);
+		s.vars.hip_ground_to_ef_sq = s.vars.hip_ground_to_ef*s.vars.hip_ground_to_ef;
+		s.vars.ef_center = s.vars.hip_ground_to_ef + params.DIST_CENTER;
+#endif
+		s.vars.height_sq = s.vars.height*s.vars.height;
+		s.vars.ef_center_sq = s.vars.ef_center*s.vars.ef_center;
+
+		s.angle_offset = uniform(wkq::PI/6, 5*wkq::PI/6);
+		s.step_size = uniform(0.5, 4.0);
+		s.rotation = wkq::radians(uniform(-20.0, 20.0));
+		if(fabs(s.rotation) < wkq::radians(1.0)) s.rotation = wkq::radians(1.0);
+	}
+}
+
+template<typename T>
+void convertSamples(const Sample<double>* samples_in, Sample<T>* samples){
+	for(int i=0; i<SAMPLES; i++){
+		const Sample<double>& in = samples_in[i];
+		Sample<T>& s = samples[i];
+
+		s.vars.height 				= T(in.vars.height);
+		s.vars.height_sq 			= T(in.vars.height_sq);
+		s.vars.ef_center 			= T(in.vars.ef_center);
+		s.vars.ef_center_sq 		= T(in.vars.ef_center_sq);
+#ifdef DOF3
+		s.vars.hip_to_end 			= T(in.vars.hip_to_end);
+		s.vars.hip_to_end_sq 		= T(in.vars.hip_to_end_sq);
+		s.vars.arm_ground_to_ef 	= T(in.vars.arm_ground_to_ef);
+		s.vars.arm_ground_to_ef_sq 	= T(in.vars.arm_ground_to_ef_sq);
+		s.angles.arm 				= T(in.angles.arm);
+#else
+		s.vars.hip_ground_to_ef 	= T(in.vars.hip_ground_to_ef);
+		s.vars.hip_ground_to_ef_sq 	= T(in.vars.hip_ground_to_ef_sq);
+#endif
+		s.angles.knee 				= T(in.angles.knee);
+		s.angles.hip 				= T(in.angles.hip);
+		s.angle_offset 				= T(in.angle_offset);
+		s.step_size 				= T(in.step_size);
+		s.rotation 					= T(in.rotation);
+	}
+}
+
+
+/* ================================================= RUNNING ================================================= */
+
+template<typename T>
+void runAlgorithm(int alg, const BodyParamsT<T>& params, const Sample<T>& s, LegAnglesT<T>& angles){
+	T dist_new, dist_sq_new;
+
+	angles = s.angles;
+	switch(alg){
+		case ALG_CONFIGURE_ANGLES: 	Kinematics<T>::configureAngles(params, s.vars, angles); break;
+		case ALG_CENTER_ANGLES: 	Kinematics<T>::centerAngles(params, s.vars.height, angles); break;
+		case ALG_BODY_FORWARD: 		Kinematics<T>::bodyForward(s.angle_offset, s.step_size, s.vars, angles, dist_new, dist_sq_new); break;
+		case ALG_BODY_ROTATE: 		Kinematics<T>::bodyRotate(params, s.rotation, s.vars, angles, dist_new, dist_sq_new); break;
+#ifndef DOF3
+		case ALG_STEP_FORWARD: 		Kinematics<T>::stepForward(params, s.angle_offset, T(2)*s.step_size, s.vars, angles); break;
+		case ALG_STEP_ROTATE: 		Kinematics<T>::stepRotate(params, s.angle_offset, T(2)*s.rotation, s.vars, angles); break;
+#endif
+	}
+}
+
+// Returns ns per call and fills results with the angles of the last repetition
+template<typename T>
+double timeAlgorithm(int alg, const BodyParamsT<T>& params, const Sample<T>* samples, LegAnglesT<T>* results){
+	auto start = std::chrono::steady_clock::now();
+	for(int r=0; r<REPEATS; r++){
+		for(int i=0; i<SAMPLES; i++) runAlgorithm(alg, params, samples[i], results[i]);
+	}
+	auto end = std::chrono::steady_clock::now();
+	return std::chrono::duration<double, std::nano>(end - start).count() / (REPEATS * SAMPLES);
+}
+
+// Maximum difference in degrees against the double reference
+template<typename T>
+double maxError(const LegAnglesT<double>* reference, const LegAnglesT<T>* results){
+	double max_error = 0.0;
+	for(int i=0; i<SAMPLES; i++){
+		double error = fabs(reference[i].knee - (double)results[i].knee);
+		if(fabs(reference[i].hip - (double)results[i].hip) > error) error = fabs(reference[i].hip - (double)results[i].hip);
+#ifdef DOF3
+		if(fabs(reference[i].arm - (double)results[i].arm) > error) error = fabs(reference[i].arm - (double)results[i].arm);
+#endif
+		if(error > max_error) max_error = error;
+	}
+	return wkq::degrees(max_error);
+}
+
+
+int main(){
+
+	BodyParamsT<double> params;
+	BodyParamsT<float> params_float;
+	BodyParamsT<wkq::Fixed> params_fixed;
+
+	static Sample<double> samples[SAMPLES];
+	static Sample<float> samples_float[SAMPLES];
+	static Sample<wkq::Fixed> samples_fixed[SAMPLES];
+
+	static LegAnglesT<double> results[SAMPLES];
+	static LegAnglesT<float> results_float[SAMPLES];
+	static LegAnglesT<wkq::Fixed> results_fixed[SAMPLES];
+
+	// Same parameters as simulation.cpp
+#ifdef DOF3
+	params.DIST_CENTER 			= 10.95;
+	params.COXA 				= 2.65;
+	params.FEMUR 				= 17.1;
+	params.TIBIA 				= 30;
+	params.KNEE_TO_MOTOR_DIST 	= 2.6;
+	params.MIN_HEIGHT = params.TIBIA - params.FEMUR*sin(wkq::radians(70));
+	params.MAX_HEIGHT = params.FEMUR*sin(wkq::radians(70)) + params.TIBIA;
+#else
+	params.DIST_CENTER 			= 10.95 + 2.15;
+	params.FEMUR 				= 17.1;
+	params.TIBIA 				= 12 + 1.85;
+	params.KNEE_TO_MOTOR_DIST 	= 2.6;
+	params.MIN_HEIGHT = params.TIBIA*cos(wkq::radians(60));
+	params.MAX_HEIGHT = params.TIBIA;
+#endif
+	params.compute_squares();
+	params_float.convert(params);
+	params_fixed.convert(params);
+
+	generateSamples(params, samples);
+	convertSamples(samples, samples_float);
+	convertSamples(samples, samples_fixed);
+
+	printf("%-16s %12s %12s %14s %12s %14s\n\r", "algorithm", "double ns/op", "float ns/op", "float err deg", "fixed ns/op", "fixed err deg");
+	for(int alg=0; alg<ALG_COUNT; alg++){
+		double ns 		= timeAlgorithm(alg, params, samples, results);
+		double ns_float = timeAlgorithm(alg, params_float, samples_float, results_float);
+		double ns_fixed = timeAlgorithm(alg, params_fixed, samples_fixed, results_fixed);
+
+		printf("%-16s %12.1f %12.1f %14.6f %12.1f %14.6f\n\r", algorithm_names[alg],
+			ns, ns_float, maxError(results, results_float), ns_fixed, maxError(results, results_fixed));
+	}
+
+	return 0;
+}
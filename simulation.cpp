@@ -1,11 +1,17 @@
 #include <cstdlib>
+#ifdef IK_TABLES
+#include <chrono>
+#endif
 
 #include "src/wkq.h"
 
 #include "src/ServoJoint.h"
+#include "src/Trace.h"
 #include "src/Leg.h"
 #include "src/Tripod.h"
 #include "src/Robot.h"
+#include "src/Airtime.h"
+#include "src/PhaseTimer.h"
 
 #include "src/Master.h"
 
@@ -16,8 +22,178 @@
  * 
  */
 
+#ifdef IK_TABLES
+/*
+ * Compare the exact IK mapping against its interpolated table over the table domain
+ */
+void benchmarkIKTable(const char* name, const IKTable& table, double x_min, double x_max){
+	const int ops = 1000000;
+	double step = (x_max - x_min) / ops;
+	volatile double sink = 0.0;
+
+	auto start = std::chrono::steady_clock::now();
+	for(int i=0; i<ops; i++) sink = sink + table.exact(x_min + i*step);
+	auto mid = std::chrono::steady_clock::now();
+	for(int i=0; i<ops; i++) sink = sink + table.lookup(x_min + i*step);
+	auto end = std::chrono::steady_clock::now();
+
+	double exact_ns = std::chrono::duration<double, std::nano>(mid - start).count() / ops;
+	double table_ns = std::chrono::duration<double, std::nano>(end - mid).count() / ops;
+	printf("IKTable %s: exact %.1f ns/op, table %.1f ns/op, max error %f degrees\n\r", 
+		name, exact_ns, table_ns, wkq::degrees(table.maxError()));
+}
+
+void benchmarkIKTables(){
+	IKTables& tables = State_t::ik_tables;
+#ifdef DOF3
+	benchmarkIKTable("knee", tables.knee, tables.params.TIBIA - tables.params.FEMUR, tables.params.TIBIA + tables.params.FEMUR);
+	benchmarkIKTable("hip", tables.hip, tables.params.TIBIA - tables.params.FEMUR, tables.params.TIBIA + tables.params.FEMUR);
+	benchmarkIKTable("acos_ratio", tables.acos_ratio, 0.0, 1.0);
+	benchmarkIKTable("center_hip", tables.center_hip, tables.params.MIN_HEIGHT, tables.params.MAX_HEIGHT);
+#else
+	benchmarkIKTable("knee", tables.knee, tables.params.FEMUR - tables.params.TIBIA, tables.params.FEMUR + tables.params.TIBIA);
+	benchmarkIKTable("center_knee", tables.center_knee, tables.params.MIN_HEIGHT, tables.params.MAX_HEIGHT);
+#endif
+}
+#endif
+
+
+/*
+ * Put the servos on two simulated buses with the same split as main.cpp
+ */
+void simulateBuses(ServoMap& servo_map, DnxHAL* front_legs, DnxHAL* back_legs){
+	const int front_knees[] = { wkq::KNEE_LEFT_FRONT, wkq::KNEE_RIGHT_FRONT, wkq::KNEE_RIGHT_MIDDLE };
+	const int back_knees[] 	= { wkq::KNEE_LEFT_MIDDLE, wkq::KNEE_LEFT_BACK, wkq::KNEE_RIGHT_BACK };
+
+	for(int i=0; i<3; i++){
+		servo_map[front_knees[i]] 		= front_legs;
+		servo_map[front_knees[i] + 6] 	= front_legs;		// hip
+		servo_map[back_knees[i]] 		= back_legs;
+		servo_map[back_knees[i] + 6] 	= back_legs;
+#ifdef DOF3
+		servo_map[front_knees[i] + 18] 	= front_legs;		// arm
+		servo_map[back_knees[i] + 18] 	= back_legs;
+#endif
+	}
+}
+
+
+/*
+ * Simulated time of a movement and the share of it each bus was busy
+ */
+void printBusTime(const char* name, double elapsed, double front_busy, double back_busy){
+	printf("%s: %.1f ms simulated, front bus busy %.2f ms (%.2f%%), back bus busy %.2f ms (%.2f%%)\n\r", name, 
+		elapsed/1000.0, front_busy/1000.0, 100.0*front_busy/elapsed, back_busy/1000.0, 100.0*back_busy/elapsed);
+}
+
+
+/*
+ * A frame of the Master fed to its RxRing as the RX interrupt would
+ */
+void sendMaster(Master* pixhawk, MasterCommand_t type, const uint8_t* payload, int length){
+	uint8_t frame[MASTER_MAX_PAYLOAD + MASTER_FRAME_OVERHEAD];
+	pixhawk->receive(frame, Master::encode(type, payload, length, frame));
+}
+
+void sendMove(Master* pixhawk, wkq::RobotMovement_t movement, double coeff){
+	uint16_t value = (uint16_t)(int16_t)(coeff*32767);
+	uint8_t payload[3] = { (uint8_t)movement, (uint8_t)(value & 0xFF), (uint8_t)(value >> 8) };
+	sendMaster(pixhawk, MC_MOVE, payload, 3);
+}
 
-int main(){
+/*
+ * Protocol of the Master: the parser resynchronizes after noise and a corrupt frame, invalid payloads are skipped
+ * and every other command is applied by the ControlLoop
+ */
+void simulateMasterProtocol(Master* pixhawk){
+	uint8_t frame[MASTER_MAX_PAYLOAD + MASTER_FRAME_OVERHEAD];
+	unsigned long invalid = pixhawk->invalid();
+
+	// A stray byte and a sync with a length over MASTER_MAX_PAYLOAD before a valid frame
+	const uint8_t noise[] = { 0x00, MASTER_SYNC, MC_TELEMETRY, MASTER_MAX_PAYLOAD + 1 };
+	pixhawk->receive(noise, sizeof(noise));
+	sendMaster(pixhawk, MC_TELEMETRY, NULL, 0);
+	ControlLoop::run(0.01);
+	printf("MASTER resync: %lu bytes skipped\n\r", pixhawk->invalid() - invalid);
+	invalid = pixhawk->invalid();
+
+	uint8_t phase = 2;
+	int size = Master::encode(MC_TIMING, &phase, 1, frame);
+	frame[size-1] ^= 0xFF;
+	pixhawk->receive(frame, size);
+	sendMaster(pixhawk, MC_TIMING, &phase, 1);
+	ControlLoop::run(0.01);
+	printf("MASTER bad CRC: %lu bytes skipped\n\r", pixhawk->invalid() - invalid);
+	invalid = pixhawk->invalid();
+
+	const uint8_t bad_state = 3, bad_move[3] = { wkq::RM_HEXAPOD_GAIT_VELOCITY + 1, 0, 0 };
+	sendMaster(pixhawk, MC_STATE, &bad_state, 1);
+	sendMaster(pixhawk, MC_MOVE, bad_move, 3);
+	sendMaster(pixhawk, MC_COUNT, NULL, 0);
+	sendMaster(pixhawk, MC_STOP, &phase, 1);
+	ControlLoop::run(0.01);
+	printf("MASTER invalid payloads: %lu frames skipped\n\r", pixhawk->invalid() - invalid);
+
+	const uint8_t standing_quad = wkq::RS_STANDING_QUAD, default_state = wkq::RS_DEFAULT;
+	const uint8_t height[2] = { 100, 0 }; 				// 1 cm
+	sendMaster(pixhawk, MC_STATE, &standing_quad, 1); 	// refused from a task
+	sendMaster(pixhawk, MC_STATE, &default_state, 1);
+	sendMaster(pixhawk, MC_HEIGHT, height, 2);
+	sendMaster(pixhawk, MC_STOP, NULL, 0);
+	ControlLoop::run(0.01);
+	printf("MASTER commands: %lu invalid in total, %lu bytes dropped\n\r", pixhawk->invalid(), pixhawk->dropped());
+	Trace::drain();
+}
+
+bool robotWalking(void* robot){
+	return static_cast<Robot*>(robot)->walking();
+}
+
+/*
+ * Walk commanded by the Master through the ControlLoop: a stop followed by the same movement before the next
+ * lift keeps walking, a new coefficient retargets at the next half cycle and a stop ends the walk
+ */
+void simulateMasterWalk(Robot* wk_quad, Master* pixhawk){
+	sendMove(pixhawk, wkq::RM_HEXAPOD_GAIT, .7);
+	ControlLoop::run(0.35);
+	printf("MASTER move: walking %d\n\r", wk_quad->walking());
+
+	sendMaster(pixhawk, MC_STOP, NULL, 0);
+	ControlLoop::run(0.02);
+	sendMove(pixhawk, wkq::RM_HEXAPOD_GAIT, .7);
+	ControlLoop::run(0.5);
+	printf("MASTER stop and the same move: walking %d\n\r", wk_quad->walking());
+
+	sendMove(pixhawk, wkq::RM_HEXAPOD_GAIT, .4);
+	ControlLoop::run(0.5);
+	printf("MASTER retarget: walking %d\n\r", wk_quad->walking());
+
+	sendMaster(pixhawk, MC_STOP, NULL, 0);
+	ControlLoop::runWhile(&robotWalking, wk_quad);
+	printf("MASTER stop: walking %d\n\r", wk_quad->walking());
+	Trace::drain();
+}
+
+
+/*
+ * RM_HEXAPOD_GAIT_VELOCITY writes moving speeds to the servos of the body movement; once the walk is over every servo
+ * must be back at SERVO_DEFAULT_SPEED
+ */
+void simulateVelocityGait(Robot* wk_quad, ServoMap& servo_map){
+	wk_quad->makeMovement(wkq::RM_HEXAPOD_GAIT_VELOCITY, .7);
+	Trace::drain();
+
+	int servos = 0, restored = 0;
+	for(int ID=0; ID<SERVO_MAP_SIZE; ID++){
+		if(!servo_map.contains(ID)) continue;
+		servos++;
+		if(servo_map[ID]->getValue(ID, DNX_ADDR_MOVING_SPEED) == SERVO_DEFAULT_SPEED) restored++;
+	}
+	printf("VELOCITY gait: %d of %d servos back at the default moving speed\n\r", restored, servos);
+}
+
+
+int main(int argc, char* argv[]){
 
 	printf("MAIN started\n\r");
 	int baud, baud_xl320;
@@ -27,7 +203,7 @@ int main(){
 	Master* pixhawk;
 	BodyParams robot_params;
 	Robot* wk_quad;
-	unordered_map<int, DnxHAL*> servo_map;
+	static ServoMap servo_map;
 
 #ifdef DOF3
 	robot_params.DIST_CENTER 		= 10.95;
@@ -42,8 +218,9 @@ int main(){
 	init_height 	= 15.0;	
 	pixhawk 		= new Master();
 
-	dnx_hips_knees 	= NULL;
-	dnx_arms 		= NULL;
+	baud 			= 1000000;
+	dnx_hips_knees 	= new DnxHAL(DNX_PROTOCOL_1, baud);
+	dnx_arms 		= new DnxHAL(DNX_PROTOCOL_2, baud);
 
 #else 
 	robot_params.DIST_CENTER = 10.95 + 2.15;
@@ -57,25 +234,66 @@ int main(){
 	init_height 	= robot_params.TIBIA;	
 	pixhawk 		= new Master();
 
-	dnx_hips_knees 	= NULL;
-	dnx_arms 		= NULL;
+	baud 			= 1000000;
+	dnx_hips_knees 	= new DnxHAL(DNX_PROTOCOL_1, baud);
+	dnx_arms 		= new DnxHAL(DNX_PROTOCOL_1, baud);
 #endif	
 
+#ifdef DOF3
+	DnxBus front_bus(dnx_hips_knees, DNX_PROTOCOL_1);
+	DnxBus back_bus(dnx_arms, DNX_PROTOCOL_2);
+#else
+	DnxBus front_bus(dnx_hips_knees, DNX_PROTOCOL_1);
+	DnxBus back_bus(dnx_arms, DNX_PROTOCOL_1);
+#endif
+	simulateBuses(servo_map, dnx_hips_knees, dnx_arms);
+
 	printf("MAIN: All comms ready\n\r");
 	
 	wk_quad = new Robot(pixhawk, servo_map, init_height, robot_params, wkq::RS_DEFAULT);					
 	//wk_quad = new Robot(pixhawk, servo_map, init_height, robot_params, wkq::RS_FLAT_QUAD);					
 	//wk_quad = new Robot(pixhawk, servo_map, init_height, robot_params, wkq::RS_RECTANGULAR);					
 
+	Trace::drain();
 	printf("MAIN: Robot Initialized\n\r");
+	// bin/sim [rate] - the gait is streamed as interpolated setpoints at rate Hz if given
+	if(argc > 1) wk_quad->setStreaming(atoi(argv[1]));
+
+#ifdef IK_TABLES
+	State_t::ik_tables.print();
+	benchmarkIKTables();
+#endif
 
+	Airtime::report("initialization");
+	double start_time = DnxHAL::now();
+	double start_busy[2] = { dnx_hips_knees->busyTime(), dnx_arms->busyTime() };
 	wk_quad->makeMovement(wkq::RM_HEXAPOD_GAIT, .7);
+	printBusTime("makeMovement", DnxHAL::now() - start_time, dnx_hips_knees->busyTime() - start_busy[0], 
+		dnx_arms->busyTime() - start_busy[1]);
+	Trace::drain();
+	Airtime::report("makeMovement");
+	PhaseTimer::report("makeMovement");
+	wk_quad->updateTelemetry();
+	Trace::drain();
+	pixhawk->getTelemetry()->print();
 	wk_quad->setState(wkq::RS_STANDING_QUAD);
+	Trace::drain();
 	//wk_quad->makeMovement(wkq::RM_ROTATION_HEXAPOD, 1);
 	//wk_quad->makeMovement(wkq::RM_ROTATION_HEXAPOD, 1);
 	wait(1);
 	wk_quad->setState(wkq::RS_FLAT_QUAD);
+	Trace::drain();
+	simulateMasterProtocol(pixhawk);
+	simulateMasterWalk(wk_quad, pixhawk);
+	simulateVelocityGait(wk_quad, servo_map);
 
+	front_bus.printStats();
+	back_bus.printStats();
+	dnx_hips_knees->printStats();
+	dnx_arms->printStats();
+	printf("ServoJoint: %lu goal positions suppressed as unchanged\n\r", ServoJoint::getTotalSuppressedWrites());
+	printf("SetpointStream: %lu interpolated setpoints\n\r", SetpointStream::setpoints());
+	ControlLoop::printStats();
 
 	return 0;
 }
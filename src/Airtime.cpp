@@ -0,0 +1,122 @@
+#include "Airtime.h"
+
+#include <cstdio>
+#include <cstring>
+
+#ifndef SIMULATION
+#include "mbed.h"
+#include "us_ticker_api.h"
+#else
+#include "SimDnxHAL.h"
+#endif
+
+// Initialize static variables
+Airtime::Bus Airtime::buses[AIRTIME_MAX_BUSES];
+int Airtime::bus_count = 0;
+wkq::math::Phase Airtime::phase = wkq::math::PHASE_OTHER;
+double Airtime::phase_start = 0;
+double Airtime::elapsed[wkq::math::PHASE_COUNT];
+unsigned long Airtime::occurrences[wkq::math::PHASE_COUNT];
+
+
+void Airtime::addBus(const void* bus, int protocol, int baud){
+	if(bus_count == AIRTIME_MAX_BUSES){
+		printf("ERROR: Airtime - too many buses, increase AIRTIME_MAX_BUSES\n\r");
+		return;
+	}
+	Bus& added = buses[bus_count++];
+	memset(&added, 0, sizeof(Bus));
+	added.bus 		= bus;
+	added.protocol 	= protocol;
+	added.baud 		= baud;
+}
+
+
+void Airtime::record(const void* bus, int tx_bytes, int rx_bytes/*=0*/){
+	for(int i=0; i<bus_count; i++){
+		if(buses[i].bus != bus) continue;
+
+		Counters& counters = buses[i].phases[phase];
+		double byte_time = 10.0 * 1000000.0 / buses[i].baud;
+		double wire = (tx_bytes + rx_bytes) * byte_time;
+		if(rx_bytes > 0) wire += AIRTIME_RETURN_DELAY_US;
+
+		counters.packets += (tx_bytes > 0) + (rx_bytes > 0);
+		counters.bytes 	 += tx_bytes + rx_bytes;
+		counters.wire 	 += wire;
+		counters.current += wire;
+		return;
+	}
+}
+
+
+void Airtime::setPhase(wkq::math::Phase phase_in){
+	closePhase();
+	phase = phase_in;
+}
+
+
+/*  @ Notes:
+	All values are per occurrence of the phase: the average period and wire time, the utilization wire/period, the
+	peak utilization of a single occurrence and the headroom period - wire
+*/
+void Airtime::report(const char* title){
+	closePhase();
+
+	printf("\n\rAIRTIME: %s\n\r", title);
+	printf("%-8s %-12s %6s %8s %8s %10s %10s %7s %7s %11s\n\r", "phase", "bus", "count", "packets", "bytes",
+		"period ms", "wire ms", "util %", "peak %", "headroom ms");
+
+	for(int p=0; p<wkq::math::PHASE_COUNT; p++){
+		if(occurrences[p] == 0) continue;
+		double period = elapsed[p] / occurrences[p];
+
+		for(int i=0; i<bus_count; i++){
+			const Counters& counters = buses[i].phases[p];
+			char name[16];
+			snprintf(name, sizeof(name), "%d P%d %dk", i, buses[i].protocol, buses[i].baud/1000);
+
+			double wire = counters.wire / occurrences[p];
+			printf("%-8s %-12s %6lu %8lu %8lu %10.2f %10.3f %7.2f %7.2f %11.2f\n\r", wkq::math::phase_names[p], name, occurrences[p],
+				counters.packets, counters.bytes, period/1000.0, wire/1000.0, (period > 0) ? 100.0*wire/period : 0.0,
+				100.0*counters.peak, (period - wire)/1000.0);
+		}
+	}
+
+	// Reset for the next report
+	for(int i=0; i<bus_count; i++) memset(buses[i].phases, 0, sizeof(buses[i].phases));
+	memset(elapsed, 0, sizeof(elapsed));
+	memset(occurrences, 0, sizeof(occurrences));
+}
+
+// us since the start; the 32 bit ticker wraps every 71 minutes, so it is accumulated
+double Airtime::now(){
+#ifndef SIMULATION
+	static uint32_t last_tick = us_ticker_read();
+	static double time = 0;
+	uint32_t tick = us_ticker_read();
+	time += (uint32_t)(tick - last_tick);
+	last_tick = tick;
+	return time;
+#else
+	return DnxHAL::now();
+#endif
+}
+
+
+/* ================================================= PRIVATE METHODS ================================================= */
+
+// Ends the occurrence of the current phase
+void Airtime::closePhase(){
+	double time = now();
+	double period = time - phase_start;
+
+	elapsed[phase] += period;
+	occurrences[phase]++;
+	for(int i=0; i<bus_count; i++){
+		Counters& counters = buses[i].phases[phase];
+		if(period > 0 && counters.current/period > counters.peak) counters.peak = counters.current/period;
+		counters.current = 0;
+	}
+	phase_start = time;
+}
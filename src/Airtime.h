@@ -0,0 +1,82 @@
+/*
+
+Airtime Class: Serial airtime budget of the servo buses per gait phase
+===========================================================================================
+
+FUNCTIONALITY:
+	1. Accumulates packets, bytes and wire time per bus and per gait phase (liftUp, body movement, step, finish step)
+		for everything the servos are sent and answer: the packets of DnxBus and the direct DnxHAL calls of ServoJoint,
+		status packets included
+	2. Measures how long every phase lasts, so that the wire time can be set against the phase period
+	3. report() prints per phase and bus the average period and wire time of one occurrence, the utilization, the peak
+		utilization of a single occurrence and the headroom left in the period. It then resets the counters
+
+-------------------------------------------------------------------------------------------
+
+FRAMEWORK:
+	1. All methods are static. The phases are the wkq::math::Phase values that Robot::makeMovement() goes through.
+		A phase owns everything sent from setPhase() until the next setPhase(): the body movement and the step leave
+		in one SYNC_WRITE at the end of the step, so that packet and the wait after it count for the step
+	2. Wire time is 10 bits per byte at the baud of the bus. A status packet adds AIRTIME_RETURN_DELAY_US before it
+		(the factory return delay of AX-12 and XL-320)
+	3. Direct DnxHAL calls go through libdnx, so their packets are not seen - ServoJoint reports their size through
+		DnxBus::countDirect(), which estimates it without byte stuffing
+	4. Phase periods come from us_ticker_read() on the mbed and from the simulated clock in SIMULATION
+	5. A bus is added by DnxBus on construction; at most AIRTIME_MAX_BUSES
+
+-------------------------------------------------------------------------------------------
+
+*/
+
+#ifndef AIRTIME_H
+#define AIRTIME_H
+
+#include <stdint.h>
+
+#include "MathStats.h"
+
+#define AIRTIME_MAX_BUSES 			4
+#define AIRTIME_RETURN_DELAY_US 	500
+
+
+class Airtime{
+
+public:
+
+	static void addBus(const void* bus, int protocol, int baud);
+	static void record(const void* bus, int tx_bytes, int rx_bytes=0);		// rx_bytes of a status packet
+	static void setPhase(wkq::math::Phase phase_in);
+
+	static void report(const char* title);					// Print the budget and reset it
+
+	static double now(); 									// us since the start - the clock of PhaseTimer and DnxBus too
+
+private:
+
+	struct Counters{
+		unsigned long packets;
+		unsigned long bytes;
+		double wire; 							// us
+		double current; 						// us in the occurrence of the phase in progress
+		double peak; 							// highest utilization of a single occurrence
+	};
+
+	struct Bus{
+		const void* bus;
+		int protocol;
+		int baud;
+		Counters phases[wkq::math::PHASE_COUNT];
+	};
+
+	static void closePhase();
+
+	static Bus buses[AIRTIME_MAX_BUSES];
+	static int bus_count;
+
+	static wkq::math::Phase phase;
+	static double phase_start;
+	static double elapsed[wkq::math::PHASE_COUNT];			// us spent in each phase
+	static unsigned long occurrences[wkq::math::PHASE_COUNT];
+};
+
+#endif
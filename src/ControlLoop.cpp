@@ -0,0 +1,191 @@
+#include "ControlLoop.h"
+
+#include <cstdio>
+
+#ifdef SIMULATION
+#include "SimDnxHAL.h"
+#endif
+
+// Initialize static variables
+ControlLoop::Task ControlLoop::tasks[CONTROL_MAX_TASKS];
+int ControlLoop::task_count = 0;
+int ControlLoop::rate = CONTROL_DEFAULT_RATE;
+unsigned long ControlLoop::cycle_count = 0;
+unsigned long ControlLoop::overrun_count = 0;
+bool ControlLoop::in_cycle = false;
+
+#ifndef SIMULATION
+Ticker ControlLoop::ticker;
+volatile unsigned long ControlLoop::ticks = 0;
+unsigned long ControlLoop::next_tick = 0;
+#else
+double ControlLoop::next_time = 0;
+#endif
+
+static const char* stage_names[CS_STAGE_COUNT] = { "sense", "plan", "IK", "write" };
+
+
+int ControlLoop::addTask(const char* name, ControlStage_t stage, int rate_hz, ControlTaskFn fn, void* arg/*=NULL*/){
+	if(task_count == CONTROL_MAX_TASKS){
+		printf("ERROR: ControlLoop::addTask - too many tasks, increase CONTROL_MAX_TASKS\n\r");
+		return -1;
+	}
+	Task& task = tasks[task_count];
+	task.name 		= name;
+	task.stage 		= stage;
+	task.rate 		= rate_hz;
+	task.divider 	= divider(rate_hz);
+	task.fn 		= fn;
+	task.arg 		= arg;
+	task.runs 		= 0;
+	return task_count++;
+}
+
+void ControlLoop::setTaskRate(int task, int rate_hz){
+	if(task < 0 || task >= task_count){
+		printf("ERROR: ControlLoop::setTaskRate - no task %d\n\r", task);
+		return;
+	}
+	tasks[task].rate 	= rate_hz;
+	tasks[task].divider = divider(rate_hz);
+}
+
+
+void ControlLoop::setRate(int rate_hz){
+	if(rate_hz <= 0){
+		printf("ERROR: ControlLoop::setRate - rate must be positive\n\r");
+		return;
+	}
+	rate = rate_hz;
+	for(int i=0; i<task_count; i++) tasks[i].divider = divider(tasks[i].rate);
+}
+
+int ControlLoop::getRate(){
+	return rate;
+}
+
+
+void ControlLoop::run(double duration){
+	int n = periods(duration);
+	if(n == 0) return;
+	if(in_cycle){
+		wait(duration);
+		return;
+	}
+
+	start();
+	for(int k=0; k<n; k++){
+		cycle();
+		waitTick();
+	}
+	stop();
+}
+
+/*  @ Notes:
+	The condition is checked after every cycle, so the loop returns as soon as a task has ended the work
+*/
+void ControlLoop::runWhile(ControlCondition condition, void* arg/*=NULL*/){
+	if(!condition(arg)) return;
+	if(in_cycle){
+		printf("ERROR: ControlLoop::runWhile - called from a task\n\r");
+		return;
+	}
+
+	start();
+	while(true){
+		cycle();
+		if(!condition(arg)) break;
+		waitTick();
+	}
+	stop();
+}
+
+int ControlLoop::periods(double duration){
+	int n = (int)(duration * rate + 0.5);
+	if(n < 1 && duration > 0) n = 1;
+	return n;
+}
+
+
+void ControlLoop::cycle(){
+	in_cycle = true;
+	for(int stage=0; stage<CS_STAGE_COUNT; stage++){
+		for(int i=0; i<task_count; i++){
+			Task& task = tasks[i];
+			if(task.stage != stage || task.divider == 0 || cycle_count % task.divider != 0) continue;
+			task.fn(task.arg);
+			task.runs++;
+		}
+	}
+	in_cycle = false;
+	cycle_count++;
+}
+
+
+unsigned long ControlLoop::cycles(){
+	return cycle_count;
+}
+
+unsigned long ControlLoop::overruns(){
+	return overrun_count;
+}
+
+void ControlLoop::printStats(){
+	printf("ControlLoop: %d Hz, %lu cycles, %lu overruns\n\r", rate, cycle_count, overrun_count);
+	for(int i=0; i<task_count; i++){
+		printf("\t%-12s %-6s %4d Hz %8lu runs\n\r", tasks[i].name, stage_names[tasks[i].stage],
+			(tasks[i].divider == 0) ? 0 : rate/tasks[i].divider, tasks[i].runs);
+	}
+}
+
+
+/* ================================================= PRIVATE METHODS ================================================= */
+
+// Cycles between two runs of a task at rate_hz; 0 if the task is disabled
+int ControlLoop::divider(int rate_hz){
+	if(rate_hz == CONTROL_EVERY_CYCLE || rate_hz >= rate) return 1;
+	if(rate_hz <= 0) return 0;
+	return (rate + rate_hz/2) / rate_hz;
+}
+
+void ControlLoop::start(){
+#ifndef SIMULATION
+	ticks 		= 0;
+	next_tick 	= 0;
+	ticker.attach_us(&ControlLoop::tickIrq, 1000000/rate);
+#else
+	next_time 	= DnxHAL::now();
+#endif
+}
+
+void ControlLoop::stop(){
+#ifndef SIMULATION
+	ticker.detach();
+#endif
+}
+
+// A period that has already passed when the tasks are done is an overrun; its tick is not waited for. On the mbed the
+// tick of the period counts as passed as soon as it has come
+void ControlLoop::waitTick(){
+#ifndef SIMULATION
+	next_tick++;
+	if(ticks >= next_tick){
+		overrun_count++;
+		next_tick = ticks;
+	}
+	while(ticks < next_tick) sleep();
+#else
+	next_time += 1000000.0 / rate;
+	if(DnxHAL::now() > next_time){
+		overrun_count++;
+		next_time = DnxHAL::now();
+	}
+	DnxHAL::waitUntil(next_time);
+#endif
+}
+
+#ifndef SIMULATION
+void ControlLoop::tickIrq(){
+	ticks++;
+}
+#endif
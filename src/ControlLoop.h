@@ -0,0 +1,113 @@
+/*
+
+ControlLoop Class: Fixed-rate executive of the periodic tasks of the robot
+===========================================================================================
+
+FUNCTIONALITY:
+	1. Runs registered tasks in cycles at a fixed rate. Every cycle goes through the stages sense -> plan -> IK ->
+		write and runs the tasks of each stage that are due, in the order they were added
+	2. A task has its own rate; it runs every rate/task rate cycles. Tasks can be disabled with rate 0
+	3. run() replaces a blocking wait(): it keeps cycling for the given time, so the periodic tasks are serviced
+		while the robot waits for its servos. runWhile() keeps cycling until a task has finished its work
+	4. Counts the cycles and the overruns - cycles whose tasks took longer than the period
+
+-------------------------------------------------------------------------------------------
+
+FRAMEWORK:
+	1. All methods are static - there is one executive for the whole program
+	2. On the mbed the periods come from an mbed::Ticker attached for the time of run(); the ISR only counts ticks
+		and the tasks run in the main context, sleeping between ticks. In SIMULATION the periods are on the simulated
+		clock of SimDnxHAL.h, so bus traffic of the tasks takes its real time
+	3. The first cycle of run() starts at once. run() lasts duration*rate cycles rounded, at least one unless
+		duration is 0
+	4. A task added with CONTROL_EVERY_CYCLE runs in every cycle whatever the rate. Change the rate outside run() only
+	5. Tasks that write goals send them right away only if run() is called outside a DnxBus sync
+	6. A task must not block the loop. run() called from inside a task falls back to a plain wait() and
+		runWhile() refuses to start. runWhile() checks the condition after every cycle and does not wait
+		once it is false
+
+-------------------------------------------------------------------------------------------
+
+*/
+
+#ifndef CONTROLLOOP_H
+#define CONTROLLOOP_H
+
+#include <cstddef>
+
+#ifndef SIMULATION
+#include "mbed.h"
+#endif
+
+#define CONTROL_MAX_TASKS 		8
+#define CONTROL_DEFAULT_RATE 	100 		// Hz
+#define CONTROL_EVERY_CYCLE 	-1
+
+enum ControlStage_t{
+	CS_SENSE 		= 0,
+	CS_PLAN 		= 1,
+	CS_IK 			= 2,
+	CS_WRITE 		= 3,
+	CS_STAGE_COUNT 	= 4
+};
+
+typedef void (*ControlTaskFn)(void* arg);
+typedef bool (*ControlCondition)(void* arg);
+
+
+class ControlLoop{
+
+public:
+
+	static int addTask(const char* name, ControlStage_t stage, int rate_hz, ControlTaskFn fn, void* arg=NULL); 	// handle; -1 if full
+	static void setTaskRate(int task, int rate_hz); 		// 0 - disabled
+
+	static void setRate(int rate_hz);
+	static int getRate();
+
+	static void run(double duration); 						// Cycle for duration seconds instead of wait()
+	static void runWhile(ControlCondition condition, void* arg=NULL); 	// Cycle until condition(arg) is false
+	static int periods(double duration); 					// Cycles run() takes for duration
+	static void cycle(); 									// One pass of the tasks that are due
+
+	static unsigned long cycles();
+	static unsigned long overruns();
+	static void printStats();
+
+private:
+
+	struct Task{
+		const char* name;
+		ControlStage_t stage;
+		int rate;
+		int divider; 										// runs every divider cycles; 0 - disabled
+		ControlTaskFn fn;
+		void* arg;
+		unsigned long runs;
+	};
+
+	static int divider(int rate_hz);
+	static void start();
+	static void stop();
+	static void waitTick();
+
+	static Task tasks[CONTROL_MAX_TASKS];
+	static int task_count;
+
+	static int rate;
+	static unsigned long cycle_count;
+	static unsigned long overrun_count;
+	static bool in_cycle;
+
+#ifndef SIMULATION
+	static void tickIrq();
+
+	static Ticker ticker;
+	static volatile unsigned long ticks;
+	static unsigned long next_tick;
+#else
+	static double next_time;
+#endif
+};
+
+#endif
@@ -0,0 +1,673 @@
+#include "DnxBus.h"
+
+#include <cstdio>
+#include <cstring>
+
+#ifdef SIMULATION
+#include "SimDnxHAL.h"
+#endif
+
+// Initialize static variables
+DnxBus* DnxBus::buses[DNX_BUS_MAX_BUSES];
+int DnxBus::bus_count = 0;
+int DnxBus::sync_depth = 0;
+DnxSyncMode_t DnxBus::sync_mode = DNX_SYNC_WRITE;
+
+// Register block of present position, speed, load, voltage and temperature. Offsets are within the block
+struct TelemetryLayout{
+	int address;
+	int size;
+	int position;
+	int load;
+	int voltage;
+	int temperature;
+};
+
+static const TelemetryLayout ax12_layout 	= { 36, 8, 0, 4, 6, 7 };
+static const TelemetryLayout xl320_layout 	= { 37, 10, 0, 4, 8, 9 };
+
+#ifndef SIMULATION
+#define UART_LSR_RDR 		0x01
+#define UART_LSR_THRE 		0x20
+#define UART_LSR_TEMT 		0x40
+#define UART_IER_THRE 		0x02
+#define UART_FIFO_SIZE 		16
+
+// UARTs of the LPC1768 by their TX pin
+struct UartPin{
+	PinName tx;
+	UARTName uart;
+	IRQn_Type irq;
+};
+
+static const UartPin uart_pins[] = {
+	{ P0_2, UART_0, UART0_IRQn },
+	{ P0_15, UART_1, UART1_IRQn }, 	{ P2_0, UART_1, UART1_IRQn },
+	{ P0_10, UART_2, UART2_IRQn }, 	{ P2_8, UART_2, UART2_IRQn },
+	{ P0_0, UART_3, UART3_IRQn }, 	{ P0_25, UART_3, UART3_IRQn }, 	{ P4_28, UART_3, UART3_IRQn }
+};
+#endif
+
+
+#ifndef SIMULATION
+DnxBus::DnxBus(DnxHAL* hal_in, PinName tx, int baud_in, DnxProtocol_t protocol_in) :
+	hal(hal_in), protocol(protocol_in), baud(baud_in), uart(NULL), tx_handler(NULL), tx_next(0), tx_busy(false), tx_data(NULL), tx_pos(0), tx_size(0), tx_end(0),
+	queued(0), speeds_queued(0), staged(false), servo_count(0), bytes_sent(0), bytes_unbatched(0), packets_sent(0){
+	for(unsigned int i=0; i<sizeof(uart_pins)/sizeof(uart_pins[0]); i++){
+		if(uart_pins[i].tx != tx) continue;
+		uart 		= (LPC_UART_TypeDef*)uart_pins[i].uart;
+		uart_irq 	= uart_pins[i].irq;
+	}
+	// The handler of the libdnx serial object stays first in the chain of the UART interrupt
+	if(uart != NULL) tx_handler = InterruptManager::get()->add_handler(this, &DnxBus::txIrq, uart_irq);
+	else printf("ERROR: DnxBus - pin %d is not the TX pin of a UART\n\r", (int)tx);
+#else
+DnxBus::DnxBus(DnxHAL* hal_in, DnxProtocol_t protocol_in) :
+	hal(hal_in), protocol(protocol_in), baud(hal_in->getBaud()), tx_next(0), tx_busy(false), tx_data(NULL), tx_pos(0), tx_size(0), tx_end(0),
+	queued(0), speeds_queued(0), staged(false), servo_count(0), bytes_sent(0), bytes_unbatched(0), packets_sent(0){
+#endif
+
+	if(bus_count == DNX_BUS_MAX_BUSES) printf("ERROR: DnxBus - too many buses, increase DNX_BUS_MAX_BUSES\n\r");
+	else buses[bus_count++] = this;
+	Airtime::addBus(this, protocol, baud);
+}
+
+DnxBus::~DnxBus(){
+	waitIdle();
+#ifndef SIMULATION
+	if(tx_handler != NULL) InterruptManager::get()->remove_handler(tx_handler, uart_irq);
+#endif
+	for(int i=0; i<bus_count; i++){
+		if(buses[i] == this){
+			buses[i] = buses[--bus_count];
+			break;
+		}
+	}
+}
+
+
+DnxBus* DnxBus::find(const DnxHAL* hal_in){
+	for(int i=0; i<bus_count; i++){
+		if(buses[i]->hal == hal_in) return buses[i];
+	}
+	return NULL;
+}
+
+
+/* ================================================= SYNC WRITE ================================================= */
+
+void DnxBus::beginSync(){
+	sync_depth++;
+}
+
+void DnxBus::endSync(){
+	if(sync_depth == 0) return;
+	if(--sync_depth > 0) return;
+
+	sendPending();
+}
+
+bool DnxBus::syncActive(){
+	return sync_depth > 0;
+}
+
+/*  @ Notes:
+	In DNX_SYNC_STAGED every bus must have sent its REG_WRITEs before the first ACTION goes out; the ACTIONs are then
+	started back to back and are sent by all buses at the same time
+*/
+void DnxBus::sendPending(){
+	for(int i=0; i<bus_count; i++){
+		buses[i]->flush();
+	}
+	if(sync_mode == DNX_SYNC_STAGED){
+		for(int i=0; i<bus_count; i++){
+			buses[i]->waitIdle();
+		}
+		for(int i=0; i<bus_count; i++){
+			if(buses[i]->staged) buses[i]->sendAction();
+		}
+	}
+
+	double end = 0;
+	for(int i=0; i<bus_count; i++){
+		if(buses[i]->tx_end > end) end = buses[i]->tx_end;
+	}
+	PhaseTimer::writeEnd(end);
+}
+
+void DnxBus::setSyncMode(DnxSyncMode_t mode){
+	if(sync_depth > 0) printf("WARNING: DnxBus::setSyncMode - called inside a sync\n\r");
+	sync_mode = mode;
+}
+
+
+void DnxBus::queueGoalPosition(int ID, double angle){
+	queueGoalRaw(ID, positionToRaw(angle));
+}
+
+void DnxBus::queueGoalRaw(int ID, int raw){
+	for(int i=0; i<queued; i++){
+		if(queued_IDs[i] == ID){
+			sendPending();
+			break;
+		}
+	}
+	if(queued == DNX_BUS_MAX_SERVOS) flush();
+
+	queued_IDs[queued] 		= ID;
+	queued_values[queued] 	= raw;
+	queued++;
+}
+
+
+void DnxBus::queueMovingSpeed(int ID, int raw){
+	for(int i=0; i<speeds_queued; i++){
+		if(speed_IDs[i] == ID){
+			sendPending();
+			break;
+		}
+	}
+	if(speeds_queued == DNX_BUS_MAX_SERVOS) flush();
+
+	speed_IDs[speeds_queued] 		= ID;
+	speed_values[speeds_queued] 	= raw;
+	speeds_queued++;
+}
+
+
+void DnxBus::flush(){
+	if(queued == 0 && speeds_queued == 0) return;
+	PhaseTimer::writeBegin();
+	sendSpeeds();
+	if(queued == 0) return;
+	if(sync_mode == DNX_SYNC_STAGED){
+		stage();
+		return;
+	}
+
+	uint8_t* packet = tx_buffers[tx_next];
+	int size = encodeSyncWrite(protocol, DNX_ADDR_GOAL_POSITION, 2, queued_IDs, queued_values, queued, packet);
+	transmit(packet, size);
+
+	bytes_unbatched += queued * ((protocol == DNX_PROTOCOL_1) ? 9 : 14);
+	Trace::log(TR_BUS_SYNC_WRITE, protocol, queued);
+	queued = 0;
+}
+
+
+void DnxBus::sendSpeeds(){
+	if(speeds_queued == 0) return;
+
+	uint8_t* packet = tx_buffers[tx_next];
+	int size = encodeSyncWrite(protocol, DNX_ADDR_MOVING_SPEED, 2, speed_IDs, speed_values, speeds_queued, packet);
+	transmit(packet, size);
+
+	bytes_unbatched += speeds_queued * ((protocol == DNX_PROTOCOL_1) ? 9 : 14);
+	Trace::log(TR_BUS_SYNC_WRITE, protocol, speeds_queued);
+	speeds_queued = 0;
+}
+
+
+/*  @ Notes:
+	The REG_WRITE packets are packed in the transmit buffer back to back; a full buffer is sent and packing goes on in
+	the other one
+*/
+void DnxBus::stage(){
+	uint8_t packet[DNX_BUS_MAX_PACKET];
+	uint8_t params[4];
+	uint8_t* buf = tx_buffers[tx_next];
+	int size = 0;
+
+	for(int i=0; i<queued; i++){
+		int n = 0;
+		params[n++] = DNX_ADDR_GOAL_POSITION;
+		if(protocol == DNX_PROTOCOL_2) params[n++] = 0;
+		params[n++] = queued_values[i] & 0xFF;
+		params[n++] = (queued_values[i] >> 8) & 0xFF;
+
+		int packet_size = encodePacket(protocol, queued_IDs[i], DNX_INS_REG_WRITE, params, n, packet);
+		if(size + packet_size > DNX_BUS_MAX_PACKET){
+			transmit(buf, size);
+			buf = tx_buffers[tx_next];
+			size = 0;
+		}
+		memcpy(buf + size, packet, packet_size);
+		size += packet_size;
+	}
+	transmit(buf, size);
+
+	bytes_unbatched += queued * ((protocol == DNX_PROTOCOL_1) ? 9 : 14);
+	Trace::log(TR_BUS_REG_WRITE, protocol, queued);
+	staged = true;
+	queued = 0;
+}
+
+void DnxBus::sendAction(){
+	uint8_t* buf = tx_buffers[tx_next];
+	transmit(buf, encodePacket(protocol, DNX_ID_BROADCAST, DNX_INS_ACTION, NULL, 0, buf));
+	Trace::log(TR_BUS_ACTION, protocol, 0);
+	staged = false;
+}
+
+
+/*  @ Notes:
+	Instruction packet: 	1.0 - 6 bytes + parameters 	2.0 - 10 bytes + parameters, the address takes 1/2 bytes
+	Writes are not answered since ServoJoint sets status return level 1. No data at all is an ACTION
+	Byte stuffing is not counted
+*/
+void DnxBus::countDirect(int write_bytes, int read_bytes/*=0*/){
+	int address_size = (protocol == DNX_PROTOCOL_1) ? 1 : 2;
+	int header = (protocol == DNX_PROTOCOL_1) ? 6 : 10;
+
+	if(read_bytes == 0 && write_bytes == 0) Airtime::record(this, header);
+	else if(read_bytes == 0) Airtime::record(this, header + address_size + write_bytes);
+	else Airtime::record(this, header + 2*address_size, statusSize(read_bytes));
+}
+
+int DnxBus::statusSize(int data_size) const{
+	return (protocol == DNX_PROTOCOL_1) ? 6 + data_size : 11 + data_size;
+}
+
+
+// On the mbed a packet is sent once its last byte has left the shift register, not when it entered the FIFO
+bool DnxBus::busy() const{
+#ifndef SIMULATION
+	return tx_busy && !(tx_pos == tx_size && (uart->LSR & UART_LSR_TEMT));
+#else
+	return hal->busy();
+#endif
+}
+
+/*  @ Notes:
+	mbed: sleeps while the TxIrq feeds the FIFO - the interrupt wakes it even with interrupts masked, so the last one
+	cannot be missed between the check and __WFI(). No interrupt comes once the last bytes are in the FIFO, so those
+	(at most UART_FIFO_SIZE) are waited for on TEMT. The echo of the packet on the single wire is then discarded, so the next
+	libdnx call reads only its own status packet
+*/
+void DnxBus::waitIdle(){
+#ifndef SIMULATION
+	bool feeding = true;
+	while(feeding){
+		__disable_irq();
+		feeding = tx_busy && tx_pos < tx_size;
+		if(feeding) __WFI();
+		__enable_irq();
+	}
+	while(busy()){}
+	if(tx_busy){
+		tx_busy = false;
+		discardInput();
+	}
+#else
+	hal->waitIdle();
+#endif
+}
+
+
+/* ================================================= TELEMETRY ================================================= */
+
+void DnxBus::attachServo(int ID){
+	for(int i=0; i<servo_count; i++){
+		if(servo_IDs[i] == ID) return;
+	}
+	if(servo_count == DNX_BUS_MAX_SERVOS){
+		printf("ERROR: DnxBus::attachServo - too many servos, increase DNX_BUS_MAX_SERVOS\n\r");
+		return;
+	}
+	servo_IDs[servo_count++] = ID;
+}
+
+
+void DnxBus::readTelemetry(Telemetry& telemetry){
+	telemetry.beginUpdate();
+	for(int i=0; i<bus_count; i++){
+		buses[i]->readBusTelemetry(telemetry);
+	}
+}
+
+
+/*  @ Notes:
+	2.0: 	one SYNC_READ, then the status packets arrive in the order of the IDs in it
+	1.0: 	one READ_DATA of the whole register block per servo, each answered before the next one is sent
+	A servo that does not answer within DNX_BUS_TIMEOUT_US is marked as failed and the rest are still read
+*/
+int DnxBus::readBusTelemetry(Telemetry& telemetry){
+	const TelemetryLayout& layout = (protocol == DNX_PROTOCOL_1) ? ax12_layout : xl320_layout;
+	uint8_t params[DNX_BUS_MAX_PACKET];
+	uint8_t data[DNX_BUS_MAX_PACKET];
+	uint8_t error;
+	int answered = 0;
+
+	waitIdle();
+#ifndef SIMULATION
+	discardInput(); 								// echoes and answers nobody waited for
+#endif
+
+	if(protocol == DNX_PROTOCOL_2){
+		int n = 0;
+		params[n++] = layout.address & 0xFF;
+		params[n++] = (layout.address >> 8) & 0xFF;
+		params[n++] = layout.size & 0xFF;
+		params[n++] = (layout.size >> 8) & 0xFF;
+		for(int i=0; i<servo_count; i++) params[n++] = servo_IDs[i];
+
+		uint8_t* buf = tx_buffers[tx_next];
+		transmit(buf, encodePacket(protocol, DNX_ID_BROADCAST, DNX_INS_SYNC_READ, params, n, buf));
+		waitIdle();
+	}
+
+	for(int i=0; i<servo_count; i++){
+		if(protocol == DNX_PROTOCOL_1){
+			params[0] = layout.address;
+			params[1] = layout.size;
+			uint8_t* buf = tx_buffers[tx_next];
+			transmit(buf, encodePacket(protocol, servo_IDs[i], DNX_INS_READ_DATA, params, 2, buf));
+			waitIdle();
+		}
+
+		if(receiveStatus(servo_IDs[i], data, layout.size, &error)){
+			Airtime::record(this, 0, statusSize(layout.size));
+			publishTelemetry(telemetry, servo_IDs[i], data, error);
+			answered++;
+		}
+		else telemetry.fail(servo_IDs[i]);
+	}
+
+	Trace::log(TR_BUS_READ, protocol, answered);
+	return answered;
+}
+
+
+/* ================================================= PACKETS ================================================= */
+
+int DnxBus::positionToRaw(double angle){
+	int raw = (int)floor(512.0 + wkq::degrees(angle) * 1024.0/300.0 + 0.5);
+	if(raw < 0) 		raw = 0;
+	if(raw > 1023) 		raw = 1023;
+	return raw;
+}
+
+
+/*  @ Notes:
+	Protocol 1.0: 	FF FF ID LEN INS PARAMS CHECKSUM 			LEN = params + 2, CHECKSUM = ~(ID + LEN + INS + PARAMS)
+	Protocol 2.0: 	FF FF FD 00 ID LEN_L LEN_H INS PARAMS CRC_L CRC_H 	LEN = params after stuffing + 3
+					An FD is inserted after every FF FF FD inside INS and PARAMS (byte stuffing)
+	buf must hold DNX_BUS_MAX_PACKET bytes; params that do not fit are dropped with an error
+*/
+int DnxBus::encodePacket(DnxProtocol_t protocol, uint8_t ID, uint8_t instruction, const uint8_t* params, int param_count, uint8_t* buf){
+	int size = 0;
+
+	if(protocol == DNX_PROTOCOL_1){
+		if(param_count + 6 > DNX_BUS_MAX_PACKET){
+			printf("ERROR: DnxBus::encodePacket - packet too long\n\r");
+			return 0;
+		}
+		uint8_t checksum = 0;
+		buf[size++] = 0xFF;
+		buf[size++] = 0xFF;
+		buf[size++] = ID;
+		buf[size++] = param_count + 2;
+		buf[size++] = instruction;
+		for(int i=0; i<param_count; i++) buf[size++] = params[i];
+		for(int i=2; i<size; i++) checksum += buf[i];
+		buf[size++] = ~checksum;
+		return size;
+	}
+
+	const int payload_start = 7;
+	buf[size++] = 0xFF;
+	buf[size++] = 0xFF;
+	buf[size++] = 0xFD;
+	buf[size++] = 0x00;
+	buf[size++] = ID;
+	size += 2; 						// length filled in below
+	buf[size++] = instruction;
+	for(int i=0; i<param_count; i++){
+		if(size + 3 > DNX_BUS_MAX_PACKET){
+			printf("ERROR: DnxBus::encodePacket - packet too long\n\r");
+			return 0;
+		}
+		buf[size++] = params[i];
+		if(size - payload_start >= 3 && buf[size-3] == 0xFF && buf[size-2] == 0xFF && buf[size-1] == 0xFD) buf[size++] = 0xFD;
+	}
+
+	int length = size - payload_start + 2;
+	buf[5] = length & 0xFF;
+	buf[6] = (length >> 8) & 0xFF;
+
+	uint16_t crc = crc16(buf, size);
+	buf[size++] = crc & 0xFF;
+	buf[size++] = (crc >> 8) & 0xFF;
+	return size;
+}
+
+
+/*  @ Notes:
+	SYNC_WRITE parameters: 	1.0 - ADDR LEN 			then ID DATA[LEN] per servo
+							2.0 - ADDR_L ADDR_H LEN_L LEN_H 	then ID DATA[LEN] per servo
+	values are written little endian in data_size bytes
+*/
+int DnxBus::encodeSyncWrite(DnxProtocol_t protocol, int address, int data_size, const uint8_t* IDs, const int* values, int count, uint8_t* buf){
+	uint8_t params[DNX_BUS_MAX_PACKET];
+	int n = 0;
+
+	if(4 + count*(data_size+1) > DNX_BUS_MAX_PACKET){
+		printf("ERROR: DnxBus::encodeSyncWrite - too many servos\n\r");
+		return 0;
+	}
+
+	params[n++] = address & 0xFF;
+	if(protocol == DNX_PROTOCOL_2) params[n++] = (address >> 8) & 0xFF;
+	params[n++] = data_size & 0xFF;
+	if(protocol == DNX_PROTOCOL_2) params[n++] = (data_size >> 8) & 0xFF;
+
+	for(int i=0; i<count; i++){
+		params[n++] = IDs[i];
+		for(int b=0; b<data_size; b++) params[n++] = (values[i] >> (8*b)) & 0xFF;
+	}
+
+	return encodePacket(protocol, DNX_ID_BROADCAST, DNX_INS_SYNC_WRITE, params, n, buf);
+}
+
+
+/*  @ Notes:
+	Packets: 	1.0 - FF FF ID LEN INS PARAMS CHECKSUM
+				2.0 - FF FF FD 00 ID LEN_L LEN_H INS PARAMS CRC_L CRC_H, byte stuffing removed from INS and PARAMS
+	Bytes before the packet and packets with a wrong checksum/CRC are skipped
+*/
+int DnxBus::decodePacket(DnxProtocol_t protocol, const uint8_t* buf, int size, uint8_t* ID, uint8_t* instruction, uint8_t* params, int* param_count){
+	for(int i=0; i+1<size; i++){
+		if(buf[i] != 0xFF || buf[i+1] != 0xFF) continue;
+
+		if(protocol == DNX_PROTOCOL_1){
+			if(i+4 > size || buf[i+3] < 2) continue;
+			int end = i + 4 + buf[i+3];
+			if(end > size) continue;
+
+			uint8_t checksum = 0;
+			for(int j=i+2; j<end-1; j++) checksum += buf[j];
+			if((uint8_t)~checksum != buf[end-1]) continue;
+
+			*ID 			= buf[i+2];
+			*instruction 	= buf[i+4];
+			*param_count 	= buf[i+3] - 2;
+			memcpy(params, buf + i + 5, *param_count);
+			return end;
+		}
+
+		if(i+7 > size || buf[i+2] != 0xFD || buf[i+3] != 0x00) continue;
+		int length = buf[i+5] | (buf[i+6] << 8);
+		int end = i + 7 + length;
+		if(length < 3 || end > size) continue;
+		if((buf[end-2] | (buf[end-1] << 8)) != crc16(buf + i, end - i - 2)) continue;
+
+		int n = 0;
+		for(int j=i+8; j<end-2; j++){
+			if(j - (i+7) >= 3 && buf[j-3] == 0xFF && buf[j-2] == 0xFF && buf[j-1] == 0xFD) continue; 	// stuffed FD
+			params[n++] = buf[j];
+		}
+		*ID 			= buf[i+4];
+		*instruction 	= buf[i+7];
+		*param_count 	= n;
+		return end;
+	}
+	return 0;
+}
+
+
+/*  @ Notes:
+	Status packets: 	1.0 - FF FF ID LEN ERR DATA CHECKSUM 		LEN = data + 2
+						2.0 - FF FF FD 00 ID LEN_L LEN_H 55 ERR DATA CRC_L CRC_H
+	Other packets are skipped - echoes of the instruction packets on a half duplex line do not match, since they have
+	another length (1.0) or ID/instruction (2.0)
+*/
+bool DnxBus::decodeStatus(DnxProtocol_t protocol, const uint8_t* buf, int size, uint8_t ID, uint8_t* data, int data_size, uint8_t* error){
+	uint8_t params[DNX_BUS_MAX_PACKET];
+	uint8_t packet_ID, instruction;
+	int param_count, used;
+	int offset = 0;
+
+	while((used = decodePacket(protocol, buf + offset, size - offset, &packet_ID, &instruction, params, &param_count)) > 0){
+		offset += used;
+		if(packet_ID != ID) continue;
+
+		if(protocol == DNX_PROTOCOL_1 && param_count == data_size){
+			*error = instruction;
+			memcpy(data, params, data_size);
+			return true;
+		}
+		if(protocol == DNX_PROTOCOL_2 && instruction == DNX_INS_STATUS && param_count == data_size + 1){
+			*error = params[0];
+			memcpy(data, params + 1, data_size);
+			return true;
+		}
+	}
+	return false;
+}
+
+
+// CRC-16 of protocol 2.0: polynomial 0x8005, initial value 0, no reflection
+uint16_t DnxBus::crc16(const uint8_t* buf, int size){
+	uint16_t crc = 0;
+	for(int i=0; i<size; i++){
+		crc ^= (uint16_t)buf[i] << 8;
+		for(int b=0; b<8; b++){
+			if(crc & 0x8000) 	crc = (crc << 1) ^ 0x8005;
+			else 				crc = crc << 1;
+		}
+	}
+	return crc;
+}
+
+
+/* ================================================= STATISTICS ================================================= */
+
+unsigned long DnxBus::bytesSent() const{
+	return bytes_sent;
+}
+
+unsigned long DnxBus::bytesUnbatched() const{
+	return bytes_unbatched;
+}
+
+void DnxBus::printStats() const{
+	printf("DnxBus protocol %d: %lu packets, %lu bytes sent, %lu bytes as single writes\n\r",
+		(int)protocol, packets_sent, bytes_sent, bytes_unbatched);
+}
+
+
+/* ================================================= PRIVATE METHODS ================================================= */
+
+/*  @ Notes:
+	buf must be tx_buffers[tx_next]; it stays untouched until the transmission is over and the next packet is encoded in
+	the other buffer
+*/
+void DnxBus::transmit(const uint8_t* buf, int size){
+	if(size == 0) return;
+	waitIdle();
+	bytes_sent += size;
+	packets_sent++;
+	Airtime::record(this, size);
+	tx_next = 1 - tx_next;
+	tx_end 	= Airtime::now() + size * 10.0 * 1000000.0 / baud; 		// the line is idle, the packet starts now
+
+#ifndef SIMULATION
+	if(uart == NULL) return;
+	tx_data = buf;
+	tx_size = size;
+	tx_pos 	= 0;
+	tx_busy = true;
+	__disable_irq();
+	txIrq(); 						// fill the FIFO, the rest is sent from the interrupt
+	__enable_irq();
+#else
+	hal->write(buf, size);
+#endif
+}
+
+
+/*  @ Notes:
+	Returns false if no valid status packet arrives within DNX_BUS_TIMEOUT_US of the previous byte. The receive buffer
+	drops its older half when it fills with bytes that are not the expected packet
+*/
+bool DnxBus::receiveStatus(uint8_t ID, uint8_t* data, int data_size, uint8_t* error){
+	uint8_t rx[DNX_BUS_MAX_PACKET];
+	int size = 0;
+
+#ifndef SIMULATION
+	Timer timer;
+	timer.start();
+	while(timer.read_us() < DNX_BUS_TIMEOUT_US){
+		if(!(uart->LSR & UART_LSR_RDR)) continue;
+		if(size == DNX_BUS_MAX_PACKET){
+			memmove(rx, rx + DNX_BUS_MAX_PACKET/2, DNX_BUS_MAX_PACKET/2);
+			size = DNX_BUS_MAX_PACKET/2;
+		}
+		rx[size++] = uart->RBR;
+		timer.reset();
+		if(decodeStatus(protocol, rx, size, ID, data, data_size, error)) return true;
+	}
+	return false;
+#else
+	size = hal->read(rx, DNX_BUS_MAX_PACKET);
+	if(size > 0 && decodeStatus(protocol, rx, size, ID, data, data_size, error)) return true;
+	DnxHAL::advance(DNX_BUS_TIMEOUT_US);
+	return false;
+#endif
+}
+
+
+// Load is 0-1023 with bit 10 set for the clockwise direction
+void DnxBus::publishTelemetry(Telemetry& telemetry, uint8_t ID, const uint8_t* data, uint8_t error) const{
+	const TelemetryLayout& layout = (protocol == DNX_PROTOCOL_1) ? ax12_layout : xl320_layout;
+	ServoTelemetry servo;
+	int load = data[layout.load] | (data[layout.load+1] << 8);
+
+	servo.ID 			= ID;
+	servo.position 		= data[layout.position] | (data[layout.position+1] << 8);
+	servo.load 			= (load & 0x400) ? -(load & 0x3FF) : (load & 0x3FF);
+	servo.voltage 		= data[layout.voltage];
+	servo.temperature 	= data[layout.temperature];
+	servo.error 		= error;
+	telemetry.publish(servo);
+}
+
+
+#ifndef SIMULATION
+/*  @ Notes:
+	Chained to the UART interrupt. The THRE interrupt is enabled only while a packet is fed: every time the FIFO is empty
+	up to UART_FIFO_SIZE more bytes go in. tx_busy stays set until busy() sees TEMT
+*/
+void DnxBus::txIrq(){
+	if(!tx_busy || tx_pos == tx_size) return;
+	if(uart->LSR & UART_LSR_THRE){
+		for(int n=0; n<UART_FIFO_SIZE && tx_pos < tx_size; n++) uart->THR = tx_data[tx_pos++];
+	}
+	if(tx_pos < tx_size) 	uart->IER |= UART_IER_THRE;
+	else 					uart->IER &= ~UART_IER_THRE;
+}
+
+void DnxBus::discardInput() const{
+	while(uart != NULL && (uart->LSR & UART_LSR_RDR)) (void)uart->RBR;
+}
+#endif
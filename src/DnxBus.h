@@ -0,0 +1,215 @@
+/*
+
+DnxBus Class: Batched instruction packets for a Dynamixel serial bus
+===========================================================================================
+
+FUNCTIONALITY:
+	1. Corresponds to one serial bus of servos, i.e. one DnxHAL object in the servo_map. Knows the protocol of the bus:
+		DNX_PROTOCOL_1 (1.0) for AX-12 and DNX_PROTOCOL_2 (2.0) for XL-320
+	2. Between beginSync() and endSync() ServoJoint::setGoalPosition() only queues the goal in the bus of the servo.
+		endSync() sends a single SYNC_WRITE packet per bus with the goals of all queued servos instead of one WRITE_DATA
+		packet per servo
+	3. Encodes instruction packets of both protocol versions (header, length, checksum/CRC-16, byte stuffing) so that
+		other instructions can be batched the same way
+	4. Counts the bytes sent and the bytes the same goals would have needed as single WRITE_DATA packets
+	5. Coordinated motion (setSyncMode(DNX_SYNC_STAGED)): the goals are staged with one REG_WRITE packet per servo and
+		started with one broadcast ACTION per bus once every bus has sent its REG_WRITEs, so all servos of all buses start
+		moving at the same instant
+	6. Telemetry: readTelemetry() reads present position, load, voltage and temperature of every servo attached to the
+		bus and publishes them in a Telemetry snapshot. XL-320 buses (2.0) use one SYNC_READ for all servos; the AX-12
+		has no SYNC_READ/BULK_READ, so 1.0 buses use one READ_DATA per servo for the whole register block instead of one
+		getValue() per register
+	7. Transmission does not block: endSync() starts the packets of all buses and returns, so every UART sends at the
+		same time while the CPU goes on with the next computation
+
+-------------------------------------------------------------------------------------------
+
+FRAMEWORK:
+	1. A DnxBus registers itself on construction under its DnxHAL pointer. ServoJoint finds its bus with find() at
+		construction, so the buses must be created before the Robot. Servos without a bus are always written directly
+	2. beginSync()/endSync() nest - only the outermost endSync() sends the packets. A full queue is sent immediately.
+		Queuing a servo that is already queued first sends everything queued so far, so no goal is lost and the order of
+		the writes is kept. sendPending() does the same explicitly - needed before a wait() inside a sync
+	3. The libdnx objects do not expose raw transmission, so the packets are written to the registers of the UART that
+		the DnxHAL opened on its pins. No second serial object is opened: the baud rate and the format stay those of
+		libdnx, and txIrq() is added to the interrupt chain of the UART behind the libdnx handler. The bytes sent come
+		back on the single wire and are discarded by waitIdle(), so the next libdnx call finds an empty receive FIFO.
+		Broadcast packets get no status packet back, so the DnxHAL reads are not disturbed
+	4. Goal positions are converted with the AX-12/XL-320 mapping: 1024 units over 300 degrees, 512 at the center
+	5. In SIMULATION the packets go to the simulated line of the DnxHAL (SimDnxHAL.h), which executes them and accounts
+		for their wire time
+	6. LPC1768 only - the UART is found by the TX pin. The packet is fed to the UART FIFO from the THRE interrupt and is
+		sent once TEMT is set, i.e. when its last byte has left the shift register
+	7. Packets are double buffered: the next packet is encoded while the previous one is sent and waits only before it
+		is started. Anything else written to the same UART must call waitIdle() first - ServoJoint does it before every
+		direct DnxHAL call. waitIdle() sleeps while the interrupt feeds the FIFO instead of spinning
+	8. REG_WRITE gets no status packet with status return level 1 (set by every ServoJoint), so the REG_WRITEs of a bus
+		are sent back to back in one transmission
+	9. ServoJoint attaches every servo to its bus, which is the list of servos readTelemetry() reads. Reads block until
+		every status packet arrives or DNX_BUS_TIMEOUT_US passes without a byte. In SIMULATION the status packets come from the
+		simulated servos and a missing one costs the simulated timeout
+	10. Between beginSync() and endSync() ServoJoint::setGoalVelocity() is queued as well. The moving speeds of a bus go out in one SYNC_WRITE right
+		before its goals, so every servo already has the speed of the goal it receives
+
+-------------------------------------------------------------------------------------------
+
+*/
+
+#ifndef DNXBUS_H
+#define DNXBUS_H
+
+#include <stdint.h>
+
+#include "wkq.h"
+#include "Trace.h"
+#include "Telemetry.h"
+#include "Airtime.h"
+#include "PhaseTimer.h"
+
+#ifndef SIMULATION
+#include "mbed.h"
+#include "InterruptManager.h"
+#include "../libdnx/DnxHAL.h"
+#else
+class DnxHAL;
+#endif
+
+#define DNX_BUS_MAX_BUSES 		4
+#define DNX_BUS_MAX_SERVOS 		18 			// servos per bus; a full queue is flushed
+#define DNX_BUS_MAX_PACKET 		128
+#define DNX_BUS_TIMEOUT_US 		2000 		// status packet timeout between two bytes
+
+#define DNX_ID_BROADCAST 		0xFE
+#define DNX_INS_READ_DATA 		0x02
+#define DNX_INS_WRITE_DATA 		0x03
+#define DNX_INS_REG_WRITE 		0x04
+#define DNX_INS_ACTION 			0x05
+#define DNX_INS_SYNC_WRITE 		0x83
+#define DNX_INS_SYNC_READ 		0x82 		// 2.0 only
+#define DNX_INS_STATUS 			0x55 		// 2.0 status packet
+#define DNX_ADDR_GOAL_POSITION 	30 			// same address on AX-12 and XL-320
+#define DNX_ADDR_MOVING_SPEED 	32 			// same address on AX-12 and XL-320
+
+enum DnxProtocol_t{
+	DNX_PROTOCOL_1 	= 1,
+	DNX_PROTOCOL_2 	= 2
+};
+
+enum DnxSyncMode_t{
+	DNX_SYNC_WRITE 		= 0, 		// one SYNC_WRITE per bus
+	DNX_SYNC_STAGED 	= 1 		// REG_WRITE per servo, then one broadcast ACTION per bus
+};
+
+
+class DnxBus{
+
+public:
+
+#ifndef SIMULATION
+	DnxBus(DnxHAL* hal_in, PinName tx, int baud_in, DnxProtocol_t protocol_in); 	// tx - TX pin of the DnxHAL
+#else
+	DnxBus(DnxHAL* hal_in, DnxProtocol_t protocol_in);
+#endif
+	~DnxBus();
+
+	static DnxBus* find(const DnxHAL* hal_in); 		// bus registered for a DnxHAL or NULL
+
+	/* ------------------------------------ SYNC WRITE ----------------------------------- */
+
+	static void beginSync();						// Queue goal positions instead of writing them
+	static void endSync();							// Send one SYNC_WRITE per bus with the queued goals
+	static bool syncActive();
+	static void sendPending();						// Send everything queued so far and stay in the sync
+	static void setSyncMode(DnxSyncMode_t mode); 	// Applies to every sync; change it outside a sync only
+
+	void queueGoalPosition(int ID, double angle); 	// angle in radians
+	void queueGoalRaw(int ID, int raw);
+	void queueMovingSpeed(int ID, int raw);
+	void flush();									// Start sending the queued goals of this bus in the sync mode
+
+	// Airtime of a direct DnxHAL call: a write of write_bytes, a read of read_bytes with its status packet or an ACTION
+	void countDirect(int write_bytes, int read_bytes=0);
+
+	bool busy() const;								// A packet is being sent
+	void waitIdle();								// Sleep until the last packet is sent
+
+	/* ------------------------------------ TELEMETRY ----------------------------------- */
+
+	void attachServo(int ID);						// Servo read by readTelemetry()
+	static void readTelemetry(Telemetry& telemetry);	// Read the servos of all buses
+	int readBusTelemetry(Telemetry& telemetry);		// Read the servos of this bus; returns the servos that answered
+	/* ------------------------------------ PACKETS ----------------------------------- */
+
+	static int positionToRaw(double angle);
+
+	// Complete instruction packet in buf; returns its size in bytes
+	static int encodePacket(DnxProtocol_t protocol, uint8_t ID, uint8_t instruction, const uint8_t* params, int param_count, uint8_t* buf);
+	static int encodeSyncWrite(DnxProtocol_t protocol, int address, int data_size, const uint8_t* IDs, const int* values, int count, uint8_t* buf);
+	// First valid packet in buf: returns the bytes up to its end or 0 if there is none. Status packets decode with the
+	// error byte as instruction (1.0) or the error byte as first parameter (2.0)
+	static int decodePacket(DnxProtocol_t protocol, const uint8_t* buf, int size, uint8_t* ID, uint8_t* instruction, uint8_t* params, int* param_count);
+	// Finds a valid status packet of ID with data_size bytes of data in buf and copies the data and the error byte
+	static bool decodeStatus(DnxProtocol_t protocol, const uint8_t* buf, int size, uint8_t ID, uint8_t* data, int data_size, uint8_t* error);
+
+	/* ------------------------------------ STATISTICS ----------------------------------- */
+
+	unsigned long bytesSent() const;
+	unsigned long bytesUnbatched() const;			// bytes the same goals need as single WRITE_DATA packets
+	void printStats() const;
+
+private:
+
+	void sendSpeeds();								// SYNC_WRITE the queued moving speeds
+	void stage();									// REG_WRITE the queued goals
+	void sendAction();								// Broadcast ACTION for the staged goals
+	void transmit(const uint8_t* buf, int size);
+	int statusSize(int data_size) const;
+	bool receiveStatus(uint8_t ID, uint8_t* data, int data_size, uint8_t* error);
+	void publishTelemetry(Telemetry& telemetry, uint8_t ID, const uint8_t* data, uint8_t error) const;
+#ifndef SIMULATION
+	void txIrq();
+	void discardInput() const;						// Drop the bytes in the receive FIFO
+#endif
+
+	static uint16_t crc16(const uint8_t* buf, int size);
+
+	DnxHAL* hal;
+	DnxProtocol_t protocol;
+	int baud;
+#ifndef SIMULATION
+	LPC_UART_TypeDef* uart; 						// UART of the DnxHAL, configured by libdnx
+	IRQn_Type uart_irq;
+	pFunctionPointer_t tx_handler; 				// txIrq() in the interrupt chain of the UART
+#endif
+
+	uint8_t tx_buffers[2][DNX_BUS_MAX_PACKET];
+	int tx_next;									// buffer the next packet is encoded in
+	volatile bool tx_busy;
+	const uint8_t* volatile tx_data;
+	volatile int tx_pos;
+	volatile int tx_size;
+	double tx_end; 									// Airtime::now() when the last packet is off the wire
+
+	uint8_t queued_IDs[DNX_BUS_MAX_SERVOS];
+	int queued_values[DNX_BUS_MAX_SERVOS];
+	int queued;
+	uint8_t speed_IDs[DNX_BUS_MAX_SERVOS]; 			// moving speeds, sent before the goals of the same flush()
+	int speed_values[DNX_BUS_MAX_SERVOS];
+	int speeds_queued;
+	bool staged;									// REG_WRITEs sent and not yet started with ACTION
+
+	uint8_t servo_IDs[DNX_BUS_MAX_SERVOS];			// servos attached to the bus
+	int servo_count;
+
+	unsigned long bytes_sent;
+	unsigned long bytes_unbatched;
+	unsigned long packets_sent;
+
+	static DnxBus* buses[DNX_BUS_MAX_BUSES];
+	static int bus_count;
+	static int sync_depth;
+	static DnxSyncMode_t sync_mode;
+
+};
+
+#endif
@@ -0,0 +1,76 @@
+#include "Fixed.h"
+
+/*  @ Notes:
+	The transcendental functions call fx::init() so that Fixed needs no separate initialisation
+
+	Conversions between Q16.16 and the q31 representations of fixed_math.h
+	- radians to q31 angle: raw * 2^15 / PI = (raw * (2^32 / PI)) >> 17, wrapped modulo 2*PI
+	- q31 angle to radians: angle * PI / 2^15 = (angle * (PI * 2^16)) >> 31
+	- ratio in [-1, 1] to q31: raw << 15, saturated
+*/
+static const int64_t RAD_TO_ANGLE = 1367130551; 			// 2^32 / PI
+static const int64_t ANGLE_TO_RAD = 205887; 				// PI * 2^16
+
+static inline q31_t toAngle(wkq::Fixed x){
+	return (q31_t)(uint32_t)(((int64_t)x.getRaw() * RAD_TO_ANGLE) >> 17);
+}
+
+static inline wkq::Fixed fromAngle(q31_t angle){
+	return wkq::Fixed::fromRaw((int32_t)(((int64_t)angle * ANGLE_TO_RAD) >> 31));
+}
+
+static inline q31_t toRatio(wkq::Fixed x){
+	return wkq::fx::saturate((q63_t)x.getRaw() << 15);
+}
+
+static inline wkq::Fixed fromRatio(q31_t ratio){
+	return wkq::Fixed::fromRaw(ratio >> 15);
+}
+
+
+wkq::Fixed wkq::sqrt(Fixed x){
+	if(x.getRaw() <= 0) return Fixed();
+
+	// isqrt(raw * 2^16) has 16 fractional bits
+	uint64_t op = (uint64_t)x.getRaw() << 16;
+	uint64_t res = 0;
+	uint64_t one = (uint64_t)1 << 62;
+
+	while(one > op) one >>= 2;
+	while(one != 0){
+		if(op >= res + one){
+			op -= res + one;
+			res = (res >> 1) + one;
+		}
+		else res >>= 1;
+		one >>= 2;
+	}
+	return Fixed::fromRaw((int32_t)res);
+}
+
+wkq::Fixed wkq::sin(Fixed x){
+	fx::init();
+	return fromRatio(fx::sin(toAngle(x)));
+}
+
+wkq::Fixed wkq::cos(Fixed x){
+	fx::init();
+	return fromRatio(fx::cos(toAngle(x)));
+}
+
+// acos() is in [0, PI] so its q31 angle is read as unsigned
+wkq::Fixed wkq::acos(Fixed x){
+	fx::init();
+	uint32_t angle = (uint32_t)fx::acos(toRatio(x));
+	return Fixed::fromRaw((int32_t)(((uint64_t)angle * ANGLE_TO_RAD) >> 31));
+}
+
+wkq::Fixed wkq::asin(Fixed x){
+	fx::init();
+	return fromAngle(fx::asin(toRatio(x)));
+}
+
+wkq::Fixed wkq::atan2(Fixed y, Fixed x){
+	fx::init();
+	return fromAngle(fx::atan2(y.getRaw(), x.getRaw()));
+}
@@ -0,0 +1,110 @@
+/*
+
+Fixed Class: Q16.16 fixed-point scalar that can be used in place of float/double in the templated geometry core
+===========================================================================================
+
+FUNCTIONALITY:
+	1. Stores the value in a 32-bit integer with 16 fractional bits: range +-32768, resolution 1.5e-5. Lengths in cm,
+		their squares and angles in radians all fit, so the templated algorithms need no rescaling
+	2. Provides the arithmetic and comparison operators plus sqrt, sin, cos, acos, asin, atan2, fabs and pow that the
+		geometry core uses. The transcendental functions are computed in q31 through fixed_math.h
+	3. Implicitly constructed from double so that constants in the generic code just work. Conversion back to double
+		is explicit
+	4. For precision comparisons only: on the host Fixed is an order of magnitude slower than double (bin/precision
+		measures 5-25 times). The x86 FPU makes double cheap, while every Fixed transcendental converts to q31 and
+		back and every multiplication and division goes through 64-bit integers
+
+-------------------------------------------------------------------------------------------
+
+*/
+
+#ifndef FIXED_H
+#define FIXED_H
+
+#include <cmath>
+#include "fixed_math.h"
+
+namespace wkq{
+
+	// Declaring the Fixed overloads in wkq hides the standard ones from unqualified calls inside the namespace
+	using std::sqrt;
+	using std::sin;
+	using std::cos;
+	using std::acos;
+	using std::asin;
+	using std::atan2;
+	using std::fabs;
+	using std::pow;
+
+	class Fixed{
+
+	public:
+		Fixed() : raw(0) {}
+		Fixed(double value) : raw((int32_t)(value * 65536.0 + ((value >= 0.0) ? 0.5 : -0.5))) {}
+
+		static Fixed fromRaw(int32_t raw_in){
+			Fixed out;
+			out.raw = raw_in;
+			return out;
+		}
+
+		explicit operator double() const{
+			return raw / 65536.0;
+		}
+
+		int32_t getRaw() const{
+			return raw;
+		}
+
+		/* ------------------------------------ ARITHMETIC ----------------------------------- */
+
+		friend Fixed operator+(Fixed a, Fixed b){ return fromRaw(a.raw + b.raw); }
+		friend Fixed operator-(Fixed a, Fixed b){ return fromRaw(a.raw - b.raw); }
+		friend Fixed operator*(Fixed a, Fixed b){ return fromRaw((int32_t)(((int64_t)a.raw * b.raw) >> 16)); }
+		friend Fixed operator/(Fixed a, Fixed b){
+			if(b.raw == 0) return fromRaw((a.raw >= 0) ? fx::Q31_MAX : fx::Q31_MIN);
+			return fromRaw((int32_t)(((int64_t)a.raw << 16) / b.raw));
+		}
+		Fixed operator-() const{ return fromRaw(-raw); }
+
+		Fixed& operator+=(Fixed b){ raw += b.raw; return *this; }
+		Fixed& operator-=(Fixed b){ raw -= b.raw; return *this; }
+		Fixed& operator*=(Fixed b){ *this = *this * b; return *this; }
+		Fixed& operator/=(Fixed b){ *this = *this / b; return *this; }
+
+		/* ------------------------------------ COMPARISON ----------------------------------- */
+
+		friend bool operator==(Fixed a, Fixed b){ return a.raw == b.raw; }
+		friend bool operator!=(Fixed a, Fixed b){ return a.raw != b.raw; }
+		friend bool operator<(Fixed a, Fixed b){ return a.raw < b.raw; }
+		friend bool operator>(Fixed a, Fixed b){ return a.raw > b.raw; }
+		friend bool operator<=(Fixed a, Fixed b){ return a.raw <= b.raw; }
+		friend bool operator>=(Fixed a, Fixed b){ return a.raw >= b.raw; }
+
+	private:
+		int32_t raw;
+	};
+
+
+	/* ------------------------------------ MATH FUNCTIONS ----------------------------------- */
+
+	Fixed sqrt(Fixed x);
+	Fixed sin(Fixed x);
+	Fixed cos(Fixed x);
+	Fixed acos(Fixed x);
+	Fixed asin(Fixed x);
+	Fixed atan2(Fixed y, Fixed x);
+
+	inline Fixed fabs(Fixed x){
+		return (x.getRaw() >= 0) ? x : -x;
+	}
+
+	inline Fixed pow(Fixed x, int exp){
+		Fixed out(1.0);
+		for(int i=0; i<exp; i++) out *= x;
+		return out;
+	}
+
+}
+
+#endif
@@ -0,0 +1,101 @@
+#include "GaitCache.h"
+
+#include <cstring>
+
+GaitCache::GaitCache() : params_valid(false), clock(0), hits_(0), misses_(0){
+	invalidate();
+}
+
+GaitCache::~GaitCache(){}
+
+
+int GaitCache::quantize(double coeff){
+	return (int)floor(coeff * GAIT_CACHE_COEFF_STEPS + 0.5);
+}
+
+double GaitCache::dequantize(int coeff_q){
+	return coeff_q / (double)GAIT_CACHE_COEFF_STEPS;
+}
+
+
+void GaitCache::validate(const BodyParams& params_in){
+	if(params_valid && memcmp(&params, &params_in, sizeof(BodyParams)) == 0) return;
+
+	invalidate();
+	params = params_in;
+	params_valid = true;
+}
+
+void GaitCache::invalidate(){
+	for(int i=0; i<GAIT_CACHE_SLOTS; i++){
+		slots[i].recorded = false;
+		slots[i].last_used = 0;
+	}
+}
+
+
+const GaitHalfCycle* GaitCache::find(wkq::RobotMovement_t movement, int coeff_q, int tripod_up,
+										const TripodSnapshot& entry_up, const TripodSnapshot& entry_down){
+	clock++;
+	for(int i=0; i<GAIT_CACHE_SLOTS; i++){
+		GaitHalfCycle& slot = slots[i];
+		if(!slot.recorded || slot.movement != movement || slot.coeff_q != coeff_q || slot.tripod_up != tripod_up) continue;
+
+		if(equal(slot.entry_up, entry_up) && equal(slot.entry_down, entry_down)){
+			slot.last_used = clock;
+			hits_++;
+			return &slot;
+		}
+	}
+	misses_++;
+	return NULL;
+}
+
+
+/*  @ Notes:
+	A slot with the same key is always reused, so a half cycle recorded before the gait became periodic is replaced by
+	the periodic one instead of taking a second slot
+*/
+GaitHalfCycle* GaitCache::record(wkq::RobotMovement_t movement, int coeff_q, int tripod_up,
+									const TripodSnapshot& entry_up, const TripodSnapshot& entry_down){
+	GaitHalfCycle* slot = NULL;
+
+	for(int i=0; i<GAIT_CACHE_SLOTS && slot == NULL; i++){
+		if(slots[i].recorded && slots[i].movement == movement && slots[i].coeff_q == coeff_q && slots[i].tripod_up == tripod_up)
+			slot = &slots[i];
+	}
+	if(slot == NULL){
+		slot = &slots[0];
+		for(int i=1; i<GAIT_CACHE_SLOTS; i++){
+			if(slots[i].last_used < slot->last_used) slot = &slots[i];
+		}
+	}
+
+	slot->recorded 		= false;
+	slot->movement 		= movement;
+	slot->coeff_q 		= coeff_q;
+	slot->tripod_up 	= tripod_up;
+	slot->entry_up 		= entry_up;
+	slot->entry_down 	= entry_down;
+	slot->last_used 	= clock;
+	return slot;
+}
+
+void GaitCache::commit(GaitHalfCycle* half_cycle){
+	half_cycle->recorded = true;
+}
+
+
+unsigned int GaitCache::hits() const{
+	return hits_;
+}
+
+unsigned int GaitCache::misses() const{
+	return misses_;
+}
+
+
+// Bitwise comparison: the recorded states come from the same computations, so a periodic gait repeats them exactly
+bool GaitCache::equal(const TripodSnapshot& a, const TripodSnapshot& b){
+	return memcmp(&a, &b, sizeof(TripodSnapshot)) == 0;
+}
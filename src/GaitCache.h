@@ -0,0 +1,99 @@
+/*
+
+GaitCache Class: Replays the steady-state cycles of a gait instead of recomputing them
+===========================================================================================
+
+FUNCTIONALITY:
+	1. A walking gait in Robot::makeMovement() is periodic once it is started: every iteration lifts the up Tripod, moves
+		the body with the down Tripod and puts the up Tripod down with a step, then the Tripods swap roles. Two iterations
+		(one per Tripod lifted) make up a full cycle
+	2. The first time a half cycle is computed its complete result - the state of the Legs after liftUp, after the body
+		movement and after the step - is recorded. On later cycles the recorded states are written to the servos and
+		loaded back in the Legs without any kinematics computation
+	3. Keyed by RobotMovement_t, the coefficient quantized to 1/GAIT_CACHE_COEFF_STEPS and the Tripod that is lifted
+
+-------------------------------------------------------------------------------------------
+
+FRAMEWORK:
+	1. A half cycle is replayed only if the Legs of both Tripods enter it in exactly the state they had when it was
+		recorded. This covers the start of the gait (the first half cycles are not yet periodic and keep getting
+		re-recorded until they are) and any change of the body height or of a Leg pose between movements
+	2. validate() 		- 	must be called before the cache is used. Drops every entry if BodyParams changed since
+							the last call
+	3. invalidate() 	- 	drops every entry. Robot calls it whenever the body height is changed
+	4. The caller must quantize the coefficient with quantize()/dequantize() and compute the gait with the dequantized
+		value, otherwise a replayed cycle would not match a computed one
+	5. Memory is static: GAIT_CACHE_SLOTS half cycles, the least recently used one is replaced
+
+-------------------------------------------------------------------------------------------
+
+*/
+
+#ifndef GAITCACHE_H
+#define GAITCACHE_H
+
+#include "wkq.h"
+#include "Tripod.h"
+
+#define GAIT_CACHE_SLOTS 			4 		// half cycles, i.e. 2 full gait cycles
+#define GAIT_CACHE_COEFF_STEPS 		100		// coefficient resolution
+
+enum GaitPhase_t{
+	GP_LIFT_UP 		= 0, 		// state of the up Tripod after liftUp()
+	GP_BODY_MOVE 	= 1, 		// state of the down Tripod after the body movement
+	GP_STEP 		= 2, 		// state of the up Tripod after the step
+	GP_COUNT 		= 3
+};
+
+struct GaitHalfCycle{
+	wkq::RobotMovement_t movement;
+	int coeff_q;
+	int tripod_up;
+
+	TripodSnapshot entry_up;				// states the Tripods must be in for the half cycle to be replayed
+	TripodSnapshot entry_down;
+	TripodSnapshot phases[GP_COUNT];
+
+	bool recorded;
+	unsigned int last_used;
+};
+
+
+class GaitCache{
+
+public:
+	GaitCache();
+	~GaitCache();
+
+	static int quantize(double coeff);
+	static double dequantize(int coeff_q);
+
+	void validate(const BodyParams& params);
+	void invalidate();
+
+	// Recorded half cycle for the key whose entry states match, or NULL
+	const GaitHalfCycle* find(wkq::RobotMovement_t movement, int coeff_q, int tripod_up,
+								const TripodSnapshot& entry_up, const TripodSnapshot& entry_down);
+
+	// Slot to record a half cycle in. Phases are filled by the caller, then commit() makes it available to find()
+	GaitHalfCycle* record(wkq::RobotMovement_t movement, int coeff_q, int tripod_up,
+								const TripodSnapshot& entry_up, const TripodSnapshot& entry_down);
+	void commit(GaitHalfCycle* half_cycle);
+
+	unsigned int hits() const;
+	unsigned int misses() const;
+
+private:
+
+	static bool equal(const TripodSnapshot& a, const TripodSnapshot& b);
+
+	GaitHalfCycle slots[GAIT_CACHE_SLOTS];
+	BodyParams params;
+	bool params_valid;
+
+	unsigned int clock;					// incremented on every lookup, used for the LRU replacement
+	unsigned int hits_;
+	unsigned int misses_;
+};
+
+#endif
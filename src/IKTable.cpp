@@ -0,0 +1,139 @@
+#include "IKTable.h"
+
+/* ================================================= IKTable ================================================= */
+
+IKTable::IKTable() : fn(NULL), params(NULL), interp(IT_CUBIC), x_min(0.0f), x_max(0.0f), step_inv(0.0f), max_error(0.0) {}
+
+IKTable::~IKTable(){}
+
+
+void IKTable::build(IKFn_t fn_in, const BodyParams& robot_params, double x_min_in, double x_max_in, Interp_t interp_in /*=IT_CUBIC*/){
+	fn 		= fn_in;
+	params 	= &robot_params;
+	interp 	= interp_in;
+	x_min 	= x_min_in;
+	x_max 	= x_max_in;
+
+	double step = (x_max_in - x_min_in) / (IK_TABLE_SIZE - 1);
+	step_inv = (float)(1.0 / step);
+
+	for(int i=0; i<IK_TABLE_SIZE; i++){
+		nodes[i] = fn(x_min_in + i*step, *params);
+	}
+
+	// Measure the interpolation error between the nodes
+	max_error = 0.0;
+	for(int i=0; i<IK_TABLE_SIZE-1; i++){
+		for(int j=1; j<=IK_TABLE_PROBES; j++){
+			double x = x_min_in + (i + j/(IK_TABLE_PROBES + 1.0)) * step;
+			double error = fabs(interpolate(x) - fn(x, *params));
+			if(error > max_error) max_error = error;
+		}
+	}
+}
+
+
+double IKTable::lookup(double x) const{
+	if(x < x_min || x > x_max) return fn(x, *params);
+	return interpolate((float)x);
+}
+
+double IKTable::exact(double x) const{
+	return fn(x, *params);
+}
+
+double IKTable::maxError() const{
+	return max_error;
+}
+
+
+/*  @ Notes:
+	Input must be inside [x_min, x_max]
+*/
+float IKTable::interpolate(float x) const{
+	float pos = (x - x_min) * step_inv;
+	int idx = (int)pos;
+	if(idx > IK_TABLE_SIZE-2) idx = IK_TABLE_SIZE-2;
+	float t = pos - idx;
+
+	float p1 = nodes[idx];
+	float p2 = nodes[idx+1];
+
+	if(interp == IT_LINEAR) return p1 + t*(p2 - p1);
+
+	// Catmull-Rom spline; missing end nodes are extrapolated linearly
+	float p0 = (idx > 0) ? nodes[idx-1] : 2*p1 - p2;
+	float p3 = (idx < IK_TABLE_SIZE-2) ? nodes[idx+2] : 2*p2 - p1;
+
+	return p1 + 0.5f*t*( (p2 - p0) + t*( (2*p0 - 5*p1 + 4*p2 - p3) + t*(3*(p1 - p2) + p3 - p0) ) );
+}
+
+
+/* ================================================= IKTables ================================================= */
+
+void IKTables::build(const BodyParams& robot_params){
+	params = robot_params;
+	const double lim = IK_TABLE_ACOS_LIMIT;
+
+#ifdef DOF3
+	double hip_to_end_min = sqrt(params.FEMUR_SQ + params.TIBIA_SQ - 2*params.FEMUR*params.TIBIA*lim);
+	double hip_to_end_max = sqrt(params.FEMUR_SQ + params.TIBIA_SQ + 2*params.FEMUR*params.TIBIA*lim);
+
+	knee.build(&kneeFromHipToEnd, params, hip_to_end_min, hip_to_end_max);
+	hip.build(&hipFromHipToEnd, params, hip_to_end_min, hip_to_end_max);
+	acos_ratio.build(&acosRatio, params, 0.0, lim);
+	center_hip.build(&hipFromHeight, params, params.MIN_HEIGHT, params.MAX_HEIGHT);
+#else
+	double height_max = (params.MAX_HEIGHT < lim*params.TIBIA) ? params.MAX_HEIGHT : lim*params.TIBIA;
+
+	knee.build(&kneeFromHipGroundToEf, params, params.FEMUR - lim*params.TIBIA, params.FEMUR + lim*params.TIBIA);
+	center_knee.build(&kneeFromHeight, params, params.MIN_HEIGHT, height_max);
+#endif
+}
+
+
+void IKTables::print(){
+#ifdef DOF3
+	printf("IKTables: knee max error(degrees) %f\n\r", wkq::degrees(knee.maxError()));
+	printf("IKTables: hip max error(degrees) %f\n\r", wkq::degrees(hip.maxError()));
+	printf("IKTables: acos_ratio max error(degrees) %f\n\r", wkq::degrees(acos_ratio.maxError()));
+	printf("IKTables: center_hip max error(degrees) %f\n\r", wkq::degrees(center_hip.maxError()));
+#else
+	printf("IKTables: knee max error(degrees) %f\n\r", wkq::degrees(knee.maxError()));
+	printf("IKTables: center_knee max error(degrees) %f\n\r", wkq::degrees(center_knee.maxError()));
+#endif
+}
+
+
+/* ------------------------------------------------- EXACT MAPPINGS ------------------------------------------------- */
+
+#ifdef DOF3
+// Same as State_t::configureAngles()
+double IKTables::kneeFromHipToEnd(double hip_to_end, const BodyParams& params){
+	return wkq::PI - acos( (params.FEMUR_SQ + params.TIBIA_SQ - pow(hip_to_end,2)) / (2 * params.FEMUR * params.TIBIA) );
+}
+
+double IKTables::hipFromHipToEnd(double hip_to_end, const BodyParams& params){
+	return (wkq::PI)/2 - acos( (params.FEMUR_SQ + pow(hip_to_end,2) - params.TIBIA_SQ) / (2 * params.FEMUR * hip_to_end) );
+}
+
+double IKTables::acosRatio(double ratio, const BodyParams&){
+	return acos(ratio);
+}
+
+// Same as State_t::centerLeg()
+double IKTables::hipFromHeight(double height, const BodyParams& params){
+	return asin( (height - params.TIBIA) / params.FEMUR );
+}
+
+#else
+// Same as State_t::configureAngles()
+double IKTables::kneeFromHipGroundToEf(double hip_ground_to_ef, const BodyParams& params){
+	return wkq::PI/2 - asin( (hip_ground_to_ef - params.FEMUR) / params.TIBIA );
+}
+
+// Same as State_t::centerLeg()
+double IKTables::kneeFromHeight(double height, const BodyParams& params){
+	return wkq::PI/2 - acos( height / params.TIBIA );
+}
+#endif
@@ -0,0 +1,112 @@
+/*
+
+IKTable Class: Precomputed interpolated lookup table for a single IK mapping
+===========================================================================================
+
+FUNCTIONALITY:
+	1. Samples an exact IK function of one variable at IK_TABLE_SIZE uniformly spaced nodes when built from BodyParams
+	2. lookup() replaces the asin/acos/sqrt chain with an index computation and a linear or cubic (Catmull-Rom)
+		interpolation between the stored nodes
+	3. Inputs outside the table domain fall back to the exact function, so a table never returns garbage
+	4. The max interpolation error is measured when the table is built (4 probes per interval against the exact function)
+		and is available through maxError(). IKTables::print() reports it for every table. With the current BodyParams
+		all tables stay below 0.1 degrees, i.e. under the 0.29 degree resolution of the AX-12
+
+-------------------------------------------------------------------------------------------
+
+FRAMEWORK:
+	1. Selected at build time with IK_TABLES (make IK_TABLES=1). State_t then uses the tables in configureAngles()
+		and centerLeg() instead of the exact computation
+	2. Acos-based mappings are tabulated only for arguments in [-IK_TABLE_ACOS_LIMIT, IK_TABLE_ACOS_LIMIT], i.e. joint
+		angles at least 10 degrees away from a fully stretched or folded leg. The rest use the exact function
+	3. Nodes are stored as float to keep each table at 1 KB. The interpolation computes in float as well - the
+		FPU-less Cortex-M3 would otherwise convert every node to double and interpolate in soft double. The domain
+		check and the exact fallback stay double, so an input just outside the table is not rounded into it
+
+-------------------------------------------------------------------------------------------
+
+*/
+
+#ifndef IKTABLE_H
+#define IKTABLE_H
+
+#include "robot_types.h"
+
+#define IK_TABLE_SIZE 		256
+#define IK_TABLE_PROBES 	4
+
+const double IK_TABLE_ACOS_LIMIT = 0.984807753; 	// cos(10 degrees)
+
+typedef double (*IKFn_t)(double x, const BodyParams& params);
+
+
+class IKTable{
+
+public:
+	enum Interp_t{
+		IT_LINEAR 	= 0,
+		IT_CUBIC 	= 1
+	};
+
+	IKTable();
+	~IKTable();
+
+	void build(IKFn_t fn_in, const BodyParams& robot_params, double x_min_in, double x_max_in, Interp_t interp_in = IT_CUBIC);
+
+	double lookup(double x) const;
+	double exact(double x) const;
+	double maxError() const;
+
+private:
+	float interpolate(float x) const;
+
+	IKFn_t fn;
+	const BodyParams* params;
+	Interp_t interp;
+
+	float x_min;
+	float x_max;
+	float step_inv;
+	double max_error;
+
+	float nodes[IK_TABLE_SIZE];
+};
+
+
+/*
+	Tables needed by State_t in IK_TABLES mode
+*/
+struct IKTables{
+
+	void build(const BodyParams& robot_params);
+	void print();
+
+	/* ------------------------------------ EXACT MAPPINGS ----------------------------------- */
+
+#ifdef DOF3
+	static double kneeFromHipToEnd(double hip_to_end, const BodyParams& params);
+	static double hipFromHipToEnd(double hip_to_end, const BodyParams& params); 	// Without the height term
+	static double acosRatio(double ratio, const BodyParams&);			// Height term: acos(height/hip_to_end)
+	static double hipFromHeight(double height, const BodyParams& params);		// Centered leg
+#else
+	static double kneeFromHipGroundToEf(double hip_ground_to_ef, const BodyParams& params);
+	static double kneeFromHeight(double height, const BodyParams& params);		// Centered leg
+#endif
+
+	/* ------------------------------------ TABLES ----------------------------------- */
+
+#ifdef DOF3
+	IKTable knee;
+	IKTable hip;
+	IKTable acos_ratio;
+	IKTable center_hip;
+#else
+	IKTable knee;
+	IKTable center_knee;
+#endif
+
+	BodyParams params;
+};
+
+
+#endif
@@ -0,0 +1,346 @@
+/*
+
+Kinematics: Scalar-templated geometry core of State_t and Leg
+===========================================================================================
+
+FUNCTIONALITY:
+	1. Holds the exact IK equations of State_t::configureAngles(), State_t::centerLeg() and the Leg walking algorithms
+		as static functions templated on the scalar type T
+	2. State_t and Leg call the wkq::real_t instantiation, i.e. double by default and float with SINGLE_PRECISION.
+		Instantiations for other types (wkq::Fixed) are used to compare precisions side by side - see bin/precision
+	3. Does not maintain any state. Functions read BodyParams and DynamicVars and write LegAngles; new distances are
+		returned to the caller, which is responsible for updating the State_t through its typed setters
+	4. Analytic Jacobian of the END EFFECTOR position with respect to the joint angles and its inverse, used to turn
+		an END EFFECTOR velocity into joint velocities for velocity-mode servo commands
+
+-------------------------------------------------------------------------------------------
+
+FRAMEWORK:
+	1. Same as State_t and Leg - computations are valid for a LEFT LEG only
+	2. Jacobian frame: origin at the leg mount point, x and y horizontal with y the walking direction of 
+		bodyForward() and z pointing up. Forward kinematics of the LEFT LEG in this frame:
+			DOF3 - 	psi = PI/2 - angle_offset - arm
+					rho = COXA + FEMUR*cos(hip) + TIBIA*cos(hip + knee), h = FEMUR*sin(hip) + TIBIA*sin(hip + knee)
+					ef 	= ( rho*cos(psi), rho*sin(psi), -h )
+			DOF2 - 	psi = PI/2 - angle_offset + hip
+					rho = FEMUR + TIBIA*cos(knee), h = TIBIA*sin(knee)
+					ef 	= ( rho*cos(psi), rho*sin(psi), -h )
+	3. DOF2 has only 2 joints: jointVelocities() then tracks the horizontal velocity only and the vertical velocity 
+		follows from the knee motion
+	4. Math functions are called unqualified so that overloads for the scalar type are found (std for float and
+		double, wkq for wkq::Fixed). Constants are converted to T to keep float arithmetic in single precision
+
+-------------------------------------------------------------------------------------------
+
+*/
+
+#ifndef KINEMATICS_H
+#define KINEMATICS_H
+
+#include <cmath>
+#include "wkq.h"
+#include "robot_types.h"
+
+
+/*
+	Columns of the Jacobian: d(ef)/d(joint angle) for each joint, in the frame described above
+*/
+template<typename T>
+struct JacobianT{
+	T knee[3];
+	T hip[3];
+#ifdef DOF3
+	T arm[3];
+#endif
+};
+
+
+template<typename T>
+struct Kinematics{
+
+	/* ------------------------------------ STATE ----------------------------------- */
+
+	static void configureAngles(const BodyParamsT<T>& params, const DynamicVarsT<T>& vars, LegAnglesT<T>& angles);
+	static void centerAngles(const BodyParamsT<T>& params, T height, LegAnglesT<T>& angles);
+
+	/* ------------------------------------ WALKING ALGORITHMS ----------------------------------- */
+
+	// DOF3 - set angles.arm and return arm_ground_to_ef; DOF2 - set angles.hip and return hip_ground_to_ef
+	static void bodyForward(T angle_offset, T step_size, const DynamicVarsT<T>& vars, LegAnglesT<T>& angles, T& dist_new, T& dist_sq_new);
+	static void bodyRotate(const BodyParamsT<T>& params, T angle, const DynamicVarsT<T>& vars,
+							LegAnglesT<T>& angles, T& dist_new, T& dist_sq_new);
+#ifndef DOF3
+	// Set angles.hip and return hip_ground_to_ef_sq
+	static T stepForward(const BodyParamsT<T>& params, T angle_offset, T step_size, const DynamicVarsT<T>& vars, LegAnglesT<T>& angles);
+	static T stepRotate(const BodyParamsT<T>& params, T angle_offset, T angle, const DynamicVarsT<T>& vars, LegAnglesT<T>& angles);
+#endif
+
+	/* ------------------------------------ VELOCITY ----------------------------------- */
+
+	static void jacobian(const BodyParamsT<T>& params, T angle_offset, const LegAnglesT<T>& angles, JacobianT<T>& jac);
+	// Joint velocities in rad/s for an END EFFECTOR velocity in cm/s. Returns false at a singular pose (straight knee),
+	// in which case the joints that cannot be resolved are given 0 velocity
+	static bool jointVelocities(const BodyParamsT<T>& params, T angle_offset, const LegAnglesT<T>& angles, 
+								T vx, T vy, T vz, LegAnglesT<T>& joint_vel);
+};
+
+
+/* ================================================= STATE ================================================= */
+
+template<typename T>
+void Kinematics<T>::configureAngles(const BodyParamsT<T>& params, const DynamicVarsT<T>& vars, LegAnglesT<T>& angles){
+	using namespace std;
+#ifdef DOF3
+	T knee_tmp, hip_tmp;
+
+	// Cosine Rule to find new Knee Servo Angle
+	knee_tmp = wkq::math::acos( (params.FEMUR_SQ + params.TIBIA_SQ - vars.hip_to_end_sq ) / ( T(2) * params.FEMUR * params.TIBIA) );
+	// Convert to actual angle for the servo
+	angles.knee = T(wkq::PI) - knee_tmp;
+
+	// Cosine Rule to find new Hip Servo Angle
+	hip_tmp = wkq::math::acos( (params.FEMUR_SQ + vars.hip_to_end_sq - params.TIBIA_SQ ) / ( T(2) * params.FEMUR * vars.hip_to_end) );
+	// Convert to actual angle for the servo
+	angles.hip = T(wkq::PI/2) - hip_tmp - wkq::math::acos(vars.height/vars.hip_to_end);
+#else
+	angles.knee = T(wkq::PI/2) - wkq::math::asin((vars.hip_ground_to_ef - params.FEMUR) / params.TIBIA );
+#endif
+}
+
+
+// Angles of a centered leg at the given height; height must already be within [MIN_HEIGHT, MAX_HEIGHT]
+template<typename T>
+void Kinematics<T>::centerAngles(const BodyParamsT<T>& params, T height, LegAnglesT<T>& angles){
+	using namespace std;
+#ifdef DOF3
+	angles.arm = T(0);
+	angles.hip = wkq::math::asin( (height - params.TIBIA) / params.FEMUR );
+	angles.knee = T(wkq::PI/2) - angles.hip;
+#else
+	angles.hip = T(0);
+	angles.knee = T(wkq::PI/2) - wkq::math::acos( height / params.TIBIA);
+#endif
+}
+
+
+/* ================================================= WALKING ALGORITHMS ================================================= */
+
+template<typename T>
+void Kinematics<T>::bodyForward(T angle_offset, T step_size, const DynamicVarsT<T>& vars, LegAnglesT<T>& angles, T& dist_new, T& dist_sq_new){
+	using namespace std;
+	T step_size_sq = step_size*step_size;
+	T rotation;
+
+#ifdef DOF3
+	// Cosine Rule to find the new arm_ground_to_ef
+	dist_sq_new = vars.arm_ground_to_ef_sq + step_size_sq - T(2) * step_size * vars.arm_ground_to_ef * wkq::math::cos(angle_offset + angles.arm);
+	dist_new = wkq::math::sqrt(dist_sq_new);
+
+	// Cosine Rule to find new angles.arm
+	rotation = wkq::math::acos( (step_size_sq + dist_sq_new - vars.arm_ground_to_ef_sq) / ( T(2) * step_size * dist_new ) );
+	// Convert to actual angle for the servo
+	angles.arm = T(wkq::PI) - angle_offset - rotation;           // NB: Valid for a LEFT servo facing down
+#else
+	// Cosine Rule to find the new hip_ground_to_ef
+	dist_sq_new = vars.hip_ground_to_ef_sq + step_size_sq - T(2) * step_size * vars.hip_ground_to_ef * wkq::math::cos(angle_offset - angles.hip);
+	dist_new = wkq::math::sqrt(dist_sq_new);
+
+	// Cosine Rule to find new angles.hip
+	rotation = wkq::math::acos( (step_size_sq + dist_sq_new - vars.hip_ground_to_ef_sq) / ( T(2) * step_size * dist_new ) );
+	// Convert to actual angle for the servo
+	angles.hip = angle_offset + rotation - T(wkq::PI);           // NB: Valid for a LEFT servo facing up
+#endif
+}
+
+
+/*
+	@param angle:
+		- positive value - CW rotation
+		- negative value - CCW rotation
+*/
+template<typename T>
+void Kinematics<T>::bodyRotate(const BodyParamsT<T>& params, T angle, const DynamicVarsT<T>& vars,
+								LegAnglesT<T>& angles, T& dist_new, T& dist_sq_new){
+	using namespace std;
+	T rot_dist, rot_dist_sq;
+	T rotation;
+	T cos_rule_arg;
+
+	// Sine Rule to find rotation distance
+	rot_dist = T(2) * params.DIST_CENTER * wkq::math::sin(fabs(angle)/T(2));
+	rot_dist_sq = rot_dist*rot_dist;
+
+#ifdef DOF3
+	// Cosine Rule to find new arm_ground_to_ef
+	if (angle >= T(0)) 	cos_rule_arg = T(wkq::PI/2) + angle/T(2) - angles.arm;
+	else 				cos_rule_arg = T(wkq::PI/2) - angle/T(2) + angles.arm;
+	dist_sq_new = vars.arm_ground_to_ef_sq + rot_dist_sq - T(2) * rot_dist * vars.arm_ground_to_ef * wkq::math::cos(cos_rule_arg);
+	dist_new = wkq::math::sqrt(dist_sq_new);
+
+	// Cosine Rule to find new Arm Servo Angle - valid for a LEFT LEG servo facing down
+	rotation = wkq::math::acos( (rot_dist_sq + dist_sq_new - vars.arm_ground_to_ef_sq) / ( T(2) * rot_dist * dist_new ) );
+	if (angle >= T(0)) 	angles.arm = T(wkq::PI/2) - rotation + angle/T(2);
+	else 				angles.arm = -T(wkq::PI/2) + rotation + angle/T(2);
+#else
+	// Cosine Rule to find new hip_ground_to_ef
+	if (angle >= T(0)) 	cos_rule_arg = T(wkq::PI/2) + angle/T(2) - angles.hip;
+	else 				cos_rule_arg = T(wkq::PI/2) - angle/T(2) + angles.hip;
+	dist_sq_new = vars.hip_ground_to_ef_sq + rot_dist_sq - T(2) * rot_dist * vars.hip_ground_to_ef * wkq::math::cos(cos_rule_arg);
+	dist_new = wkq::math::sqrt(dist_sq_new);
+
+	// Cosine rule to find the new angles.hip - valid for left leg facing up
+	rotation = wkq::math::acos( (rot_dist_sq + dist_sq_new - vars.hip_ground_to_ef_sq) / ( T(2) * rot_dist * dist_new ) );
+	if (angle >= T(0)) 	angles.hip = (T(wkq::PI) - angle)/T(2) + rotation - T(wkq::PI);
+	else 				angles.hip = T(wkq::PI) - rotation - (T(wkq::PI) + angle)/T(2);
+#endif
+}
+
+
+#ifndef DOF3
+/*
+	@param: step_size - must be always twice the active step_size so that bigger steps can be done
+*/
+template<typename T>
+T Kinematics<T>::stepForward(const BodyParamsT<T>& params, T angle_offset, T step_size, const DynamicVarsT<T>& vars, LegAnglesT<T>& angles){
+	using namespace std;
+	T dir = T(wkq::PI/2) - angle_offset;
+
+	// Vector representing the new END EFFECTOR position
+	wkq::Vec2T<T> p_ef_new = wkq::polar(vars.ef_center, dir);
+
+	// Vector representing current HIP position, translated backwards from the imaginary center
+	wkq::Vec2T<T> p_hip = wkq::polar(params.DIST_CENTER, dir);
+	p_hip.y -= step_size/T(2);
+
+	// Find the gradient between the points
+	angles.hip = wkq::line_arg(p_hip, p_ef_new) + angle_offset - T(wkq::PI/2);
+
+	// New hip_ground_to_ef_sq
+	return wkq::dist_sq(p_hip, p_ef_new);
+}
+
+
+template<typename T>
+T Kinematics<T>::stepRotate(const BodyParamsT<T>& params, T angle_offset, T angle, const DynamicVarsT<T>& vars, LegAnglesT<T>& angles){
+	using namespace std;
+	T dir = T(wkq::PI/2) - angle_offset;
+
+	// Vector representing the new END EFFECTOR position
+	wkq::Vec2T<T> p_ef_new = wkq::polar(vars.ef_center, dir);
+
+	// Vector representing current HIP position, rotated in the opposite direction relative to the center. 
+	// Built directly at the rotated angle instead of rotating a Point, which would need its polar form
+	wkq::Vec2T<T> p_hip = wkq::polar(params.DIST_CENTER, dir + angle/T(2));
+
+	// Find the gradient between the points
+	angles.hip = wkq::line_arg(p_hip, p_ef_new) + angle_offset - T(wkq::PI/2);
+
+	// New hip_ground_to_ef_sq
+	return wkq::dist_sq(p_hip, p_ef_new);
+}
+#endif
+
+
+/* ================================================= VELOCITY ================================================= */
+
+template<typename T>
+void Kinematics<T>::jacobian(const BodyParamsT<T>& params, T angle_offset, const LegAnglesT<T>& angles, JacobianT<T>& jac){
+	using namespace std;
+#ifdef DOF3
+	T psi = T(wkq::PI/2) - angle_offset - angles.arm;
+	T c_psi = wkq::math::cos(psi), s_psi = wkq::math::sin(psi);
+	T c_knee_abs = wkq::math::cos(angles.hip + angles.knee), s_knee_abs = wkq::math::sin(angles.hip + angles.knee);
+	T rho = params.COXA + params.FEMUR*wkq::math::cos(angles.hip) + params.TIBIA*c_knee_abs;
+	T h = params.FEMUR*wkq::math::sin(angles.hip) + params.TIBIA*s_knee_abs;
+
+	// d(psi)/d(arm) = -1
+	jac.arm[0] = rho * s_psi;
+	jac.arm[1] = -rho * c_psi;
+	jac.arm[2] = T(0);
+
+	// d(rho)/d(hip) = -h, d(h)/d(hip) = rho - COXA
+	jac.hip[0] = -h * c_psi;
+	jac.hip[1] = -h * s_psi;
+	jac.hip[2] = -(rho - params.COXA);
+
+	// d(rho)/d(knee) = -TIBIA*sin(hip + knee), d(h)/d(knee) = TIBIA*cos(hip + knee)
+	jac.knee[0] = -params.TIBIA * s_knee_abs * c_psi;
+	jac.knee[1] = -params.TIBIA * s_knee_abs * s_psi;
+	jac.knee[2] = -params.TIBIA * c_knee_abs;
+#else
+	T psi = T(wkq::PI/2) - angle_offset + angles.hip;
+	T c_psi = wkq::math::cos(psi), s_psi = wkq::math::sin(psi);
+	T rho = params.FEMUR + params.TIBIA*wkq::math::cos(angles.knee);
+	T s_knee = wkq::math::sin(angles.knee);
+
+	jac.hip[0] = -rho * s_psi;
+	jac.hip[1] = rho * c_psi;
+	jac.hip[2] = T(0);
+
+	jac.knee[0] = -params.TIBIA * s_knee * c_psi;
+	jac.knee[1] = -params.TIBIA * s_knee * s_psi;
+	jac.knee[2] = -params.TIBIA * wkq::math::cos(angles.knee);
+#endif
+}
+
+
+/*  @ Notes:
+	The Jacobian is inverted analytically by splitting the velocity into its radial, tangential and vertical parts:
+	the azimuth joint only produces tangential motion, the remaining planar joints only radial and vertical motion.
+	DOF3 planar determinant is FEMUR*TIBIA*sin(knee), DOF2 radial derivative is -TIBIA*sin(knee)
+*/
+template<typename T>
+bool Kinematics<T>::jointVelocities(const BodyParamsT<T>& params, T angle_offset, const LegAnglesT<T>& angles, 
+									T vx, T vy, T vz, LegAnglesT<T>& joint_vel){
+	using namespace std;
+	const T SINGULAR_SIN = T(1e-3);
+	bool valid = true;
+
+#ifdef DOF3
+	T psi = T(wkq::PI/2) - angle_offset - angles.arm;
+	T c_psi = wkq::math::cos(psi), s_psi = wkq::math::sin(psi);
+	T c_knee_abs = wkq::math::cos(angles.hip + angles.knee), s_knee_abs = wkq::math::sin(angles.hip + angles.knee);
+	T u = params.FEMUR*wkq::math::cos(angles.hip) + params.TIBIA*c_knee_abs;
+	T h = params.FEMUR*wkq::math::sin(angles.hip) + params.TIBIA*s_knee_abs;
+	T rho = params.COXA + u;
+
+	T v_radial = c_psi*vx + s_psi*vy;
+	T v_tangential = -s_psi*vx + c_psi*vy;
+	T v_down = -vz;
+
+	joint_vel.arm = -v_tangential / rho;
+
+	// [v_radial; v_down] = [[-h, -TIBIA*sin(hip+knee)], [u, TIBIA*cos(hip+knee)]] * [hip; knee]
+	T s_knee = wkq::math::sin(angles.knee);
+	if(fabs(s_knee) < SINGULAR_SIN){
+		joint_vel.hip = T(0);
+		joint_vel.knee = T(0);
+		valid = false;
+	}
+	else{
+		T det = params.FEMUR * params.TIBIA * s_knee;
+		joint_vel.hip = ( params.TIBIA*c_knee_abs*v_radial + params.TIBIA*s_knee_abs*v_down ) / det;
+		joint_vel.knee = ( -u*v_radial - h*v_down ) / det;
+	}
+#else
+	T psi = T(wkq::PI/2) - angle_offset + angles.hip;
+	T c_psi = wkq::math::cos(psi), s_psi = wkq::math::sin(psi);
+	T rho = params.FEMUR + params.TIBIA*wkq::math::cos(angles.knee);
+	T s_knee = wkq::math::sin(angles.knee);
+
+	T v_radial = c_psi*vx + s_psi*vy;
+	T v_tangential = -s_psi*vx + c_psi*vy;
+	(void)vz;
+
+	joint_vel.hip = v_tangential / rho;
+	if(fabs(s_knee) < SINGULAR_SIN){
+		joint_vel.knee = T(0);
+		valid = false;
+	}
+	else joint_vel.knee = -v_radial / (params.TIBIA * s_knee);
+#endif
+	return valid;
+}
+
+
+#endif
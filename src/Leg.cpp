@@ -4,12 +4,12 @@
 
 // Tripod constructor does not write to angles, so Leg constrcutor is only responsible for calculating the proper defaultPos
 #ifdef DOF3
-Leg::Leg(int ID_knee, int ID_hip, int ID_arm, unordered_map<int, DnxHAL*>& servo_map, double height_in, const BodyParams& robot_params) :
+Leg::Leg(int ID_knee, int ID_hip, int ID_arm, ServoMap& servo_map, double height_in, const BodyParams& robot_params) :
     state(height_in, robot_params), 
     // Instantiate joints
     joints(ID_knee, ID_hip, ID_arm, servo_map) {
 #else   
-Leg::Leg(int ID_knee, int ID_hip, unordered_map<int, DnxHAL*>& servo_map, double height_in, const BodyParams& robot_params) :
+Leg::Leg(int ID_knee, int ID_hip, ServoMap& servo_map, double height_in, const BodyParams& robot_params) :
     state(height_in, robot_params), 
     // Instantiate joints
     joints(ID_knee, ID_hip, servo_map) {
@@ -71,7 +71,8 @@ void Leg::setPosition(wkq::RobotState_t robot_state){
             liftUp(State_t::ef_raise);
             confQuadArms();
             writeAngles();
-            wait(0.1);
+            DnxBus::sendPending();          // the arms must move before the wait even inside a sync
+            ControlLoop::run(0.1);
             lowerDown(State_t::ef_raise);
 
             //state.legStand();
@@ -96,7 +97,7 @@ void Leg::confQuadArms(){
     if(leg_id == wkq::LEG_RIGHT_MIDDLE || leg_id == wkq::LEG_LEFT_MIDDLE) state.servo_angles.arm = 0.0;
     
     else{
-        double arm_offset = asin( state.params.DIST_CENTER * sin(wkq::PI/12)/(state.params.COXA+state.params.FEMUR-state.params.KNEE_TO_MOTOR_DIST) );
+        double arm_offset = wkq::math::asin( state.params.DIST_CENTER * wkq::math::sin(wkq::PI/12)/(state.params.COXA+state.params.FEMUR-state.params.KNEE_TO_MOTOR_DIST) );
 
         // Remember that arm is pointing downwards
         // FRONT LEGS
@@ -109,7 +110,7 @@ void Leg::confQuadArms(){
     if(leg_id == wkq::LEG_RIGHT_MIDDLE || leg_id == wkq::LEG_LEFT_MIDDLE) state.servo_angles.hip = 0.0;
     
     else{
-        double hip_offset = asin( state.params.DIST_CENTER / ( state.params.FEMUR - state.params.KNEE_TO_MOTOR_DIST) * sin(wkq::PI/12) ) ;
+        double hip_offset = wkq::math::asin( state.params.DIST_CENTER / ( state.params.FEMUR - state.params.KNEE_TO_MOTOR_DIST) * wkq::math::sin(wkq::PI/12) ) ;
 
         // Remember that hip is pointing upwards
         // FRONT LEGS
@@ -136,7 +137,7 @@ void Leg::confRectangular(){
 // input equals height required for the end effector; Untested for all joints and negative input
 void Leg::liftUp(double height){
 #ifdef DOF3
-    state.servo_angles.knee = wkq::PI - state.servo_angles.knee + acos(1 - pow(height,2) / state.params.TIBIA_SQ); 
+    state.servo_angles.knee = wkq::PI - state.servo_angles.knee + wkq::math::acos(1 - wkq::math::pow(height,2) / state.params.TIBIA_SQ); 
 #else
     state.servo_angles.knee = wkq::radians(50);
     //state.servo_angles.knee = 2*asin( sqrt(2)/2 * height/ state.params.TIBIA); 
@@ -146,9 +147,9 @@ void Leg::liftUp(double height){
 // input equals current height of the end effector
 void Leg::lowerDown(double height){
 #ifdef DOF3
-    state.servo_angles.knee = wkq::PI - state.servo_angles.knee - acos(1 - pow(height,2) / state.params.TIBIA_SQ); 
+    state.servo_angles.knee = wkq::PI - state.servo_angles.knee - wkq::math::acos(1 - wkq::math::pow(height,2) / state.params.TIBIA_SQ); 
 #else
-    state.servo_angles.knee += 2*asin( sqrt(2)/2 * height/ state.params.TIBIA); 
+    state.servo_angles.knee += 2*wkq::math::asin( wkq::math::sqrt(2)/2 * height/ state.params.TIBIA); 
 #endif
 }
 
@@ -167,68 +168,15 @@ void Leg::finishStep(){
 
 // Valid calculations for negative input as well in the current form
 void Leg::bodyForward(double step_size){
+    wkq::real_t dist_new, dist_sq_new;
 
-#ifdef DOF3
-    double step_size_sq;
-    double arm_ground_to_ef_new, arm_ground_to_ef_sq_new; 
-    double arm_rotation;
-
-    step_size_sq = pow(step_size,2);
-
-    // Cosine Rule to find the new arm_ground_to_ef
-    arm_ground_to_ef_sq_new = state.vars.arm_ground_to_ef_sq + step_size_sq - 2 * step_size * state.vars.arm_ground_to_ef * cos(angle_offset + state.servo_angles.arm) ;
-    arm_ground_to_ef_new = sqrt(arm_ground_to_ef_sq_new);
-
-    // Cosine Rule to find new servo_angles.arm
-    arm_rotation = acos( (step_size_sq + arm_ground_to_ef_sq_new - state.vars.arm_ground_to_ef_sq) / ( 2 * step_size * arm_ground_to_ef_new ) );
-    // Convert to actual angle for the servo
-    state.servo_angles.arm = wkq::PI - angle_offset - arm_rotation;           // NB: Valid for a LEFT servo facing down
+    Kinematics<wkq::real_t>::bodyForward(angle_offset, step_size, state.vars, state.servo_angles, dist_new, dist_sq_new);
 
     // Update the whole leg state
-    state.updateVar(&(state.vars.arm_ground_to_ef), arm_ground_to_ef_new, &(state.vars.arm_ground_to_ef_sq), arm_ground_to_ef_sq_new);
-
-#else   
-    double step_size_sq;
-    double hip_ground_to_ef_new, hip_ground_to_ef_sq_new; 
-    double hip_rotation;
-
-    step_size_sq = pow(step_size,2);
-
-    // Cosine Rule to find the new hip_ground_to_ef
-    hip_ground_to_ef_sq_new = state.vars.hip_ground_to_ef_sq + step_size_sq - 2 * step_size * state.vars.hip_ground_to_ef * cos(angle_offset - state.servo_angles.hip) ;
-    hip_ground_to_ef_new = sqrt(hip_ground_to_ef_sq_new);
-
-    // Cosine Rule to find new servo_angles.arm
-    hip_rotation = acos( (step_size_sq + hip_ground_to_ef_sq_new - state.vars.hip_ground_to_ef_sq) / ( 2 * step_size * hip_ground_to_ef_new ) );
-    // Convert to actual angle for the servo
-    state.servo_angles.hip = angle_offset + hip_rotation - wkq::PI;           // NB: Valid for a LEFT servo facing up
-
-    // Update the whole leg state
-    state.updateVar(&(state.vars.hip_ground_to_ef), hip_ground_to_ef_new, &(state.vars.hip_ground_to_ef_sq), hip_ground_to_ef_sq_new);
-
-/*  double step_size_sq = pow(step_size,2);
-    double dir_offset = 0.0;
-    if(state.servo_angles.arm != 0.0){
-        // Works for both positive and negative state.servo_angles.arm
-        dir_offset = state.params.FEMUR / state.vars.center_ground_to_ef * (wkq::PI - sin(state.servo_angles.arm));
-    }
-
-    double ef_dir_angle = angle_offset - dir_offset;
-
-    // Find the new center_ground_to_ef
-    state.vars.center_ground_to_ef_sq = state.vars.center_ground_to_ef_sq + step_size_sq - 2 * step_size * state.vars.center_ground_to_ef * cos(ef_dir_angle);
-    state.vars.center_ground_to_ef = sqrt(state.vars.center_ground_to_ef_sq);
-
-    // Find the direct distance between center and end effector
-    double center_to_ef_sq = center_ground_to_ef_new_sq + state.vars.height_sq;
-    double center_to_ef = sqrt(center_to_ef_sq);
-
-    double knee_new = acos( 
-            (state.params.TIBIA_SQ + pow(state.params.FEMUR + state.params.DIST_CENTER, 2) - center_to_ef_sq) / ( 2 * state.params.TIBIA * (state.params.FEMUR + state.params.DIST_CENTER) )
-                        );
-
-    state.servo_angles.knee = wkq::PI - knee_new;
-*/
+#ifdef DOF3
+    state.setArmGroundToEf(dist_new, dist_sq_new);
+#else
+    state.setHipGroundToEf(dist_new, dist_sq_new);
 #endif
 }
 
@@ -239,74 +187,47 @@ void Leg::bodyForward(double step_size){
 void Leg::stepForward(double step_size){
 #ifdef DOF3
     // Distance from Robot center to end effector for a fully centered robot at this height
-    double ef_center = state.vars.ef_center;
+    wkq::real_t ef_center = state.vars.ef_center;
+    const wkq::real_t sqrt3 = wkq::math::sqrt(wkq::real_t(3));
 
-    // Create Point representing the new END EFFECTOR position
-    double x_ef_new, y_ef_new;
+    // Vector representing the new END EFFECTOR position
+    wkq::real_t x_ef_new, y_ef_new;
     if(leg_id == wkq::LEG_RIGHT_MIDDLE || leg_id == wkq::LEG_LEFT_MIDDLE){          // Middle Joint
         //x_ef_new = ef_center - step_size/sqrt(3); - change when you have prev and current step size as inputs
-        x_ef_new = ef_center - step_size/sqrt(3);
+        x_ef_new = ef_center - wkq::real_t(step_size)/sqrt3;
         y_ef_new = 0.0;
     }   
     else{
-        x_ef_new = ef_center/2.0 + step_size/sqrt(3);
-        y_ef_new = sqrt(3)*x_ef_new;                      // Front Joint
+        x_ef_new = ef_center/2 + wkq::real_t(step_size)/sqrt3;
+        y_ef_new = sqrt3*x_ef_new;                      // Front Joint
 
-        if(leg_id == wkq::LEG_RIGHT_BACK || leg_id == wkq::LEG_LEFT_BACK)   y_ef_new -= sqrt(3)*ef_center;           // Back Joint
+        if(leg_id == wkq::LEG_RIGHT_BACK || leg_id == wkq::LEG_LEFT_BACK)   y_ef_new -= sqrt3*ef_center;           // Back Joint
     }       
-    wkq::Point ef_new(x_ef_new, y_ef_new);
+    wkq::Vec2 ef_new = { x_ef_new, y_ef_new };
 
-    // Create Point representing current HIP position
-    double hip_arg = wkq::PI/2 -angle_offset;
-    wkq::Point p_hip(state.params.DIST_CENTER*cos(hip_arg), state.params.DIST_CENTER*sin(hip_arg));
+    // Vector representing current HIP position
+    wkq::Vec2 p_hip = wkq::polar(state.params.DIST_CENTER, wkq::real_t(wkq::PI/2) - angle_offset);
 
-    // Create Point representing the new HIP position
-    wkq::Point p_hip_new(p_hip);
-    p_hip_new.translate_y(step_size*2);
+    // Vector representing the new HIP position
+    wkq::Vec2 p_hip_new = p_hip;
+    p_hip_new.y += wkq::real_t(step_size)*2;
 
     // Calculate new arm_ground_to_ef
-    double arm_ground_to_ef_sq_new = p_hip.dist_sq(ef_new);
+    wkq::real_t arm_ground_to_ef_sq_new = wkq::dist_sq(p_hip, ef_new);
 
     // Cosine Rule to find new ARM angle
-    double arg_triangle = 
-            acos( (p_hip.dist_sq(p_hip_new) +  p_hip.dist_sq(ef_new) - p_hip_new.dist_sq(ef_new)) / (2*p_hip.dist(p_hip_new)*p_hip.dist_sq(ef_new)) );
+    wkq::real_t hip_travel_sq = wkq::dist_sq(p_hip, p_hip_new);
+    wkq::real_t arg_triangle = 
+            wkq::math::acos( (hip_travel_sq + arm_ground_to_ef_sq_new - wkq::dist_sq(p_hip_new, ef_new)) / (2*wkq::math::sqrt(hip_travel_sq)*arm_ground_to_ef_sq_new) );
     //state.servo_angles.arm = wkq::PI - angle_offset - arg_triangle;
     state.servo_angles.arm = arg_triangle - angle_offset ;      // Unconfirmed that valid for all joints
 
-    state.updateVar(&(state.vars.arm_ground_to_ef_sq), arm_ground_to_ef_sq_new);                // Automatically changes hip_to_end, HIP and KNEE   
+    state.setArmGroundToEfSq(arm_ground_to_ef_sq_new);                // Automatically changes hip_to_end, HIP and KNEE   
 #else
-   
-    // Distance from Robot center to end effector for a fully centered robot at this height
-    double ef_center = state.vars.ef_center;
-    double x_ef_new, y_ef_new;
-    double x_hip, y_hip;
-    double hip_ground_to_ef_sq;
-    double hip_rotation;
-
-    // Create Point representing the new END EFFECTOR position
-    x_ef_new = ef_center * cos(wkq::PI/2 - angle_offset);
-    y_ef_new = ef_center * sin(wkq::PI/2 - angle_offset);
-    wkq::Point p_ef_new(x_ef_new, y_ef_new);
-
-    // Create Point representing current HIP position
-    x_hip = state.params.DIST_CENTER * cos(wkq::PI/2 - angle_offset);
-    y_hip = state.params.DIST_CENTER * sin(wkq::PI/2 - angle_offset);
-    wkq::Point p_hip(x_hip, y_hip);
-    // Translate the point backwards from the imaginary center
-    p_hip.translate_y(-step_size/2);
-
-    // Calculate new hip_ground_to_ef
-    hip_ground_to_ef_sq = p_hip.dist_sq(p_ef_new);
-
-    // Find the gradient between the points
-    hip_rotation = p_hip.line_arg(p_ef_new);
-    state.servo_angles.hip = hip_rotation + angle_offset - wkq::PI/2;
+    wkq::real_t hip_ground_to_ef_sq = Kinematics<wkq::real_t>::stepForward(state.params, angle_offset, step_size, state.vars, state.servo_angles);
 
     // Update the whole leg state
-    state.updateVar(&(state.vars.hip_ground_to_ef_sq), hip_ground_to_ef_sq);                
-
-    //state.servo_angles.knee = wkq::PI/2;
-
+    state.setHipGroundToEfSq(hip_ground_to_ef_sq);                
 #endif
 }
 
@@ -321,13 +242,13 @@ void Leg::bodyForwardRectangularGait(double step_size){
     // Non-sliding case
     //printf("FEMUR: %f, step size: %f, atan: %f\n\r", state.params.FEMUR, step_size, atan( state.params.FEMUR / step_size));
     //double hip_offset;
-    state.servo_angles.hip -= atan( state.params.FEMUR / step_size) - wkq::PI/2;
+    state.servo_angles.hip -= wkq::math::atan( state.params.FEMUR / step_size) - wkq::PI/2;
 
     //hip_offset = 2*state.params.FEMUR_SQ 
 
-    double hip_knee_dist = sqrt(pow(state.params.FEMUR, 2) + pow(step_size, 2));
+    double hip_knee_dist = wkq::math::sqrt(wkq::math::pow(state.params.FEMUR, 2) + wkq::math::pow(step_size, 2));
 
-    state.servo_angles.knee = wkq::PI/2 - asin( (hip_knee_dist - state.params.FEMUR) / state.params.TIBIA );
+    state.servo_angles.knee = wkq::PI/2 - wkq::math::asin( (hip_knee_dist - state.params.FEMUR) / state.params.TIBIA );
 
 
     // Sliding case
@@ -349,11 +270,11 @@ void Leg::stepForwardRectangularGait(double step_size){
     */
 #else
     // Non-sliding case
-    state.servo_angles.hip += wkq::PI/2 - atan( state.params.FEMUR / step_size);
+    state.servo_angles.hip += wkq::PI/2 - wkq::math::atan( state.params.FEMUR / step_size);
 
-    double hip_knee_dist = sqrt(pow(state.params.FEMUR,2) + pow(step_size, 2));
+    double hip_knee_dist = wkq::math::sqrt(wkq::math::pow(state.params.FEMUR,2) + wkq::math::pow(step_size, 2));
 
-    state.servo_angles.knee = wkq::PI/2 - asin( (hip_knee_dist - state.params.FEMUR) / state.params.TIBIA );
+    state.servo_angles.knee = wkq::PI/2 - wkq::math::asin( (hip_knee_dist - state.params.FEMUR) / state.params.TIBIA );
 
 
     // Sliding case
@@ -374,55 +295,15 @@ void Leg::stepForwardRectangularGait(double step_size){
         - negative value - CCW rotation
 */
 void Leg::bodyRotate(double angle){
-#ifdef DOF3
-    // Sine Rule to find rotation distance
-    double rot_dist = 2 * state.params.DIST_CENTER * sin (fabs(angle)/2);
-
-    double rot_dist_sq = pow(rot_dist, 2);
-
-    // Cosine Rule to find new arm_ground_to_efSQ
-    double arm_ground_to_ef_sq_new;
-    if (angle>=0.0) arm_ground_to_ef_sq_new = state.vars.arm_ground_to_ef_sq + rot_dist_sq - 
-                                    2 * rot_dist * state.vars.arm_ground_to_ef * cos( wkq::PI/2 + angle/2 - state.servo_angles.arm );
-    else arm_ground_to_ef_sq_new = state.vars.arm_ground_to_ef_sq + rot_dist_sq - 
-                                    2 * rot_dist * state.vars.arm_ground_to_ef * cos( wkq::PI/2 - angle/2 + state.servo_angles.arm );   
-
-    double arm_ground_to_ef_new = sqrt(arm_ground_to_ef_sq_new);
-
-    // Cosine Rule to find new Arm Servo Angle
-    double arm_rotation = acos( (rot_dist_sq + arm_ground_to_ef_sq_new - state.vars.arm_ground_to_ef_sq) / ( 2 * rot_dist * arm_ground_to_ef_new ) );
-    // Convert to actual angle for the servo - valid for a LEFT LEG servo facing down
-    if (angle>=0.0) state.servo_angles.arm = wkq::PI/2 - arm_rotation + angle/2;  // - (- wkq::PI/2 + state.servo_angles.arm - angle/2)
-    else            state.servo_angles.arm = -wkq::PI/2 + arm_rotation + angle/2; // - (  wkq::PI/2 - state.servo_angles.arm - angle/2)
-
-    state.updateVar(&(state.vars.arm_ground_to_ef), arm_ground_to_ef_new, &(state.vars.arm_ground_to_ef_sq), arm_ground_to_ef_sq_new);                  // Automatically changes robot state in software
-#else
+    wkq::real_t dist_new, dist_sq_new;
 
-    //state.vars.print();
-    //cout<<endl;
-
-    double rot_dist, rot_dist_sq;
-    double hip_ground_to_ef, hip_ground_to_ef_sq;
-    double hip_rotation;
-    double cos_rule_arg;
-
-    // Sine Rule to find rotation distance
-    rot_dist = 2 * state.params.DIST_CENTER * sin (fabs(angle)/2);
-    rot_dist_sq = pow(rot_dist, 2);
-
-    // Cosine Rule to find new hip_ground_to_ef
-    if (angle >= 0.0)   cos_rule_arg = wkq::PI/2 + angle/2 - state.servo_angles.hip;
-    else                cos_rule_arg = wkq::PI/2 - angle/2 + state.servo_angles.hip;  
-    hip_ground_to_ef_sq = state.vars.hip_ground_to_ef_sq + rot_dist_sq - 2 * rot_dist * state.vars.hip_ground_to_ef * cos(cos_rule_arg);
-    hip_ground_to_ef = sqrt(hip_ground_to_ef_sq);
-
-    // Cosine rule to find the new servo_angles.hip - valid for left leg facing up
-    hip_rotation = acos( (rot_dist_sq + hip_ground_to_ef_sq - state.vars.hip_ground_to_ef_sq) / ( 2 * rot_dist * hip_ground_to_ef ) );
-    if(angle >= 0.0) state.servo_angles.hip = (wkq::PI - angle)/2 + hip_rotation - wkq::PI;
-    else             state.servo_angles.hip = wkq::PI - hip_rotation - (wkq::PI + angle)/2; 
+    Kinematics<wkq::real_t>::bodyRotate(state.params, angle, state.vars, state.servo_angles, dist_new, dist_sq_new);
 
     // Update the whole leg state
-    state.updateVar(&(state.vars.hip_ground_to_ef), hip_ground_to_ef, &(state.vars.hip_ground_to_ef_sq), hip_ground_to_ef_sq);
+#ifdef DOF3
+    state.setArmGroundToEf(dist_new, dist_sq_new);
+#else
+    state.setHipGroundToEf(dist_new, dist_sq_new);
 #endif
 }
 
@@ -434,36 +315,10 @@ void Leg::stepRotate(double angle){
         FILL IN
     */
 #else
-   
-    // Distance from Robot center to end effector for a fully centered robot at this height
-    double ef_center = state.vars.ef_center;
-    double x_ef_new, y_ef_new;
-    double x_hip, y_hip;
-    double hip_ground_to_ef_sq;
-    double hip_rotation;
-
-    // Create Point representing the new END EFFECTOR position
-    x_ef_new = ef_center * cos(wkq::PI/2 - angle_offset);
-    y_ef_new = ef_center * sin(wkq::PI/2 - angle_offset);
-    wkq::Point p_ef_new(x_ef_new, y_ef_new);
-
-    // Create Point representing current HIP position
-    x_hip = state.params.DIST_CENTER * cos(wkq::PI/2 - angle_offset);
-    y_hip = state.params.DIST_CENTER * sin(wkq::PI/2 - angle_offset);
-    wkq::Point p_hip(x_hip, y_hip);
-    // Rotate the point in the opposite direction relative to the center
-    p_hip.rotate(-angle/2);
-
-    // Calculate new hip_ground_to_ef
-    hip_ground_to_ef_sq = p_hip.dist_sq(p_ef_new);
-
-    // Find the gradient between the points
-    hip_rotation = p_hip.line_arg(p_ef_new);
-    state.servo_angles.hip = hip_rotation + angle_offset - wkq::PI/2;
+    wkq::real_t hip_ground_to_ef_sq = Kinematics<wkq::real_t>::stepRotate(state.params, angle_offset, angle, state.vars, state.servo_angles);
 
     // Update the whole leg state
-    state.updateVar(&(state.vars.hip_ground_to_ef_sq), hip_ground_to_ef_sq);                
-
+    state.setHipGroundToEfSq(hip_ground_to_ef_sq);                
 #endif
 }
 
@@ -471,22 +326,46 @@ void Leg::stepRotate(double angle){
 // input equals height to be raised by; negative values also work
 void Leg::raiseBody(double hraise){
 
-    state.updateVar(&(state.vars.height), (state.vars.height + hraise));            // hip_to_end, HIP and KNEE automatically get updated
+    state.setHeight(state.vars.height + hraise);            // hip_to_end, HIP and KNEE automatically get updated
 
 /*
     if (&(state.vars.hip_to_end) > (state.params.TIBIA + state.params.FEMUR) ){
-        state.updateVar(&(state.vars.hip_to_end), (state.params.TIBIA + state.params.FEMUR) );
+        state.setHipToEnd(state.params.TIBIA + state.params.FEMUR);
         UpdateHeight();
     }
 
     else if (&(state.vars.hip_to_end) < (state.params.TIBIA - state.params.FEMUR) ){ 
-        state.updateVar(&(state.vars.hip_to_end), 1.5 * (state.params.TIBIA - state.params.FEMUR) );     // state.params.TIBIA - state.params.FEMUR is impossible position
+        state.setHipToEnd(1.5 * (state.params.TIBIA - state.params.FEMUR));     // state.params.TIBIA - state.params.FEMUR is impossible position
         // Think of better way to calculate minimal position - use Hip limit angle
         UpdateHeight();
     }
 */
 }
 
+/* ------------------------------------------------- VELOCITY COMMANDS ------------------------------------------------- */
+
+/*  @ Notes:
+    The joint velocities are computed at the current pose, before bodyForward() moves it. Written together with the new
+    servo_angles, they make the servos arrive at the new pose after about dt instead of jumping there at full speed. 
+    Issuing the next command before dt expires keeps the motion continuous
+*/
+void Leg::bodyVelocity(double velocity, double dt){
+    // The body moves forward, so the END EFFECTOR moves backwards relative to the mount point
+    if(!jointVelocities(0.0, -velocity, 0.0, joint_velocities))
+        printf("WARNING: Leg::bodyVelocity - singular pose, knee velocity set to 0\n\r");
+
+    bodyForward(velocity*dt);
+}
+
+
+/*
+    @param vx, vy, vz: END EFFECTOR velocity relative to the mount point in cm/s, LEFT LEG frame (see Kinematics.h)
+*/
+bool Leg::jointVelocities(double vx, double vy, double vz, LegAngles& joint_vel) const{
+    return Kinematics<wkq::real_t>::jointVelocities(state.params, angle_offset, state.servo_angles, vx, vy, vz, joint_vel);
+}
+
+
 /* ------------------------------------------------- WRITING TO SERVOS ------------------------------------------------- */
 
 
@@ -513,6 +392,24 @@ void Leg::writeAngles(){
     if(debug_) printf("Leg: done writeAngles\n\r");
 }
 
+
+// Speeds are magnitudes, so RIGHT LEG needs no sign change
+void Leg::writeVelocities(){
+#ifdef DOF3
+    joints.arm.setGoalVelocity((double)joint_velocities.arm);
+#endif
+    joints.knee.setGoalVelocity((double)joint_velocities.knee);
+    joints.hip.setGoalVelocity((double)joint_velocities.hip);
+}
+
+void Leg::restoreVelocities(){
+#ifdef DOF3
+    joints.arm.restoreVelocity();
+#endif
+    joints.knee.restoreVelocity();
+    joints.hip.restoreVelocity();
+}
+
 /*
 // Write state.servo_angles[] to physcial servos in order ARM, HIP, KNEE
 void Leg::writeKnee(){
@@ -538,3 +435,17 @@ void Leg::copyState(const Leg& leg_in){
     }
 }
 
+void Leg::saveState(LegSnapshot& snapshot) const{
+    snapshot.angles = state.servo_angles;
+    snapshot.vars = state.vars;
+}
+
+void Leg::loadState(const LegSnapshot& snapshot){
+    state.servo_angles = snapshot.angles;
+    state.vars = snapshot.vars;
+}
+
+const BodyParams& Leg::getParams() const{
+    return state.params;
+}
+
@@ -31,12 +31,11 @@ FUNCTIONALITY:
 FRAMEWORK:
 	1. Algorithms work only for LEFT LEG. Values for RIGHT LEG are computed at the time of writing as opposite to Left Leg
 
-	2. vars[]		-	Use updateVar(). Function automatically updates square value for the variable
-							and the rest of the variables by calling StateUpdate()
-	3. updateVar() 		- 	When you use this to update hip_to_end it is assumed the change is in ENDEFFECTOR
-							rather than in the HEIGHT of the robot. If change is in the HEIGHT, the vars.height
-							will not be updates
-	4. configureAngles()	-	Function automatically called when updateVar() is called. Basing on vars[]
+	2. vars[]		-	Use the typed State_t setters. They automatically update the square value for the variable
+							and the rest of the variables that depend on it
+	3. setHipToEnd() 	- 	It is assumed the change is in ENDEFFECTOR rather than in the HEIGHT of the robot. If change 
+							is in the HEIGHT, the vars.height will not be updates
+	4. configureAngles()	-	Function automatically called by every State_t setter. Basing on vars[]
 							function computes new angles for Hip and Knee
 	5. center()			-	Assumes Leg is already lifted up, otherwise robot will probably fall down
 	6. configureVars() 	- 	Computes all vars[] based on the current servo_angles[] does not use Update(), but computes variables
@@ -52,7 +51,9 @@ FRAMEWORK:
 #include <cmath>
 
 #include "ServoJoint.h"
+#include "ControlLoop.h"
 #include "State_t.h"
+#include "Kinematics.h"
 #include "wkq.h"
 using wkq::RobotState_t;
 
@@ -61,9 +62,9 @@ class Leg{
 public:
 
 #ifndef DOF3	
-	Leg(int ID_knee, int ID_arm, unordered_map<int, DnxHAL*>& servo_map, double height_in, const BodyParams& robot_params);
+	Leg(int ID_knee, int ID_arm, ServoMap& servo_map, double height_in, const BodyParams& robot_params);
 #else
-	Leg(int ID_knee, int ID_hip, int ID_arm, unordered_map<int, DnxHAL*>& servo_map, double height_in, const BodyParams& robot_params);
+	Leg(int ID_knee, int ID_hip, int ID_arm, ServoMap& servo_map, double height_in, const BodyParams& robot_params);
 #endif
 	~Leg();
 
@@ -71,6 +72,9 @@ public:
 
 	double get(int param_type, int idx) const;
 	void copyState(const Leg& leg_in);								// Copy the state of input Leg
+	void saveState(LegSnapshot& snapshot) const;					// Store servo_angles[] and vars[]
+	void loadState(const LegSnapshot& snapshot);					// Restore a stored state without any computation
+	const BodyParams& getParams() const;
 
 	/* ---------------------------------------- STATIC POSITIONS ---------------------------------------- */
 
@@ -99,9 +103,16 @@ public:
 	
 	void raiseBody(double hraise);
 
+	/* ---------------------------------------- VELOCITY COMMANDS ---------------------------------------- */
+
+	void bodyVelocity(double velocity, double dt);	// bodyForward() by velocity*dt; joint_velocities[] computed from the Jacobian
+	bool jointVelocities(double vx, double vy, double vz, LegAngles& joint_vel) const; 	// END EFFECTOR cm/s to joint rad/s
+
 	/* ---------------------------------------- WRITE TO SERVOS ---------------------------------------- */
 
 	void writeAngles();							// Write servo_angles[] to physcial servos in order ARM, HIP, KNEE
+	void writeVelocities();						// Write joint_velocities[] to physical servos as moving speeds
+	void restoreVelocities();					// Moving speeds back to SERVO_DEFAULT_SPEED after writeVelocities()
 	void writeJoint(int idx);			// Write only a single angle contained in servo_angles[] to physcial servo
 
 	template<typename MemberFnPtr, typename FnArg>
@@ -116,7 +127,9 @@ private:
 	State_t state;
 	LegJoints joints;							// Stores servo objects corresponding to the physical servos
 
-	double angle_offset;						// Angle between Y-axis and servo orientation; always positive
+	LegAngles joint_velocities;					// In rad/s: last joint velocities computed by bodyVelocity()
+
+	wkq::real_t angle_offset;					// Angle between Y-axis and servo orientation; always positive
 	bool leg_right;								// 1.0 - Leg is LEFT, -1.0 - Leg is RIGHT
 	wkq::LegID leg_id; 							// ID of the leg
 
@@ -0,0 +1,167 @@
+#include "LegBatch.h"
+#include "State_t.h"
+
+#if !defined(SIMULATION) && !defined(IK_TABLES)
+#include "cmsis.h"
+#include "arm_math.h"
+#undef PI
+#endif
+
+/* ================================================= KERNEL HELPERS ================================================= */
+
+#ifndef IK_TABLES
+static const float BATCH_PI 	= (float)wkq::PI;
+static const float BATCH_PI_2 	= (float)(wkq::PI/2);
+
+static inline float batch_sqrt(float value){
+#ifdef SIMULATION
+	return sqrtf(value);
+#else
+	float32_t out;
+	arm_sqrt_f32(value, &out);
+	return out;
+#endif
+}
+
+/*  @ Notes:
+	Abramowitz & Stegun 4.4.46: acos(x) = sqrt(1-x) * (a0 + a1*x + ... + a7*x^7) for 0 <= x <= 1, |error| <= 2e-8
+	in exact arithmetic - the error measured in float is given in LegBatch.h
+	Negative inputs use acos(-x) = PI - acos(x). Input is clamped to [-1, 1]. Every constant is a float literal, so
+	nothing in the loop is promoted to double
+*/
+static inline float batch_acos(float x){
+	if(x > 1.0f) 	x = 1.0f;
+	if(x < -1.0f) 	x = -1.0f;
+
+	float ax = fabsf(x);
+	float poly = -0.0012624911f;
+	poly = poly*ax + 0.0066700901f;
+	poly = poly*ax - 0.0170881256f;
+	poly = poly*ax + 0.0308918810f;
+	poly = poly*ax - 0.0501743046f;
+	poly = poly*ax + 0.0889789874f;
+	poly = poly*ax - 0.2145988016f;
+	poly = poly*ax + 1.5707963050f;
+
+	float res = batch_sqrt(1.0f - ax) * poly;
+	return (x < 0.0f) ? BATCH_PI - res : res;
+}
+#endif
+
+
+/* ================================================= PUBLIC METHODS ================================================= */
+
+LegBatch::LegBatch() : count(0) {}
+
+LegBatch::~LegBatch(){}
+
+void LegBatch::setParams(const BodyParams& robot_params){
+#ifndef IK_TABLES
+	femur 				= (float)robot_params.FEMUR;
+	tibia 				= (float)robot_params.TIBIA;
+#ifdef DOF3
+	knee_cos_num 		= (float)(robot_params.FEMUR_SQ + robot_params.TIBIA_SQ);
+	knee_cos_den_inv 	= (float)(1.0 / (2 * robot_params.FEMUR * robot_params.TIBIA));
+	hip_cos_num 		= (float)(robot_params.FEMUR_SQ - robot_params.TIBIA_SQ);
+	hip_cos_den_inv 	= (float)(1.0 / (2 * robot_params.FEMUR));
+#else
+	tibia_inv 			= (float)(1.0 / robot_params.TIBIA);
+#endif
+#else
+	(void)robot_params; 										// The IKTables of State_t are built from the same params
+#endif
+}
+
+
+/*  @ Notes:
+	With MATH_STATS the acos() calls of the kernel are counted here rather than in solve(), so that they fall in the
+	gait phase of the movement that queued the leg - solve() runs once for all of them at the end of the batch
+*/
+void LegBatch::queue(const DynamicVars& vars, LegAngles* angles){
+#if defined(MATH_STATS) && !defined(IK_TABLES)
+#ifdef DOF3
+	for(int i=0; i<3; i++) wkq::math::record(wkq::math::FN_ACOS, __FILE__, __LINE__);
+#else
+	wkq::math::record(wkq::math::FN_ACOS, __FILE__, __LINE__);
+#endif
+#endif
+
+	int idx;
+	for(idx=0; idx<count; idx++){
+		if(out[idx] == angles) break;
+	}
+	if(idx == count){
+		if(count == LEG_BATCH_SIZE){
+			solve();
+			idx = 0;
+		}
+		out[idx] = angles;
+		count = idx + 1;
+	}
+
+#ifdef DOF3
+	height[idx] 		= (batch_real_t)vars.height;
+	hip_to_end[idx] 	= (batch_real_t)vars.hip_to_end;
+#ifndef IK_TABLES
+	hip_to_end_sq[idx] 	= (batch_real_t)vars.hip_to_end_sq;
+#endif
+#else
+	hip_ground_to_ef[idx] = (batch_real_t)vars.hip_ground_to_ef;
+#endif
+}
+
+
+/*  @ Notes:
+	Same equations as State_t::configureAngles(), written as independent per-leg loops over the arrays
+	DOF3 - KNEE and HIP from the Cosine Rule on FEMUR, TIBIA and hip_to_end
+	DOF2 - KNEE only; PI/2 - asin(s) is computed as acos(s)
+	IK_TABLES runs the lookups of State_t::configureAngles() in that build over the same arrays
+*/
+void LegBatch::solve(){
+	const int n = count;
+
+#ifdef IK_TABLES
+	const IKTables& tables = State_t::ik_tables;
+#ifdef DOF3
+	for(int i=0; i<n; i++){
+		knee[i] = tables.knee.lookup(hip_to_end[i]);
+		hip[i] 	= tables.hip.lookup(hip_to_end[i]) - tables.acos_ratio.lookup(height[i]/hip_to_end[i]);
+	}
+#else
+	for(int i=0; i<n; i++){
+		knee[i] = tables.knee.lookup(hip_ground_to_ef[i]);
+	}
+#endif
+
+#else
+#ifdef DOF3
+	for(int i=0; i<n; i++){
+		knee[i] = BATCH_PI - batch_acos( (knee_cos_num - hip_to_end_sq[i]) * knee_cos_den_inv );
+	}
+	for(int i=0; i<n; i++){
+		float inv_hip_to_end = 1.0f / hip_to_end[i];
+		hip[i] = BATCH_PI_2
+				- batch_acos( (hip_cos_num + hip_to_end_sq[i]) * hip_cos_den_inv * inv_hip_to_end )
+				- batch_acos( height[i] * inv_hip_to_end );
+	}
+#else
+	for(int i=0; i<n; i++){
+		knee[i] = batch_acos( (hip_ground_to_ef[i] - femur) * tibia_inv );
+	}
+#endif
+#endif
+
+	for(int i=0; i<n; i++){
+		out[i]->knee 	= knee[i];
+#ifdef DOF3
+		out[i]->hip 	= hip[i];
+#endif
+	}
+
+	count = 0;
+}
+
+
+int LegBatch::size() const{
+	return count;
+}
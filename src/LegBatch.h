@@ -0,0 +1,101 @@
+/*
+
+LegBatch Class: Batched kinematics kernel that solves the servo angles of all legs in a single pass
+===========================================================================================
+
+FUNCTIONALITY:
+	1. Stores the DynamicVars needed by State_t::configureAngles() for up to LEG_BATCH_SIZE legs in structure-of-arrays
+		form, so that a single loop can solve KNEE and HIP for every leg with contiguous memory access. Used only when
+		LEG_BATCH is defined at build time (make LEG_BATCH=1) - see State_t::beginBatch()
+	2. Responsible only for the IK step done by State_t::configureAngles(). Arm angles are still computed by the
+		Leg movement algorithms and are not touched
+	3. acos() is evaluated with the Abramowitz & Stegun 4.4.46 polynomial so that the loop body contains only
+		arithmetic and sqrt. The kernel is single precision on the host as well as on the mbed, so bin/sim and
+		bin/bench run the code that the Cortex-M3 runs. On the mbed sqrt is done through CMSIS arm_sqrt_f32()
+		instead of the soft-float double routines
+	4. Measured error of the float kernel. Against double acos() on the same argument it is at most 2.5e-7 rad in
+		[0, 1] and 4e-7 rad below 0, where PI - acos(-x) is rounded near PI - the 2e-8 rad bound of the polynomial
+		is below float resolution. Against the double configureAngles() bin/bench (LEG_BATCH=1) measures at most
+		7e-7 rad on KNEE and 1.2e-6 rad on HIP over the inner 98% of the reachable range. Near a fully stretched or
+		folded leg the slope of acos() diverges and the float rounding of the inputs gives up to 3.5e-4 rad
+	5. IK_TABLES builds batch the legs as well: solve() runs the IKTables lookups over the queued legs instead of the
+		polynomial. The inputs are stored in wkq::real_t, so the results are the same as those of the unbatched path
+
+-------------------------------------------------------------------------------------------
+
+FRAMEWORK:
+	1. State_t::beginBatch() 	- 	Puts all State_t objects in batch mode: configureAngles() only queues its inputs
+	2. State_t::endBatch() 		- 	Calls solve() and writes the solved angles back to each queued State_t
+	3. queue() 					- 	Queuing the same LegAngles twice only refreshes its inputs. If the batch is full it is
+									solved before the new leg is queued
+	4. Arguments of acos() are clamped to [-1, 1], i.e. unreachable positions saturate instead of producing NaN
+
+-------------------------------------------------------------------------------------------
+
+*/
+
+#ifndef LEGBATCH_H
+#define LEGBATCH_H
+
+#include "robot_types.h"
+
+#define LEG_BATCH_SIZE 	6
+
+// Type of the queued inputs and of the solved angles - the one of the kernel that solve() runs
+#ifdef IK_TABLES
+typedef wkq::real_t batch_real_t;
+#else
+typedef float batch_real_t;
+#endif
+
+
+class LegBatch{
+
+public:
+	LegBatch();
+	~LegBatch();
+
+	void setParams(const BodyParams& robot_params);
+
+	void queue(const DynamicVars& vars, LegAngles* angles); 	// Store the inputs of a leg and where to write its angles
+	void solve();												// Solve all queued legs in one pass and write back the angles
+
+	int size() const;
+
+private:
+
+	/* ------------------------------------ CONSTANT PARAMETERS ----------------------------------- */
+
+#ifndef IK_TABLES
+	batch_real_t femur;
+	batch_real_t tibia;
+#ifdef DOF3
+	batch_real_t knee_cos_num;									// FEMUR_SQ + TIBIA_SQ
+	batch_real_t knee_cos_den_inv; 								// 1 / (2 * FEMUR * TIBIA)
+	batch_real_t hip_cos_num;									// FEMUR_SQ - TIBIA_SQ
+	batch_real_t hip_cos_den_inv; 								// 1 / (2 * FEMUR)
+#else
+	batch_real_t tibia_inv;
+#endif
+#endif
+
+	/* ------------------------------------ STRUCTURE OF ARRAYS ----------------------------------- */
+
+#ifdef DOF3
+	batch_real_t height[LEG_BATCH_SIZE];
+	batch_real_t hip_to_end[LEG_BATCH_SIZE];
+#ifndef IK_TABLES
+	batch_real_t hip_to_end_sq[LEG_BATCH_SIZE];
+#endif
+	batch_real_t hip[LEG_BATCH_SIZE];
+#else
+	batch_real_t hip_ground_to_ef[LEG_BATCH_SIZE];
+#endif
+	batch_real_t knee[LEG_BATCH_SIZE];
+
+	LegAngles* 	 out[LEG_BATCH_SIZE];							// Where solve() writes the result of each leg
+	int count;
+};
+
+
+#endif
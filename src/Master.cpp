@@ -1,8 +1,13 @@
 #include "Master.h"
 
+#include <cstdio>
+
 #ifndef SIMULATION
 Master::Master(PinName tx, PinName rx, int baud_in) :
-	port(new mbed::Serial(tx, rx)), baud(baud_in), bit_period_(1000000.0/baud_in){}
+	port(new mbed::Serial(tx, rx)), baud(baud_in), bit_period_(1000000.0/baud_in), connected(true){
+	port->baud(baud);
+	port->attach(this, &Master::rxIrq, mbed::SerialBase::RxIrq);
+}
 #endif
 /*
 bool Master::inputWalkForward(){
@@ -29,6 +34,8 @@ bool Master::inputWalkForward(){
 }
 */
 bool Master::inputWalkForward(){
+    if(connected) return walk_forward;
+
     static int out=0;
     int steps=20;
     if(out<steps){
@@ -38,3 +45,228 @@ bool Master::inputWalkForward(){
     return false;
 }
 
+
+
+/*  @ Notes:
+	Consumer side of the RxRing; called from the ControlLoop only. The frame is released whether it decodes or not
+*/
+bool Master::nextCommand(MasterCommand& command){
+	MasterFrame frame;
+	while(nextFrame(frame)){
+		bool valid = decode(frame, command);
+		release(frame);
+		if(valid) return true;
+		invalid_count++;
+	}
+	return false;
+}
+
+bool Master::nextFrame(MasterFrame& frame){
+	while(rx_ring.available() > 0){
+		if(rx_ring.peek(0) != MASTER_SYNC){
+			rx_ring.consume(1);
+			invalid_count++;
+			continue;
+		}
+		if(rx_ring.available() < 3) return false;
+
+		int length = rx_ring.peek(2);
+		if(length > MASTER_MAX_PAYLOAD){
+			rx_ring.consume(1);
+			invalid_count++;
+			continue;
+		}
+		if(rx_ring.available() < length + MASTER_FRAME_OVERHEAD) return false;
+
+		uint8_t crc = 0;
+		for(int i=1; i<length+3; i++) crc = crc8(crc, rx_ring.peek(i));
+		if(crc != rx_ring.peek(length+3)){
+			rx_ring.consume(1);
+			invalid_count++;
+			continue;
+		}
+
+		frame.ring 		= &rx_ring;
+		frame.type 		= rx_ring.peek(1);
+		frame.length 	= length;
+		frame.size 		= length + MASTER_FRAME_OVERHEAD;
+		return true;
+	}
+	return false;
+}
+
+void Master::release(const MasterFrame& frame){
+	rx_ring.consume(frame.size);
+}
+
+
+void Master::sendTelemetry(){
+	if(telemetry == NULL) return;
+
+	uint8_t payload[5];
+	uint8_t frame[5 + MASTER_FRAME_OVERHEAD];
+	uint16_t updates = (uint16_t)telemetry->updates();
+	payload[0] = updates & 0xFF;
+	payload[1] = updates >> 8;
+	payload[2] = (uint8_t)telemetry->maxTemperature();
+	payload[3] = (uint8_t)telemetry->minVoltage();
+	payload[4] = (uint8_t)telemetry->errorCount();
+	send(frame, encode(MC_TELEMETRY, payload, 5, frame));
+}
+
+/*  @ Notes:
+	A phase that never ran is answered with zero occurrences
+*/
+void Master::sendTiming(int phase){
+	const PhaseTiming* timing = PhaseTimer::get(phase);
+	uint32_t values[7] = { 0, 0, 0, 0, 0, 0, 0 };
+	if(timing != NULL){
+		values[0] = timing->occurrences;
+		values[1] = timing->overruns;
+		values[2] = timing->segments[PS_COMPUTE].max;
+		values[3] = timing->segments[PS_WRITE].max;
+		values[4] = timing->segments[PS_JITTER].percentile(50);
+		values[5] = timing->segments[PS_JITTER].percentile(99);
+		values[6] = timing->segments[PS_JITTER].max;
+	}
+
+	uint8_t payload[15];
+	uint8_t frame[15 + MASTER_FRAME_OVERHEAD];
+	payload[0] = (uint8_t)phase;
+	for(int i=0; i<7; i++){
+		uint16_t value = (values[i] > 0xFFFF) ? 0xFFFF : (uint16_t)values[i];
+		payload[1+2*i] = value & 0xFF;
+		payload[2+2*i] = value >> 8;
+	}
+	send(frame, encode(MC_TIMING, payload, 15, frame));
+}
+
+
+int Master::encode(uint8_t type, const uint8_t* payload, int length, uint8_t* out){
+	out[0] = MASTER_SYNC;
+	out[1] = type;
+	out[2] = (uint8_t)length;
+	uint8_t crc = crc8(crc8(0, type), (uint8_t)length);
+	for(int i=0; i<length; i++){
+		out[3+i] = payload[i];
+		crc = crc8(crc, payload[i]);
+	}
+	out[3+length] = crc;
+	return length + MASTER_FRAME_OVERHEAD;
+}
+
+// CRC-8 with polynomial 0x07, bit by bit - no table in flash for a few bytes per command
+uint8_t Master::crc8(uint8_t crc, uint8_t byte){
+	crc ^= byte;
+	for(int i=0; i<8; i++) crc = (crc & 0x80) ? (uint8_t)((crc << 1) ^ 0x07) : (uint8_t)(crc << 1);
+	return crc;
+}
+
+
+/* ================================================= PRIVATE METHODS ================================================= */
+
+bool Master::decode(const MasterFrame& frame, MasterCommand& command){
+	switch(frame.type){
+		case MC_STOP:
+			if(frame.length != 0) return false;
+			walk_forward = false;
+			break;
+		case MC_MOVE:
+			if(frame.length != 3 || frame.u8(0) > wkq::RM_HEXAPOD_GAIT_VELOCITY) return false;
+			command.movement 	= (wkq::RobotMovement_t)frame.u8(0);
+			command.coeff 		= frame.i16(1)/32767.0;
+			if(command.coeff < -1.0) command.coeff = -1.0;
+			walk_forward = true;
+			break;
+		case MC_STATE:
+			if(frame.length != 1 || !validState(frame.u8(0))) return false;
+			command.state = (wkq::RobotState_t)frame.u8(0);
+			break;
+		case MC_HEIGHT:
+			if(frame.length != 2) return false;
+			command.coeff = frame.i16(0)/100.0;
+			break;
+		case MC_TELEMETRY:
+			if(frame.length != 0) return false;
+			break;
+		case MC_TIMING:
+			if(frame.length != 1) return false;
+			command.phase = frame.u8(0);
+			break;
+		default:
+			return false;
+	}
+	command.type = (MasterCommand_t)frame.type;
+	return true;
+}
+
+// RobotState_t values are not contiguous
+bool Master::validState(int state){
+	switch(state){
+		case wkq::RS_DEFAULT:
+		case wkq::RS_STANDING:
+		case wkq::RS_CENTERED:
+		case wkq::RS_STANDING_QUAD:
+		case wkq::RS_FLAT_QUAD:
+		case wkq::RS_QUAD_SETUP:
+		case wkq::RS_RECTANGULAR:
+		case wkq::RS_FLY_STANDING_QUAD:
+		case wkq::RS_FLY_STRAIGHT_QUAD:
+			return true;
+		default:
+			return false;
+	}
+}
+
+#ifndef SIMULATION
+// Producer side of the RxRing: empties the UART FIFO
+void Master::rxIrq(){
+	while(port->readable()) rx_ring.push((uint8_t)port->getc());
+}
+#else
+void Master::receive(const uint8_t* data, int size){
+	connected = true;
+	for(int i=0; i<size; i++) rx_ring.push(data[i]);
+}
+#endif
+
+void Master::send(const uint8_t* data, int size){
+#ifndef SIMULATION
+	if(!connected) return;
+	for(int i=0; i<size; i++) port->putc(data[i]);
+#else
+	printf("MASTER TX");
+	for(int i=0; i<size; i++) printf(" %02X", data[i]);
+	printf("\n\r");
+#endif
+}
+
+unsigned long Master::dropped() const{
+	return rx_ring.dropped();
+}
+
+unsigned long Master::invalid() const{
+	return invalid_count;
+}
+
+
+uint8_t MasterFrame::u8(int i) const{
+	return ring->peek(3 + i);
+}
+
+int16_t MasterFrame::i16(int i) const{
+	return (int16_t)u16(i);
+}
+
+uint16_t MasterFrame::u16(int i) const{
+	return (uint16_t)(ring->peek(3 + i) | (ring->peek(4 + i) << 8));
+}
+
+
+void Master::setTelemetry(const Telemetry* telemetry_in){
+	telemetry = telemetry_in;
+}
+
+const Telemetry* Master::getTelemetry() const{
+	return telemetry;
+}
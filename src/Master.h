@@ -4,8 +4,35 @@ Class used to model the Master microcontroller that issues commands to the mbed
 ===========================================================================================
 
 CURRENT STATE: 
-	1. Only some definitions and member data available. 
-	2. Needs to be implemented and a corresponding class needs to be implemented in the Pixhawk autopilot
+	1. Commands are received on the serial port: the RX interrupt pushes the raw bytes into an RxRing and the
+		ControlLoop decodes them with nextCommand() without ever disabling the interrupts
+	2. Needs a corresponding class to be implemented in the Pixhawk autopilot
+
+-------------------------------------------------------------------------------------------
+
+FRAMEWORK:
+	1. Every message is a frame: MASTER_SYNC, type, payload length, payload, CRC-8 (polynomial 0x07, initial 0)
+		over type, length and payload. Multi byte values are little endian
+	2. Frames are parsed in place on the RxRing: nextFrame() only peeks at the bytes and the payload is read
+		through the MasterFrame view until the frame is released. A byte that does not start a valid frame - wrong
+		sync, length over MASTER_MAX_PAYLOAD, bad CRC - is dropped and the search goes on from the next one, so
+		the parser resynchronizes after any lost or corrupt byte. A frame not complete yet stays in the ring
+	3. Payloads of the commands, with their exact length:
+		MC_STOP 		- 	none
+		MC_MOVE 		- 	RobotMovement_t (1), coeff in 1/32767 (int16)
+		MC_STATE 		- 	RobotState_t (1)
+		MC_HEIGHT 		- 	body raise in 0.1 mm (int16)
+		MC_TELEMETRY 	- 	none; answered with a MC_TELEMETRY frame of the last snapshot: updates (uint16),
+							max temperature in C (1), min voltage in 0.1 V (1), servos with errors (1)
+		MC_TIMING 		- 	PhaseTimer phase (1); answered with a MC_TIMING frame: phase (1), occurrences, deadline
+							overruns, compute max, write max, jitter p50, p99 and max in us (uint16 each, saturated)
+		A frame of an unknown type, with a different length or with a movement or state that is not a
+		RobotMovement_t/RobotState_t is counted as invalid and skipped
+	4. The Robot drains the commands in the sense stage of every ControlLoop cycle, so a command acts within one
+		period of its last byte
+	5. inputWalkForward() is true between a MC_MOVE and a MC_STOP. A Master without a port replays a fixed test
+		sequence instead - 20 half cycles
+	6. In SIMULATION receive() feeds bytes as the RX interrupt would and the replies are printed in hex
 
 -------------------------------------------------------------------------------------------
 
@@ -19,6 +46,47 @@ CURRENT STATE:
 #include "mbed.h"
 #endif
 
+#include <cstddef>
+#include <stdint.h>
+#include "wkq.h"
+#include "Telemetry.h"
+#include "RxRing.h"
+#include "PhaseTimer.h"
+
+#define MASTER_SYNC 			0xA5
+#define MASTER_MAX_PAYLOAD 		16
+#define MASTER_FRAME_OVERHEAD 	4 			// sync, type, length, CRC
+
+enum MasterCommand_t{
+	MC_STOP 		= 0, 		// finish the walk
+	MC_MOVE 		= 1, 		// walk with movement at coeff
+	MC_STATE 		= 2, 		// Robot::setState()
+	MC_HEIGHT 		= 3, 		// Robot::raiseBody()
+	MC_TELEMETRY 	= 4, 		// send the last Telemetry snapshot
+	MC_TIMING 		= 5, 		// send the PhaseTimer histograms of a phase
+	MC_COUNT 		= 6
+};
+
+struct MasterCommand{
+	MasterCommand_t type;
+	wkq::RobotMovement_t movement;
+	wkq::RobotState_t state;
+	double coeff; 								// MC_MOVE: [-1, 1]; MC_HEIGHT: cm
+	int phase; 									// MC_TIMING
+};
+
+// A frame waiting in the RxRing; valid until Master::release()
+struct MasterFrame{
+	const RxRing* ring;
+	uint8_t type;
+	int length; 								// payload bytes
+	int size; 									// bytes of the whole frame
+
+	uint8_t u8(int i) const;
+	int16_t i16(int i) const;
+	uint16_t u16(int i) const;
+};
+
 class Master{
 public:
 
@@ -28,15 +96,48 @@ public:
 	Master(){}
 
 	bool inputWalkForward();
+	bool nextCommand(MasterCommand& command); 			// Decode the next command received; false if none is complete
+
+	bool nextFrame(MasterFrame& frame); 				// Next valid frame, left in the RxRing; false if none is complete
+	void release(const MasterFrame& frame);
+
+	void sendTelemetry(); 								// Answer a MC_TELEMETRY request
+	void sendTiming(int phase); 						// Answer a MC_TIMING request
+
+	static int encode(uint8_t type, const uint8_t* payload, int length, uint8_t* out); 	// frame size
+	static uint8_t crc8(uint8_t crc, uint8_t byte);
+
+#ifdef SIMULATION
+	void receive(const uint8_t* data, int size);
+#endif
+
+	unsigned long dropped() const; 						// bytes lost because the RxRing was full
+	unsigned long invalid() const; 						// bytes skipped and frames that are not a valid command
+
+	void setTelemetry(const Telemetry* telemetry_in); 	// Snapshot the Robot keeps up to date
+	const Telemetry* getTelemetry() const;
 
 private:
 
+	bool decode(const MasterFrame& frame, MasterCommand& command);
+	static bool validState(int state);
+	void send(const uint8_t* data, int size);
+
 #ifndef SIMULATION   
+	void rxIrq();
+
     mbed::Serial* port;
 #endif
     int baud;
     double bit_period_;
 
+    RxRing rx_ring;
+    bool connected = false; 							// commands come from a port, not the test sequence
+    bool walk_forward = false;
+    unsigned long invalid_count = 0;
+
+    const Telemetry* telemetry = NULL;
+
     int call=0;
     int steps1=20;
     int steps2=20;
@@ -45,5 +146,3 @@ private:
 
 
 #endif
-
-
@@ -0,0 +1,120 @@
+#include "MathStats.h"
+
+const char* const wkq::math::phase_names[wkq::math::PHASE_COUNT] = { "other", "liftUp", "body", "step", "finish" };
+
+#ifdef MATH_STATS
+
+#include <cstdio>
+#include <cstring>
+#include <stdint.h>
+
+struct MathSite{
+	const char* file;
+	int line;
+	wkq::math::Fn fn;
+	uint32_t calls[wkq::math::PHASE_COUNT];
+};
+
+static const char* fn_names[wkq::math::FN_COUNT] = { "sqrt", "sin", "cos", "asin", "acos", "atan", "atan2", "pow" };
+
+static MathSite sites[MATH_STATS_MAX_SITES];
+static int site_count = 0;
+static uint32_t fn_totals[wkq::math::FN_COUNT][wkq::math::PHASE_COUNT];
+static wkq::math::Phase current_phase = wkq::math::PHASE_OTHER;
+
+
+// Only the part after the last '/' so that the report stays readable
+static const char* baseName(const char* file){
+	const char* base = strrchr(file, '/');
+	return (base != NULL) ? base + 1 : file;
+}
+
+
+void wkq::math::record(Fn fn, const char* file, int line){
+	fn_totals[fn][current_phase]++;
+
+	for(int i=0; i<site_count; i++){
+		if(sites[i].line == line && sites[i].fn == fn && (sites[i].file == file || strcmp(sites[i].file, file) == 0)){
+			sites[i].calls[current_phase]++;
+			return;
+		}
+	}
+	if(site_count == MATH_STATS_MAX_SITES) return;
+
+	MathSite& site = sites[site_count++];
+	site.file = file;
+	site.line = line;
+	site.fn = fn;
+	memset(site.calls, 0, sizeof(site.calls));
+	site.calls[current_phase] = 1;
+}
+
+
+void wkq::math::setPhase(Phase phase){
+	current_phase = phase;
+}
+
+
+/*  @ Notes:
+	Sites are printed in decreasing order of total calls. Selection sort over an index array since the table is small
+	and the report is not on the hot path
+*/
+void wkq::math::report(const char* title){
+	int order[MATH_STATS_MAX_SITES];
+	uint32_t totals[MATH_STATS_MAX_SITES];
+	uint32_t phase_totals[PHASE_COUNT] = { 0 };
+	uint32_t total = 0;
+
+	for(int i=0; i<site_count; i++){
+		order[i] = i;
+		totals[i] = 0;
+		for(int p=0; p<PHASE_COUNT; p++) totals[i] += sites[i].calls[p];
+	}
+	for(int i=0; i<site_count; i++){
+		int best = i;
+		for(int j=i+1; j<site_count; j++) if(totals[order[j]] > totals[order[best]]) best = j;
+		int tmp = order[i]; order[i] = order[best]; order[best] = tmp;
+	}
+
+	printf("\n\rMATH STATS: %s\n\r", title);
+	printf("%-28s %-6s %8s", "call site", "fn", "total");
+	for(int p=0; p<PHASE_COUNT; p++) printf(" %8s", phase_names[p]);
+	printf("\n\r");
+
+	for(int i=0; i<site_count; i++){
+		const MathSite& site = sites[order[i]];
+		char location[64];
+		snprintf(location, sizeof(location), "%s:%d", baseName(site.file), site.line);
+
+		printf("%-28s %-6s %8lu", location, fn_names[site.fn], (unsigned long)totals[order[i]]);
+		for(int p=0; p<PHASE_COUNT; p++) printf(" %8lu", (unsigned long)site.calls[p]);
+		printf("\n\r");
+	}
+	if(site_count == MATH_STATS_MAX_SITES) printf("WARNING: call site table full, increase MATH_STATS_MAX_SITES\n\r");
+
+	printf("%-35s %8s", "per function", "total");
+	for(int p=0; p<PHASE_COUNT; p++) printf(" %8s", phase_names[p]);
+	printf("\n\r");
+	for(int f=0; f<FN_COUNT; f++){
+		uint32_t fn_total = 0;
+		for(int p=0; p<PHASE_COUNT; p++){
+			fn_total += fn_totals[f][p];
+			phase_totals[p] += fn_totals[f][p];
+		}
+		if(fn_total == 0) continue;
+		total += fn_total;
+
+		printf("%-35s %8lu", fn_names[f], (unsigned long)fn_total);
+		for(int p=0; p<PHASE_COUNT; p++) printf(" %8lu", (unsigned long)fn_totals[f][p]);
+		printf("\n\r");
+	}
+	printf("%-35s %8lu", "all", (unsigned long)total);
+	for(int p=0; p<PHASE_COUNT; p++) printf(" %8lu", (unsigned long)phase_totals[p]);
+	printf("\n\r");
+
+	// Reset for the next report
+	site_count = 0;
+	memset(fn_totals, 0, sizeof(fn_totals));
+}
+
+#endif
@@ -0,0 +1,116 @@
+/*
+
+Math Statistics: Call accounting for the transcendental functions of the kinematics
+===========================================================================================
+
+FUNCTIONALITY:
+	1. wkq::math::sqrt, sin, cos, asin, acos, atan, atan2 and pow are drop-in wrappers for the <cmath> functions. They
+		forward to the standard function for float/double and to the wkq overloads for wkq::Fixed
+	2. With MATH_STATS defined at build time (make MATH_STATS=1) every call is counted per call site (file:line) and
+		per gait phase. Robot::makeMovement() sets the phase and prints the report when the movement ends
+	3. Without MATH_STATS the wrappers are plain inline forwards and WKQ_MATH_PHASE()/WKQ_MATH_REPORT() expand to
+		nothing, so the instrumentation compiles away completely
+
+-------------------------------------------------------------------------------------------
+
+FRAMEWORK:
+	1. The call site is captured through default arguments __builtin_FILE()/__builtin_LINE(), which GCC evaluates at
+		the point of the call
+	2. Call sites are kept in a fixed table of MATH_STATS_MAX_SITES entries - no heap. Calls from sites that do not fit
+		are still counted in the phase and function totals
+	3. Counters are reset after every report
+	4. The LegBatch kernel (make LEG_BATCH=1) does not go through the wrappers. LegBatch::queue() records its acos()
+		calls instead, so they are counted in the phase of the movement that queued the leg
+
+-------------------------------------------------------------------------------------------
+
+*/
+
+#ifndef MATH_STATS_H
+#define MATH_STATS_H
+
+#include <cmath>
+
+#define MATH_STATS_MAX_SITES 	96
+
+namespace wkq{
+namespace math{
+
+	enum Fn{ FN_SQRT, FN_SIN, FN_COS, FN_ASIN, FN_ACOS, FN_ATAN, FN_ATAN2, FN_POW, FN_COUNT };
+
+	enum Phase{
+		PHASE_OTHER 		= 0,		// anything outside a gait - setting static positions, construction
+		PHASE_LIFT_UP 		= 1,
+		PHASE_BODY_MOVE 	= 2,
+		PHASE_STEP 			= 3,
+		PHASE_FINISH_STEP 	= 4,
+		PHASE_COUNT 		= 5
+	};
+
+	extern const char* const phase_names[PHASE_COUNT]; 		// for the reports of MathStats and Airtime
+
+#ifdef MATH_STATS
+	void record(Fn fn, const char* file, int line);
+	void setPhase(Phase phase);
+	void report(const char* title);				// Print the counters and reset them
+#endif
+
+	// Unqualified calls inside impl find std:: for the built-in types and wkq:: (through ADL) for wkq::Fixed
+	namespace impl{
+		using std::sqrt;
+		using std::sin;
+		using std::cos;
+		using std::asin;
+		using std::acos;
+		using std::atan;
+		using std::atan2;
+		using std::pow;
+
+		template<typename T> inline auto sqrt_(T x) -> decltype(sqrt(x)) { return sqrt(x); }
+		template<typename T> inline auto sin_(T x) -> decltype(sin(x)) { return sin(x); }
+		template<typename T> inline auto cos_(T x) -> decltype(cos(x)) { return cos(x); }
+		template<typename T> inline auto asin_(T x) -> decltype(asin(x)) { return asin(x); }
+		template<typename T> inline auto acos_(T x) -> decltype(acos(x)) { return acos(x); }
+		template<typename T> inline auto atan_(T x) -> decltype(atan(x)) { return atan(x); }
+		template<typename T, typename U> inline auto atan2_(T y, U x) -> decltype(atan2(y, x)) { return atan2(y, x); }
+		template<typename T, typename U> inline auto pow_(T x, U y) -> decltype(pow(x, y)) { return pow(x, y); }
+	}
+
+#ifdef MATH_STATS
+#define WKQ_MATH_WRAP_1(name, fn) \
+	template<typename T> inline auto name(T x, const char* file = __builtin_FILE(), int line = __builtin_LINE()) \
+		-> decltype(impl::name##_(x)) { record(fn, file, line); return impl::name##_(x); }
+#define WKQ_MATH_WRAP_2(name, fn) \
+	template<typename T, typename U> inline auto name(T a, U b, const char* file = __builtin_FILE(), int line = __builtin_LINE()) \
+		-> decltype(impl::name##_(a, b)) { record(fn, file, line); return impl::name##_(a, b); }
+#else
+#define WKQ_MATH_WRAP_1(name, fn) \
+	template<typename T> inline auto name(T x) -> decltype(impl::name##_(x)) { return impl::name##_(x); }
+#define WKQ_MATH_WRAP_2(name, fn) \
+	template<typename T, typename U> inline auto name(T a, U b) -> decltype(impl::name##_(a, b)) { return impl::name##_(a, b); }
+#endif
+
+	WKQ_MATH_WRAP_1(sqrt, FN_SQRT)
+	WKQ_MATH_WRAP_1(sin, FN_SIN)
+	WKQ_MATH_WRAP_1(cos, FN_COS)
+	WKQ_MATH_WRAP_1(asin, FN_ASIN)
+	WKQ_MATH_WRAP_1(acos, FN_ACOS)
+	WKQ_MATH_WRAP_1(atan, FN_ATAN)
+	WKQ_MATH_WRAP_2(atan2, FN_ATAN2)
+	WKQ_MATH_WRAP_2(pow, FN_POW)
+
+#undef WKQ_MATH_WRAP_1
+#undef WKQ_MATH_WRAP_2
+
+}
+}
+
+#ifdef MATH_STATS
+#define WKQ_MATH_PHASE(phase) 		wkq::math::setPhase(phase)
+#define WKQ_MATH_REPORT(title) 		wkq::math::report(title)
+#else
+#define WKQ_MATH_PHASE(phase)
+#define WKQ_MATH_REPORT(title)
+#endif
+
+#endif
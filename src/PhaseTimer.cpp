@@ -0,0 +1,182 @@
+#include "PhaseTimer.h"
+
+#include <cstdio>
+#include <cstring>
+
+#include "Airtime.h"
+
+#ifdef SIMULATION
+#include <chrono>
+#endif
+
+// Initialize static variables
+PhaseTiming PhaseTimer::phases[PHASE_TIMER_MAX_PHASES];
+int PhaseTimer::current = -1;
+double PhaseTimer::start = 0;
+double PhaseTimer::cpu_start = 0;
+double PhaseTimer::write_start = 0;
+double PhaseTimer::write_end = -1;
+bool PhaseTimer::computed = false;
+int PhaseTimer::last_write_phase = -1;
+double PhaseTimer::last_write = 0;
+double PhaseTimer::nominal = 0;
+
+static const char* segment_names[PS_COUNT] = { "compute", "write", "settle", "jitter" };
+
+
+/* ================================================= PHASE HISTOGRAM ================================================= */
+
+void PhaseHistogram::add(double us){
+	uint32_t value = (us <= 0) ? 0 : (uint32_t)(us + 0.5);
+	if(count == 0 || value < min) min = value;
+	if(value > max) max = value;
+	sum += value;
+	count++;
+
+	int b = 0;
+	while(b < PHASE_TIMER_BUCKETS-1 && (value >> b) != 0) b++;
+	if(buckets[b] != 0xFFFF) buckets[b]++;
+}
+
+uint32_t PhaseHistogram::percentile(int percent) const{
+	if(count == 0) return 0;
+	unsigned long total = 0;
+	for(int b=0; b<PHASE_TIMER_BUCKETS; b++) total += buckets[b];
+
+	unsigned long rank = (total * percent + 99) / 100;
+	unsigned long seen = 0;
+	for(int b=0; b<PHASE_TIMER_BUCKETS; b++){
+		seen += buckets[b];
+		if(seen >= rank && seen > 0){
+			uint32_t upper = (b == 0) ? 0 : ((uint32_t)1 << b) - 1;
+			return (upper > max || b == PHASE_TIMER_BUCKETS-1) ? max : upper;
+		}
+	}
+	return max;
+}
+
+double PhaseHistogram::mean() const{
+	return (count == 0) ? 0.0 : sum / count;
+}
+
+
+/* ================================================= PHASES ================================================= */
+
+void PhaseTimer::begin(int phase, const char* name){
+	close();
+	if(phase < 0 || phase >= PHASE_TIMER_MAX_PHASES){
+		printf("ERROR: PhaseTimer::begin - phase %d out of range, increase PHASE_TIMER_MAX_PHASES\n\r", phase);
+		return;
+	}
+	phases[phase].name = name;
+	current 	= phase;
+	start 		= Airtime::now();
+	cpu_start 	= cpuNow();
+	write_end 	= -1;
+	computed 	= false;
+}
+
+void PhaseTimer::end(){
+	close();
+	last_write_phase 	= -1;
+	nominal 			= 0;
+}
+
+void PhaseTimer::expect(double duration){
+	if(current >= 0) nominal += duration * 1000000.0;
+}
+
+
+/*  @ Notes:
+	Only the first write of a phase ends its compute segment and closes the interval of the previous write
+*/
+void PhaseTimer::writeBegin(){
+	if(current < 0 || write_end >= 0) return;
+
+	double time = Airtime::now();
+	phases[current].segments[PS_COMPUTE].add(cpuNow() - cpu_start);
+	computed 	= true;
+	write_start = time;
+	write_end 	= time;
+
+	if(last_write_phase >= 0){
+		double interval = time - last_write;
+		double jitter 	= interval - nominal;
+		phases[last_write_phase].segments[PS_JITTER].add((jitter < 0) ? -jitter : jitter);
+		if(jitter > PHASE_DEADLINE_SLACK_US) phases[last_write_phase].overruns++;
+	}
+	last_write_phase 	= current;
+	last_write 			= time;
+	nominal 			= 0;
+}
+
+void PhaseTimer::writeEnd(double end){
+	if(current >= 0 && write_end >= 0 && end > write_end) write_end = end;
+}
+
+
+const PhaseTiming* PhaseTimer::get(int phase){
+	if(phase < 0 || phase >= PHASE_TIMER_MAX_PHASES || phases[phase].occurrences == 0) return NULL;
+	return &phases[phase];
+}
+
+unsigned long PhaseTimer::overruns(){
+	unsigned long total = 0;
+	for(int i=0; i<PHASE_TIMER_MAX_PHASES; i++) total += phases[i].overruns;
+	return total;
+}
+
+
+void PhaseTimer::report(const char* title){
+	close();
+
+	printf("\n\rPHASE TIMING: %s, deadline slack %d us, %lu overruns\n\r", title, PHASE_DEADLINE_SLACK_US, overruns());
+	printf("%-10s %6s %8s %-8s %9s %9s %9s %9s %9s %9s\n\r", "phase", "count", "overruns", "segment", "min us",
+		"mean us", "p50 us", "p90 us", "p99 us", "max us");
+
+	for(int p=0; p<PHASE_TIMER_MAX_PHASES; p++){
+		const PhaseTiming& timing = phases[p];
+		if(timing.occurrences == 0) continue;
+
+		for(int s=0; s<PS_COUNT; s++){
+			const PhaseHistogram& histogram = timing.segments[s];
+			if(histogram.count == 0) continue;
+			printf("%-10s %6lu %8lu %-8s %9lu %9.1f %9lu %9lu %9lu %9lu\n\r", timing.name, timing.occurrences,
+				timing.overruns, segment_names[s], (unsigned long)histogram.min, histogram.mean(),
+				(unsigned long)histogram.percentile(50), (unsigned long)histogram.percentile(90),
+				(unsigned long)histogram.percentile(99), (unsigned long)histogram.max);
+		}
+	}
+
+	// Reset for the next report
+	memset(phases, 0, sizeof(phases));
+}
+
+
+/* ================================================= PRIVATE METHODS ================================================= */
+
+// Clock of the compute segment: the simulated clock does not move while the host computes
+double PhaseTimer::cpuNow(){
+#ifndef SIMULATION
+	return Airtime::now();
+#else
+	using namespace std::chrono;
+	return duration_cast<duration<double, std::micro> >(steady_clock::now().time_since_epoch()).count();
+#endif
+}
+
+// Ends the occurrence of the phase in progress
+void PhaseTimer::close(){
+	if(current < 0) return;
+
+	PhaseTiming& timing = phases[current];
+	double time = Airtime::now();
+	if(!computed) timing.segments[PS_COMPUTE].add(cpuNow() - cpu_start);
+	if(write_end >= 0){
+		timing.segments[PS_WRITE].add(write_end - write_start);
+		timing.segments[PS_SETTLE].add(time - write_end);
+	}
+	else timing.segments[PS_SETTLE].add(time - start);
+	timing.occurrences++;
+	current = -1;
+}
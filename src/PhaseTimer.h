@@ -0,0 +1,106 @@
+/*
+
+PhaseTimer Class: Deadline and jitter histograms of the gait phases
+===========================================================================================
+
+FUNCTIONALITY:
+	1. Timestamps every occurrence of a gait phase and splits it in segments: IK compute from the start of the
+		phase to its first bus write, bus write until the last byte of the phase is off the wire, and settle from
+		there to the start of the next phase
+	2. Measures the interval between the first writes of consecutive phases against the nominal wait between them:
+		the difference is the jitter, and an interval longer than the nominal wait + PHASE_DEADLINE_SLACK_US is a
+		deadline overrun
+	3. Keeps a histogram per phase and segment - count, min, mean, max and percentiles. report() prints them and
+		resets; get() gives them to the Master without resetting
+
+-------------------------------------------------------------------------------------------
+
+FRAMEWORK:
+	1. All methods are static. Robot::tick() opens a phase with begin() for every gait state it runs, Robot::pause()
+		gives its nominal wait with expect() and the end of the walk closes it with end(). DnxBus marks the writes
+		with writeBegin()/writeEnd(). The packets go out in the background, so the write ends with the
+		last packet of the slowest bus: its start plus its wire time at 10 bits per byte. With a SetpointStream the
+		write lasts until the last setpoint of the wait
+	2. Times are us on the clock of Airtime::now(). On the host the compute segment is real time from std::chrono,
+		the other segments are on the simulated clock of SimDnxHAL.h
+	3. Histograms have one bucket per power of two: percentiles are the upper bound of their bucket, clamped to
+		the max, so they are within a factor of two
+	4. Phases are numbered by the caller, at most PHASE_TIMER_MAX_PHASES; a phase without a write has no write
+		segment and its settle starts when the phase is opened
+
+-------------------------------------------------------------------------------------------
+
+*/
+
+#ifndef PHASETIMER_H
+#define PHASETIMER_H
+
+#include <stdint.h>
+
+#define PHASE_TIMER_MAX_PHASES 		8
+#define PHASE_TIMER_BUCKETS 		20 			// bucket b holds [2^(b-1), 2^b) us, bucket 0 holds 0
+#define PHASE_DEADLINE_SLACK_US 	1000
+
+enum PhaseSegment_t{
+	PS_COMPUTE 		= 0, 		// start of the phase to its first write
+	PS_WRITE 		= 1, 		// first write until the last byte is off the wire
+	PS_SETTLE 		= 2, 		// last byte off the wire to the start of the next phase
+	PS_JITTER 		= 3, 		// |interval between the first writes of two phases - nominal wait|
+	PS_COUNT 		= 4
+};
+
+struct PhaseHistogram{
+	unsigned long count;
+	uint32_t min;
+	uint32_t max;
+	double sum;
+	uint16_t buckets[PHASE_TIMER_BUCKETS]; 			// saturating
+
+	void add(double us);
+	uint32_t percentile(int percent) const;
+	double mean() const;
+};
+
+struct PhaseTiming{
+	const char* name;
+	unsigned long occurrences;
+	unsigned long overruns; 							// deadline overruns of the wait after the phase
+	PhaseHistogram segments[PS_COUNT];
+};
+
+
+class PhaseTimer{
+
+public:
+
+	static void begin(int phase, const char* name); 	// Close the phase in progress and open this one
+	static void end(); 									// Close the phase in progress
+	static void expect(double duration); 				// Nominal wait after the phase in progress, s
+
+	static void writeBegin();
+	static void writeEnd(double end); 					// end - Airtime::now() when the last byte is off the wire
+
+	static const PhaseTiming* get(int phase); 			// NULL if the phase never ran
+	static unsigned long overruns();
+	static void report(const char* title); 				// Print the histograms and reset them
+
+private:
+
+	static double cpuNow();
+	static void close();
+
+	static PhaseTiming phases[PHASE_TIMER_MAX_PHASES];
+
+	static int current; 								// -1 - no phase open
+	static double start; 								// Airtime::now() at begin()
+	static double cpu_start; 							// cpuNow() at begin()
+	static double write_start;
+	static double write_end; 							// -1 - no write in the phase
+	static bool computed; 								// compute segment recorded
+
+	static int last_write_phase; 						// phase of the last first write; -1 - none
+	static double last_write; 							// Airtime::now() of the last first write
+	static double nominal; 								// us of waits expected since the last first write
+};
+
+#endif
@@ -2,16 +2,28 @@
 
 const double Robot::wait_time_ = 0.1;
 //const double Robot::wait_time_ = 1;
+const int Robot::velocity_segments_ = 4;
 const double Robot::ef_raise_ = State_t::ef_raise;
 
-Robot::Robot(Master* pixhawk_in, unordered_map<int, DnxHAL*>& servo_map, double height_in, const BodyParams& robot_params, wkq::RobotState_t state_in /*= wkq::RS_DEFAULT*/) :
+static const char* gait_state_names[] = { "idle", "lift", "body", "velocity", "finishUp", "liftDown", "finishDown" };
+
+Robot::Robot(Master* pixhawk_in, ServoMap& servo_map, double height_in, const BodyParams& robot_params, wkq::RobotState_t state_in /*= wkq::RS_DEFAULT*/) :
 	Tripods{
 		Tripod(wkq::KNEE_LEFT_FRONT, wkq::KNEE_RIGHT_MIDDLE, wkq::KNEE_LEFT_BACK, servo_map, height_in, robot_params),
 		Tripod(wkq::KNEE_RIGHT_FRONT, wkq::KNEE_LEFT_MIDDLE, wkq::KNEE_RIGHT_BACK, servo_map, height_in, robot_params)
 	}, 
-	pixhawk(pixhawk_in), state(state_in){
+	pixhawk(pixhawk_in), streaming(false), state(state_in){
+
+	gait.state = GS_IDLE;
 	
 	if(debug_) printf("ROBOT start\n\r");
+	if(pixhawk != NULL) pixhawk->setTelemetry(&telemetry);
+
+	// Periodic tasks serviced while the Robot waits for its servos
+	if(pixhawk != NULL) ControlLoop::addTask("master", CS_SENSE, CONTROL_EVERY_CYCLE, &Robot::masterTask, this);
+	telemetry_task = ControlLoop::addTask("telemetry", CS_SENSE, 0, &Robot::telemetryTask, this);
+	ControlLoop::addTask("gait", CS_PLAN, CONTROL_EVERY_CYCLE, &Robot::gaitTask, this);
+	ControlLoop::addTask("setpoints", CS_WRITE, CONTROL_EVERY_CYCLE, &Robot::setpointTask);
 	
 	// Calculate max size for movements
 	max_step_size = 		State_t::max_step_size;
@@ -31,111 +43,115 @@ Robot::~Robot(){}
 
 /* ================================================= STATIC POSITIONS ================================================= */
 
+// Without wait_call the goals of both Tripods are sent together
 void Robot::setState(wkq::RobotState_t state_in, bool wait_call/*=false*/){
+	if(!wait_call) DnxBus::beginSync();
 	for(int i=0; i<TRIPOD_COUNT; i++){
 		Tripods[i].setPosition(state_in);
-		if(wait_call) wait(wait_time_);
+		if(wait_call) ControlLoop::run(wait_time_);
 	}
+	if(!wait_call) DnxBus::endSync();
 	state = state_in;
 }
 
 /* ================================================= WALK RELATED FUNCTIONALITY ================================================= */
 
 void Robot::makeMovement(RobotMovement_t movement, double coeff){
-	double move_arg;
-	bool continue_movement;
-	int tripod_up, tripod_down;
-
-	void (Tripod::*move_body)(double);
-	void (Tripod::*make_step)(double);
-	void (Tripod::*finish_step)();
-
-	if(coeff < -1.0) coeff = -1.0;
-	if(coeff > 1.0)  coeff = 1.0;
-
-	continue_movement 	= true;
-	//tripod_up 			= TRIPOD_RIGHT;
-	//tripod_down 		= TRIPOD_LEFT;
-	tripod_up 			= TRIPOD_LEFT;
-	tripod_down 		= TRIPOD_RIGHT;
+	if(!startGait(movement, coeff, true)) return;
+	ControlLoop::runWhile(&Robot::walkingCondition, this);
+}
 
-	switch(movement){
-		case wkq::RM_HEXAPOD_GAIT:
-			move_body 		= &Tripod::bodyForward;
-			make_step 		= &Tripod::stepForward;
-			finish_step 	= &Tripod::finishStep;
-			move_arg  		= coeff*max_step_size;
-			break;
-		case wkq::RM_RECTANGULAR_GAIT:
-			move_body 		= &Tripod::bodyForwardRectangularGait;
-			make_step 		= &Tripod::stepForwardRectangularGait;
-			finish_step 	= &Tripod::finishStepRectangularGait;
-			move_arg 		= coeff*max_step_size;
-			break;
-		case wkq::RM_ROTATION_HEXAPOD:
-			move_body	 	= &Tripod::bodyRotate;
-			make_step 		= &Tripod::stepRotate;
-			finish_step 	= &Tripod::finishStep;
-			move_arg 		= coeff*max_rotation_angle;
-			break;
-		case wkq::RM_ROTATION_RECTANGULAR:
-			break;
-		default:
-			printf("ERROR - Robot::makeMovement - movement not implemented\n\r");
-			return;
+/*  @ Notes:
+	Starts at once if no walk is in progress or the first lift is not done yet. Otherwise the walk in progress is
+	finished at the next half cycle and the new one starts after it. The same movement and coefficient cancel a
+	pending stop or new target; if the walk is already in its last half cycle it is started again after it
+*/
+void Robot::walk(RobotMovement_t movement, double coeff){
+	if(gait.state == GS_IDLE || (gait.state == GS_LIFT && gait.first)){
+		startGait(movement, coeff, gait.state != GS_IDLE && gait.follow_master);
+		return;
 	}
 
-	bool first = true;
-	int i=1;
-	// repeat until walkForward signal stops
-	while(continue_movement){
-		// Read input and find out whether movement should go on
-		if(!first) continue_movement = pixhawk->inputWalkForward();
-
-		Tripods[tripod_up].liftUp(ef_raise_);
-		wait(wait_time_);
-
-		if(first || !continue_movement){
-		//if(first){
-			first = false;
-			(Tripods[tripod_down].*move_body)(move_arg);
-		} 	
-		else{
-			(Tripods[tripod_down].*move_body)(2*move_arg);
-		} 
-		//wait(wait_time_);
-
-		// Movement goes on
-		if(continue_movement){
-			/*
-			if(first){
-				(Tripods[tripod_up].*make_step)(move_arg);
-				first = false;		
-			}
-			else{
-				(Tripods[tripod_up].*make_step)(2*move_arg);
-			}	
-			*/
-			(Tripods[tripod_up].*make_step)(2*move_arg);
-			std::swap(tripod_up, tripod_down);			// swap the roles of the Tripods
-			wait(wait_time_);
+	if(movement == gait.movement && GaitCache::quantize(coeff) == gait.coeff_q){
+		gait.stop_requested = false;
+		gait.retarget 		= false;
+		// Before gaitBody() the half cycle can still go on; after it a walk that is not continuing is finishing
+		if(gait.state == GS_BODY) gait.continuing = true;
+		else if(!gait.continuing){
+			gait.retarget 		= true;
+			gait.next_movement 	= movement;
+			gait.next_coeff 	= coeff;
 		}
-		
-		// Movement stops
-		else{
-			(Tripods[tripod_up].*finish_step)();
-			wait(wait_time_);
-			Tripods[tripod_down].liftUp(ef_raise_);
-			wait(wait_time_);
-			(Tripods[tripod_down].*finish_step)();
+		return;
+	}
+	gait.retarget 		= true;
+	gait.next_movement 	= movement;
+	gait.next_coeff 	= coeff;
+}
+
+void Robot::stopWalk(){
+	gait.retarget = false;
+	if(gait.state == GS_LIFT && gait.first) endGait();
+	else if(gait.state != GS_IDLE) gait.stop_requested = true;
+}
+
+void Robot::tick(){
+	if(gait.state == GS_IDLE) return;
+	if(gait.wait > 0 && --gait.wait > 0) return;
+
+	// Phases without a wait after them follow in the same tick
+	while(gait.state != GS_IDLE && gait.wait == 0){
+		PhaseTimer::begin(gait.state, gait_state_names[gait.state]);
+		switch(gait.state){
+			case GS_LIFT: 			gaitLift(); 			break;
+			case GS_BODY: 			gaitBody(); 			break;
+			case GS_BODY_VELOCITY: 	gaitBodyVelocity(); 	break;
+			case GS_FINISH_UP: 		gaitFinishUp(); 		break;
+			case GS_LIFT_DOWN: 		gaitLiftDown(); 		break;
+			case GS_FINISH_DOWN: 	gaitFinishDown(); 		break;
+			default: 				gait.state = GS_IDLE;
 		}
-		i++;
 	}
 }
 
+bool Robot::walking() const{
+	return gait.state != GS_IDLE;
+}
+
+GaitState_t Robot::getGaitState() const{
+	return gait.state;
+}
+
+
+void Robot::setCoordinated(bool coordinated){
+	DnxBus::setSyncMode(coordinated ? DNX_SYNC_STAGED : DNX_SYNC_WRITE);
+}
+
+void Robot::setStreaming(int rate_hz){
+	streaming = rate_hz > 0;
+	if(streaming) ControlLoop::setRate(rate_hz);
+}
+
+
+/* ================================================= TELEMETRY ================================================= */
+
+void Robot::updateTelemetry(){
+	DnxBus::readTelemetry(telemetry);
+	if(telemetry.errorCount() > 0) printf("WARNING: Robot - %d servos with errors or no answer\n\r", telemetry.errorCount());
+}
+
+const Telemetry& Robot::getTelemetry() const{
+	return telemetry;
+}
+
+void Robot::setTelemetryRate(int rate_hz){
+	ControlLoop::setTaskRate(telemetry_task, rate_hz);
+}
+
 
 void Robot::raiseBody(double hraise){
 	if(wkq::compare_doubles(0.0, hraise)) return;
+	gait_cache.invalidate();
 	Tripods[TRIPOD_LEFT].raiseBody(hraise);
 	Tripods[TRIPOD_RIGHT].copyState(Tripods[TRIPOD_LEFT]);
 }
@@ -170,12 +186,12 @@ void Robot::singleStepForwardTest(double coeff){
 	bool continue_movement = true;
 	int tripod_up = TRIPOD_LEFT, tripod_down = TRIPOD_RIGHT;
 		
-	wait(wait_time_);
+	ControlLoop::run(wait_time_);
 	Tripods[tripod_up].liftUp(ef_raise_);
-	wait(wait_time_);
+	ControlLoop::run(wait_time_);
 	if(debug_) printf("First tripod lifted\n\r");
 	Tripods[tripod_down].bodyForward(step_size);
-	wait(wait_time_);
+	ControlLoop::run(wait_time_);
 	if(debug_) printf("Second tripod moved body forward\n\r");
 
 	Tripods[tripod_up].stepForward(step_size);
@@ -207,6 +223,288 @@ void Robot::decodeInstruction(wkq_msgs::RPC::Request &req, wkq_msgs::RPC::Reques
 
 /* ================================================= PRIVATE METHODS ================================================= */
 
+bool Robot::startGait(RobotMovement_t movement, double coeff, bool follow_master){
+	if(coeff < -1.0) coeff = -1.0;
+	if(coeff > 1.0)  coeff = 1.0;
+
+	// The gait is computed with the quantized coefficient so that it matches the GaitCache key
+	gait.coeff_q 	= GaitCache::quantize(coeff);
+	coeff 			= GaitCache::dequantize(gait.coeff_q);
+	gait_cache.validate(Tripods[TRIPOD_LEFT].getParams());
+
+	gait.movement 		= movement;
+	gait.velocity_mode 	= false;
+
+	switch(movement){
+		case wkq::RM_HEXAPOD_GAIT:
+			gait.move_body 		= &Tripod::bodyForward;
+			gait.make_step 		= &Tripod::stepForward;
+			gait.finish_step 	= &Tripod::finishStep;
+			gait.move_arg  		= coeff*max_step_size;
+			break;
+		case wkq::RM_HEXAPOD_GAIT_VELOCITY:
+			gait.velocity_mode 	= true;
+			gait.move_body 		= &Tripod::bodyForward;
+			gait.make_step 		= &Tripod::stepForward;
+			gait.finish_step 	= &Tripod::finishStep;
+			gait.move_arg  		= coeff*max_step_size;
+			break;
+		case wkq::RM_RECTANGULAR_GAIT:
+			gait.move_body 		= &Tripod::bodyForwardRectangularGait;
+			gait.make_step 		= &Tripod::stepForwardRectangularGait;
+			gait.finish_step 	= &Tripod::finishStepRectangularGait;
+			gait.move_arg 		= coeff*max_step_size;
+			break;
+		case wkq::RM_ROTATION_HEXAPOD:
+			gait.move_body	 	= &Tripod::bodyRotate;
+			gait.make_step 		= &Tripod::stepRotate;
+			gait.finish_step 	= &Tripod::finishStep;
+			gait.move_arg 		= coeff*max_rotation_angle;
+			break;
+		default:
+			printf("ERROR - Robot::makeMovement - movement not implemented\n\r");
+			gait.state = GS_IDLE;
+			return false;
+	}
+
+	//gait.tripod_up 		= TRIPOD_RIGHT;
+	//gait.tripod_down 		= TRIPOD_LEFT;
+	gait.tripod_up 			= TRIPOD_LEFT;
+	gait.tripod_down 		= TRIPOD_RIGHT;
+	gait.first 				= true;
+	gait.follow_master 		= follow_master;
+	gait.stop_requested 	= false;
+	gait.retarget 			= false;
+	gait.wait 				= 0;
+	gait.state 				= GS_LIFT;
+
+	if(streaming && !SetpointStream::active()) SetpointStream::begin(ControlLoop::getRate());
+	return true;
+}
+
+void Robot::endGait(){
+	PhaseTimer::end();
+	WKQ_MATH_PHASE(wkq::math::PHASE_OTHER);
+	Airtime::setPhase(wkq::math::PHASE_OTHER);
+	if(SetpointStream::active()) SetpointStream::end();
+	// No speed of a velocity gait may outlive it - the next gait or setState() writes positions
+	DnxBus::beginSync();
+	for(int i=0; i<TRIPOD_COUNT; i++){
+		Tripods[i].restoreVelocities();
+	}
+	DnxBus::endSync();
+	WKQ_MATH_REPORT("Robot::makeMovement");
+	if(debug_) printf("Robot: gait cache hits %u, misses %u\n\r", gait_cache.hits(), gait_cache.misses());
+
+	gait.state = GS_IDLE;
+	if(gait.retarget) startGait(gait.next_movement, gait.next_coeff, gait.follow_master);
+}
+
+void Robot::pause(double time){
+	if(SetpointStream::active()) SetpointStream::plan(time);
+	gait.wait = ControlLoop::periods(time);
+	PhaseTimer::expect((double)gait.wait / ControlLoop::getRate());
+}
+
+
+/*  @ Notes:
+	Half cycles in the middle of a position gait are periodic: the recorded one is replayed or this one is recorded
+*/
+void Robot::gaitLift(){
+	// Read input and find out whether movement should go on
+	if(!gait.first && gait.follow_master && pixhawk != NULL && !pixhawk->inputWalkForward()) gait.stop_requested = true;
+	gait.continuing = !gait.stop_requested && !gait.retarget;
+
+	gait.replay 	= NULL;
+	gait.recording 	= NULL;
+	if(!gait.first && gait.continuing && !gait.velocity_mode){
+		TripodSnapshot entry_up, entry_down;
+		Tripods[gait.tripod_up].saveState(entry_up);
+		Tripods[gait.tripod_down].saveState(entry_down);
+
+		gait.replay = gait_cache.find(gait.movement, gait.coeff_q, gait.tripod_up, entry_up, entry_down);
+		if(gait.replay != NULL){
+			Airtime::setPhase(wkq::math::PHASE_LIFT_UP);
+			Tripods[gait.tripod_up].replay(gait.replay->phases[GP_LIFT_UP]);
+			pause(wait_time_);
+			gait.state = GS_BODY;
+			return;
+		}
+		gait.recording = gait_cache.record(gait.movement, gait.coeff_q, gait.tripod_up, entry_up, entry_down);
+	}
+
+	WKQ_MATH_PHASE(wkq::math::PHASE_LIFT_UP);
+	Airtime::setPhase(wkq::math::PHASE_LIFT_UP);
+	Tripods[gait.tripod_up].liftUp(ef_raise_);
+	if(gait.recording != NULL) Tripods[gait.tripod_up].saveState(gait.recording->phases[GP_LIFT_UP]);
+	pause(wait_time_);
+	gait.state = GS_BODY;
+}
+
+/*  @ Notes:
+	The body movement and the step share one State_t batch of six legs and are sent together: one SYNC_WRITE per bus
+	for the whole robot. With LEG_BATCH the six legs are solved in one LegBatch kernel call. A stop or a new target
+	that came after the lift ends the walk with this half cycle
+*/
+void Robot::gaitBody(){
+	if(gait.stop_requested || gait.retarget) gait.continuing = false;
+
+	if(gait.replay != NULL && gait.continuing){
+		DnxBus::beginSync();
+		Airtime::setPhase(wkq::math::PHASE_BODY_MOVE);
+		Tripods[gait.tripod_down].replay(gait.replay->phases[GP_BODY_MOVE]);
+		Airtime::setPhase(wkq::math::PHASE_STEP);
+		Tripods[gait.tripod_up].replay(gait.replay->phases[GP_STEP]);
+		DnxBus::endSync();
+		pause(wait_time_);
+		std::swap(gait.tripod_up, gait.tripod_down);
+		gait.state = GS_LIFT;
+		return;
+	}
+
+	gait.body_arg = (gait.first || !gait.continuing) ? gait.move_arg : 2*gait.move_arg;
+	gait.first = false;
+
+	// One State_t batch for the six legs: the Tripods do not write and the angles are written once the batch ends
+	DnxBus::beginSync();
+	State_t::beginBatch();
+	WKQ_MATH_PHASE(wkq::math::PHASE_BODY_MOVE);
+	Airtime::setPhase(wkq::math::PHASE_BODY_MOVE);
+	// In velocity mode only the first segment is written here so that the step below starts at the same time
+	if(gait.velocity_mode) 	Tripods[gait.tripod_down].bodyVelocity(gait.body_arg/wait_time_, wait_time_/velocity_segments_);
+	else 					(Tripods[gait.tripod_down].*gait.move_body)(gait.body_arg);
+
+	if(gait.continuing){
+		WKQ_MATH_PHASE(wkq::math::PHASE_STEP);
+		Airtime::setPhase(wkq::math::PHASE_STEP); 		// owns the SYNC_WRITE and the wait below
+		(Tripods[gait.tripod_up].*gait.make_step)(2*gait.move_arg);
+	}
+	State_t::endBatch();
+
+	if(gait.velocity_mode) Tripods[gait.tripod_down].writeVelocities();
+	Tripods[gait.tripod_down].writeAngles();
+	if(gait.continuing) Tripods[gait.tripod_up].writeAngles();
+	DnxBus::endSync();
+
+	// The recordings hold the solved angles
+	if(gait.recording != NULL){
+		Tripods[gait.tripod_down].saveState(gait.recording->phases[GP_BODY_MOVE]);
+		if(gait.continuing){
+			Tripods[gait.tripod_up].saveState(gait.recording->phases[GP_STEP]);
+			gait_cache.commit(gait.recording);
+		}
+	}
+
+	if(gait.velocity_mode){
+		gait.segment = 1;
+		pause(wait_time_/velocity_segments_);
+		gait.state = GS_BODY_VELOCITY;
+	}
+	else if(gait.continuing){
+		pause(wait_time_);
+		std::swap(gait.tripod_up, gait.tripod_down); 		// swap the roles of the Tripods
+		gait.state = GS_LIFT;
+	}
+	else gait.state = GS_FINISH_UP;
+}
+
+/*  @ Notes:
+	The body movement of RM_HEXAPOD_GAIT_VELOCITY is split in velocity_segments_ commands of wait_time_/velocity_segments_.
+	The first one is written by gaitBody(); every next command is written before the servos reach the previous 
+	target, so they keep moving instead of stopping after each position jump. Takes wait_time_ in total and paces
+	the step as well
+*/
+void Robot::gaitBodyVelocity(){
+	double dt = wait_time_/velocity_segments_;
+
+	if(gait.segment < velocity_segments_){
+		Tripods[gait.tripod_down].bodyVelocity(gait.body_arg/wait_time_, dt);
+		gait.segment++;
+		pause(dt);
+		return;
+	}
+
+	// The last segment is over: the Tripod moves at the default speed again before its next position goal
+	Tripods[gait.tripod_down].restoreVelocities();
+	if(gait.continuing){
+		std::swap(gait.tripod_up, gait.tripod_down);
+		gait.state = GS_LIFT;
+	}
+	else gait.state = GS_FINISH_UP;
+}
+
+void Robot::gaitFinishUp(){
+	WKQ_MATH_PHASE(wkq::math::PHASE_FINISH_STEP);
+	Airtime::setPhase(wkq::math::PHASE_FINISH_STEP);
+	(Tripods[gait.tripod_up].*gait.finish_step)();
+	pause(wait_time_);
+	gait.state = GS_LIFT_DOWN;
+}
+
+void Robot::gaitLiftDown(){
+	WKQ_MATH_PHASE(wkq::math::PHASE_LIFT_UP);
+	Airtime::setPhase(wkq::math::PHASE_LIFT_UP);
+	Tripods[gait.tripod_down].liftUp(ef_raise_);
+	pause(wait_time_);
+	gait.state = GS_FINISH_DOWN;
+}
+
+void Robot::gaitFinishDown(){
+	WKQ_MATH_PHASE(wkq::math::PHASE_FINISH_STEP);
+	Airtime::setPhase(wkq::math::PHASE_FINISH_STEP);
+	(Tripods[gait.tripod_down].*gait.finish_step)();
+	endGait();
+}
+
+
+/*  @ Notes:
+	Commands of the Master received since the last cycle. State and height changes write the servos at once, so
+	they are refused during a walk. RS_STANDING_QUAD waits between the legs (Leg::setPosition()), which inside a task
+	would be a blocking wait() for every leg, so it is refused as well - set it from outside the ControlLoop
+*/
+void Robot::masterTask(void* robot){
+	Robot* self = static_cast<Robot*>(robot);
+	MasterCommand command;
+	while(self->pixhawk->nextCommand(command)){
+		switch(command.type){
+			case MC_STOP: 		self->stopWalk(); 								break;
+			case MC_MOVE: 		self->walk(command.movement, command.coeff); 	break;
+			case MC_TELEMETRY: 	self->pixhawk->sendTelemetry(); 				break;
+			case MC_TIMING: 	self->pixhawk->sendTiming(command.phase); 		break;
+			case MC_STATE:
+			case MC_HEIGHT:
+				if(self->walking()){
+					printf("ERROR: Robot::masterTask - command %d during a walk\n\r", command.type);
+					break;
+				}
+				if(command.type == MC_STATE && command.state == wkq::RS_STANDING_QUAD){
+					printf("ERROR: Robot::masterTask - state %d waits and cannot be set from a task\n\r", command.state);
+					break;
+				}
+				if(command.type == MC_STATE) 	self->setState(command.state);
+				else 							self->raiseBody(command.coeff);
+				break;
+			default: break;
+		}
+	}
+}
+
+void Robot::telemetryTask(void* robot){
+	static_cast<Robot*>(robot)->updateTelemetry();
+}
+
+void Robot::gaitTask(void* robot){
+	static_cast<Robot*>(robot)->tick();
+}
+
+void Robot::setpointTask(void*){
+	SetpointStream::step();
+}
+
+bool Robot::walkingCondition(void* robot){
+	return static_cast<Robot*>(robot)->walking();
+}
+
 bool Robot::noState(){
 	if(state==wkq::RS_FLAT_QUAD) return true;
 	if(state==wkq::RS_QUAD_SETUP) return true;
@@ -19,6 +19,33 @@ FRAMEWORK:
 	2. Reset() 		- 	NOTE: function does not care about current state and just writes defaultPos values to all servos
 						without accounting for stability - i.e. the robot will most probably fall down !!!
 						Supposed to be used in extreme cases only
+	3. makeMovement() 	- 	the middle half cycles of a position gait are replayed from the GaitCache once computed. The
+						coefficient is quantized to 1/GAIT_CACHE_COEFF_STEPS. Velocity mode is always computed. Its
+						moving speeds last until the velocity segments of the body movement are over: then, and at
+						the end of every walk, the servos are set back to SERVO_DEFAULT_SPEED
+	4. setCoordinated() 	- 	every batched write of the Robot is staged with REG_WRITE and started with one broadcast
+						ACTION per bus, so all joints of both Tripods start moving at the same instant. Call it
+						outside of any movement
+	5. updateTelemetry() 	- 	reads position, load, voltage and temperature of all servos in one transaction per bus.
+						getTelemetry() and the Master only return the last snapshot and cause no bus traffic
+	6. setStreaming() 	- 	makeMovement() sends every waypoint as interpolated setpoints at the given rate over the wait
+						that follows it instead of one jump to the target. The last goals of a movement are sent at
+						once. setState() and the other movements are not streamed
+	7. Waits are ControlLoop::run() - the periodic tasks of the Robot (setpoints, telemetry at setTelemetryRate())
+						and any task the main adds keep running while the servos move. The rate set by
+						setStreaming() is the rate of the whole ControlLoop
+	8. walk() 		- 	the walk is a state machine advanced by tick(), which the ControlLoop calls in the plan stage
+						of every cycle. A tick writes one phase - lift, body movement with step, a velocity segment
+						or a finish - and returns; the next phase is due once the wait of the phase has passed.
+						stopWalk() acts at the next phase boundary, a new movement or coefficient at the next half
+						cycle: the walk in progress is finished and the new one started. makeMovement() is a walk
+						that follows the Master, run until it ends. Do not call setState() during a walk
+	9. Commands of the Master are applied in the sense stage of every ControlLoop cycle: MC_MOVE is walk(),
+						MC_STOP stopWalk(), MC_TELEMETRY and MC_TIMING are answered at once. MC_STATE and
+						MC_HEIGHT - setState() and raiseBody() - are refused during a walk. RS_STANDING_QUAD waits
+						between its legs and is always refused, since a wait inside a task blocks the loop
+	10. PhaseTimer 		- 	every gait state run by tick() is a phase of the PhaseTimer, numbered by its GaitState_t;
+						the nominal wait after it is the wait of pause() rounded to ControlLoop periods
 
 -------------------------------------------------------------------------------------------
 
@@ -30,6 +57,12 @@ FRAMEWORK:
 
 #include "wkq.h"
 #include "Tripod.h"
+#include "GaitCache.h"
+#include "Telemetry.h"
+#include "Airtime.h"
+#include "SetpointStream.h"
+#include "ControlLoop.h"
+#include "PhaseTimer.h"
 #include "Master.h"
 
 using wkq::RobotState_t;
@@ -44,12 +77,23 @@ using wkq::RobotMovement_t;
 #define TRIPOD_LEFT 	0	
 #define TRIPOD_RIGHT 	1
 
+// What the gait does on its next tick
+enum GaitState_t{
+	GS_IDLE 			= 0, 		// no walk
+	GS_LIFT 			= 1, 		// start a half cycle: lift the up Tripod
+	GS_BODY 			= 2, 		// body movement with the down Tripod and step of the up Tripod
+	GS_BODY_VELOCITY 	= 3, 		// next velocity segment of the body movement
+	GS_FINISH_UP 		= 4, 		// put the up Tripod down
+	GS_LIFT_DOWN 		= 5, 		// lift the Tripod that carried the body
+	GS_FINISH_DOWN 		= 6 		// put it down; the walk ends
+};
+
 
 class Robot{
 
 public:
 
-	Robot(Master* pixhawk_in, unordered_map<int, DnxHAL*>& servo_map, double height_in, const BodyParams& robot_params, wkq::RobotState_t state_in = wkq::RS_DEFAULT); 
+	Robot(Master* pixhawk_in, ServoMap& servo_map, double height_in, const BodyParams& robot_params, wkq::RobotState_t state_in = wkq::RS_DEFAULT); 
 	~Robot();
 
 	/* ------------------------------------ SET STATIC POSITIONS ----------------------------------- */
@@ -59,10 +103,25 @@ public:
 
 	/* ------------------------------------ WALK RELATED FUNCTIONALITY ----------------------------------- */
 
-	void makeMovement(RobotMovement_t movement, double coeff);
+	void makeMovement(RobotMovement_t movement, double coeff); 	// Walk until the Master stops it; blocks
+
+	void walk(RobotMovement_t movement, double coeff); 			// Start a walk or retarget the one in progress
+	void stopWalk(); 											// Finish the walk at the next phase boundary
+	void tick(); 												// Advance the gait; never blocks
+	bool walking() const;
+	GaitState_t getGaitState() const;
 
 	void raiseBody(double hraise);
 
+	void setCoordinated(bool coordinated); 		// REG_WRITE + ACTION instead of SYNC_WRITE
+	void setStreaming(int rate_hz); 			// Interpolated setpoints during makeMovement(), ControlLoop at rate_hz; 0 - off
+
+	/* ------------------------------------ TELEMETRY ----------------------------------- */
+
+	void updateTelemetry();
+	const Telemetry& getTelemetry() const;
+	void setTelemetryRate(int rate_hz); 		// updateTelemetry() as a ControlLoop task; 0 - off
+
 	/* ------------------------------------ TESTING FUNCTIONS ----------------------------------- */
 
 	void test();
@@ -78,6 +137,23 @@ private:
 
 	bool noState();				// check if the current state is meaningless for the walking configuration
 
+	bool startGait(RobotMovement_t movement, double coeff, bool follow_master);
+	void endGait();
+	void pause(double time); 					// Next tick of the gait after time; the goals are streamed over it
+
+	void gaitLift();
+	void gaitBody();
+	void gaitBodyVelocity();
+	void gaitFinishUp();
+	void gaitLiftDown();
+	void gaitFinishDown();
+
+	static void masterTask(void* robot);
+	static void telemetryTask(void* robot);
+	static void gaitTask(void* robot);
+	static void setpointTask(void*);
+	static bool walkingCondition(void* robot);
+
 
 	/* ------------------------------------ MEMBER DATA ----------------------------------- */
 
@@ -88,12 +164,45 @@ private:
 
 	Master* pixhawk;
 
+	GaitCache gait_cache;						// steady-state gait cycles of makeMovement()
+	Telemetry telemetry;						// last state read back from the servos
+
 	double max_rotation_angle;
 	double max_step_size;
 
 	static const double wait_time_; 	// wait time between writing angles for the two tripods
+	static const int velocity_segments_; 	// velocity commands per body movement in RM_HEXAPOD_GAIT_VELOCITY
 	static const double ef_raise_;
 
+	bool streaming; 					// makeMovement() opens a SetpointStream
+	int telemetry_task; 				// ControlLoop handle of updateTelemetry()
+
+	struct Gait{
+		GaitState_t state;
+		RobotMovement_t movement;
+		int coeff_q; 									// quantized coefficient of the walk
+		double move_arg;
+		double body_arg;
+		bool velocity_mode;
+		bool first; 									// no half cycle done yet
+		bool continuing; 								// the half cycle in progress ends with a step
+		bool follow_master; 							// ask the Master at every half cycle whether to go on
+		bool stop_requested;
+		bool retarget; 									// next_movement/next_coeff start when this walk ends
+		RobotMovement_t next_movement;
+		double next_coeff;
+		int tripod_up;
+		int tripod_down;
+		int segment; 									// velocity segments of the body movement written
+		int wait; 										// ControlLoop cycles until the next state
+		const GaitHalfCycle* replay; 					// half cycle replayed from the GaitCache
+		GaitHalfCycle* recording; 						// half cycle recorded in the GaitCache
+		void (Tripod::*move_body)(double);
+		void (Tripod::*make_step)(double);
+		void (Tripod::*finish_step)();
+	};
+	Gait gait;
+
 	wkq::RobotState_t state;
 
 	enum RPC_Fn_t{
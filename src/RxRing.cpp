@@ -0,0 +1,41 @@
+#include "RxRing.h"
+
+RxRing::RxRing() :
+	head(0), tail(0), dropped_count(0){}
+
+
+bool RxRing::push(uint8_t byte){
+	uint32_t h = head;
+	if(h - tail == RX_RING_SIZE){
+		dropped_count++;
+		return false;
+	}
+	buffer[h & (RX_RING_SIZE-1)] = byte;
+	head = h + 1; 						// publish the byte
+	return true;
+}
+
+bool RxRing::pop(uint8_t& byte){
+	uint32_t t = tail;
+	if(t == head) return false;
+	byte = buffer[t & (RX_RING_SIZE-1)];
+	tail = t + 1; 						// release the slot
+	return true;
+}
+
+uint8_t RxRing::peek(int offset) const{
+	return buffer[(tail + offset) & (RX_RING_SIZE-1)];
+}
+
+void RxRing::consume(int count){
+	tail = tail + count;
+}
+
+
+int RxRing::available() const{
+	return (int)(head - tail);
+}
+
+unsigned long RxRing::dropped() const{
+	return dropped_count;
+}
@@ -0,0 +1,58 @@
+/*
+
+RxRing Class: Lock-free single-producer/single-consumer byte ring between an ISR and the main context
+===========================================================================================
+
+FUNCTIONALITY:
+	1. push() is called by the producer only - the serial RX interrupt - and pop() by the consumer only - the
+		ControlLoop. Neither disables the interrupts
+	2. The consumer can also read the waiting bytes in place with peek() and release them with consume(), so a
+		parser never copies them out of the ring
+	3. Counts the bytes lost because the ring was full
+
+-------------------------------------------------------------------------------------------
+
+FRAMEWORK:
+	1. head is written by the producer only and tail by the consumer only. The byte is stored before head is
+		moved past it and read before tail is moved past it, so each side only ever sees slots the other has
+		finished with. Both indices are volatile 32 bit words, which the Cortex-M3 loads and stores atomically
+	2. The indices run freely and are masked on access: the size must be a power of two. The ring holds
+		RX_RING_SIZE bytes; head - tail is the number of bytes waiting
+	3. RX_RING_SIZE 256 covers more than two ControlLoop periods at 100 Hz of a 115200 baud link (115 bytes per
+		period), so no byte is lost as long as the ring is drained every cycle
+
+-------------------------------------------------------------------------------------------
+
+*/
+
+#ifndef RXRING_H
+#define RXRING_H
+
+#include <stdint.h>
+
+#define RX_RING_SIZE 	256 		// bytes, power of two
+
+
+class RxRing{
+
+public:
+
+	RxRing();
+
+	bool push(uint8_t byte); 			// Producer; false if the ring is full and the byte was dropped
+	bool pop(uint8_t& byte); 			// Consumer; false if the ring is empty
+	uint8_t peek(int offset) const; 	// Consumer; byte offset from the oldest, offset < available()
+	void consume(int count); 			// Consumer; release the count oldest bytes
+
+	int available() const;
+	unsigned long dropped() const;
+
+private:
+
+	volatile uint8_t buffer[RX_RING_SIZE];
+	volatile uint32_t head; 			// next slot to write
+	volatile uint32_t tail; 			// next slot to read
+	volatile unsigned long dropped_count; 	// written by the producer only
+};
+
+#endif
@@ -1,91 +1,26 @@
 #include "ServoJoint.h"
+#include "SetpointStream.h"
 
-#ifndef SIMULATION
-ServoJoint::ServoJoint(int ID_in, unordered_map<int, DnxHAL*>& servo_map) : ID(ID_in), dnx_ptr(servo_map[ID_in]){
-#else
-ServoJoint::ServoJoint(int ID_in, unordered_map<int, DnxHAL*>& servo_map) : ID(ID_in){
-#endif
-
-	switch(ID){
-		case wkq::KNEE_LEFT_FRONT	:
-			servo_name = "knee_left_front";
-			break;
-		case wkq::KNEE_LEFT_MIDDLE	:
-			servo_name = "knee_left_middle";
-			break;
-		case wkq::KNEE_LEFT_BACK	:
-			servo_name = "knee_left_back";
-			break;
-		case wkq::KNEE_RIGHT_FRONT	:
-			servo_name = "knee_right_front";
-			break;
-		case wkq::KNEE_RIGHT_MIDDLE	:
-			servo_name = "knee_right_middle";
-			break;
-		case wkq::KNEE_RIGHT_BACK	:
-			servo_name = "knee_right_back";
-			break;
-		case wkq::HIP_LEFT_FRONT	:
-			servo_name = "hip_left_front";
-			break;
-		case wkq::HIP_LEFT_MIDDLE	:
-			servo_name = "hip_left_middle";
-			break;
-		case wkq::HIP_LEFT_BACK	:
-			servo_name = "hip_left_back";
-			break;
-		case wkq::HIP_RIGHT_FRONT	:
-			servo_name = "hip_right_front";
-			break;
-		case wkq::HIP_RIGHT_MIDDLE	:
-			servo_name = "hip_right_middle";
-			break;
-		case wkq::HIP_RIGHT_BACK	:
-			servo_name = "hip_right_back";
-			break;
-		case wkq::WING_LEFT_FRONT	:
-			servo_name = "wing_left_front";
-			break;
-		case wkq::WING_LEFT_MIDDLE	:
-			servo_name = "wing_left_middle";
-			break;
-		case wkq::WING_LEFT_BACK	:
-			servo_name = "wing_left_back";
-			break;
-		case wkq::WING_RIGHT_FRONT	:
-			servo_name = "wing_right_front";
-			break;
-		case wkq::WING_RIGHT_MIDDLE	:
-			servo_name = "wing_right_middle";
-			break;
-		case wkq::WING_RIGHT_BACK	:
-			servo_name = "wing_right_back";
-			break;
-		case wkq::ARM_LEFT_FRONT	:
-			servo_name = "arm_left_front";
-			break;
-		case wkq::ARM_LEFT_MIDDLE	:
-			servo_name = "arm_left_middle";
-			break;
-		case wkq::ARM_LEFT_BACK	:
-			servo_name = "arm_left_back";
-			break;
-		case wkq::ARM_RIGHT_FRONT	:
-			servo_name = "arm_right_front";
-			break;
-		case wkq::ARM_RIGHT_MIDDLE	:
-			servo_name = "arm_right_middle";
-			break;
-		case wkq::ARM_RIGHT_BACK	:
-			servo_name = "arm_right_back";
-			break;
-		default:
-			servo_name = "error in servo ID";
-	}		
-	
+#include <cstdlib>
+
+// Initialize static variables
+int ServoJoint::deadband = 0;
+unsigned long ServoJoint::total_suppressed_writes = 0;
+
+ServoJoint::ServoJoint(int ID_in, ServoMap& servo_map) : 
+	ID(ID_in), bus(NULL), entry(&servo_map.entry(ID_in)), suppressed_writes(0), dnx_ptr(entry->hal){
+
+	if(!servo_map.contains(ID)){
+		printf("ERROR: ServoJoint - servo %d is not in the ServoMap\n\r", ID);
+		return;
+	}
+	bus = entry->bus = DnxBus::find(dnx_ptr);
+	entry->last_raw = -1;
+
+	if(bus != NULL) bus->attachServo(ID);
 	setReturnLevel(1);	
 	wait_ms(0.1);
-	setGoalVelocity(250);	
+	setGoalVelocity(SERVO_DEFAULT_SPEED);	
 	wait_ms(0.1);
 }
 
@@ -94,110 +29,161 @@ int ServoJoint::getID() const {
 	return ID;
 }
 
+const char* ServoJoint::getName() const {
+	return entry->name;
+}
+
 int ServoJoint::setID(int newID){
-#ifndef SIMULATION
+	waitBus();
+	if(bus != NULL) bus->countDirect(1);
 	return dnx_ptr->setID(ID, newID);
-#else
-	ID = newID;
-	return 0;
-#endif
 }
 	
 int ServoJoint::getValue(int address){
-#ifndef SIMULATION
+	waitBus();
+	if(bus != NULL) bus->countDirect(0, 2);
 	return dnx_ptr->getValue(ID, address);
-#else
-	return 0;
-#endif
 }
     
 int ServoJoint::setBaud(int rate){
-#ifndef SIMULATION
+	waitBus();
+	if(bus != NULL) bus->countDirect(1);
 	return dnx_ptr->setBaud(ID, rate);
-#else
-	return 0;
-#endif
 }
     
 int ServoJoint::setReturnLevel(int lvl){
-#ifndef SIMULATION
+	waitBus();
+	if(bus != NULL) bus->countDirect(1);
 	return dnx_ptr->setReturnLevel(ID, lvl);
-#else
-	return 0;
-#endif
 }
 
 int ServoJoint::setLED(int colour){
-#ifndef SIMULATION
+	waitBus();
+	if(bus != NULL) bus->countDirect(1);
 	return dnx_ptr->setLED(ID, colour);
-#else
-	return 0;
-#endif
 }
 
+// The units of angle are up to DnxHAL, so the next goal in radians is always written
 int ServoJoint::setGoalPosition(int angle, bool cash/*=false*/){
-#ifndef SIMULATION
+	entry->last_raw = -1;
+	waitBus();
+	if(bus != NULL) bus->countDirect(2);
 	return dnx_ptr->setGoalPosition(ID, angle, cash);
-#else
-	return 0;
-#endif
 }
 
-// angle is in radians
+/*  @ Notes:
+	angle is in radians. Not sent if within deadband of the last written goal, captured by an open SetpointStream,
+	queued in the bus during DnxBus::beginSync()/endSync()
+*/
 int ServoJoint::setGoalPosition(double angle, bool cash/*=false*/){
-	if(debug_) printf("%s set to %f\n\r", servo_name.c_str(), wkq::degrees(angle));
-#ifndef SIMULATION
+	int raw = DnxBus::positionToRaw(angle);
+	if(entry->last_raw >= 0 && abs(raw - entry->last_raw) <= deadband){
+		suppressed_writes++;
+		total_suppressed_writes++;
+		Trace::log(TR_GOAL_SUPPRESSED, ID, raw);
+		return 0;
+	}
+	int from_raw = entry->last_raw;
+	entry->last_raw = raw;
+
+	Trace::log(TR_GOAL_POSITION, ID, raw);
+	if(!cash && bus != NULL && SetpointStream::capture(this, from_raw, raw)) return 0;
+	if(!cash && bus != NULL && DnxBus::syncActive()){
+		bus->queueGoalPosition(ID, angle);
+		return 0;
+	}
+	waitBus();
+	if(bus != NULL) bus->countDirect(2);
 	return dnx_ptr->setGoalPosition(ID, angle, cash);
-#else
-	return 0;
-#endif
 }
 
+// Queued during DnxBus::beginSync()/endSync() like the goal positions
 int ServoJoint::setGoalVelocity(int velocity){
-#ifndef SIMULATION
+	Trace::log(TR_GOAL_VELOCITY, ID, velocity);
+	entry->speed = velocity;
+	if(bus != NULL && DnxBus::syncActive()){
+		bus->queueMovingSpeed(ID, velocity);
+		return 0;
+	}
+	waitBus();
+	if(bus != NULL) bus->countDirect(2);
 	return dnx_ptr->setGoalVelocity(ID, velocity);
-#else
-	return 0;
-#endif
+}
+
+/*  @ Notes:
+	velocity is in rad/s; only the magnitude is used since in joint mode the servo always moves towards the goal position
+	1 unit of MOVING_SPEED is 0.111 rpm on both AX-12 and XL-320. 0 means maximum speed. A velocity below half a unit
+	writes SERVO_DEFAULT_SPEED: the joint has (almost) nothing to do, and at 1 unit it would stall on the next goal
+	that rounds to another raw position
+*/
+int ServoJoint::setGoalVelocity(double velocity){
+	const double RAD_S_PER_UNIT = 0.111 * 2*wkq::PI / 60.0;
+	
+	int raw = (int)(fabs(velocity) / RAD_S_PER_UNIT + 0.5);
+	if(raw < 1) 			raw = SERVO_DEFAULT_SPEED;
+	else if(raw > 1023) 	raw = 1023;
+
+	return setGoalVelocity(raw);
+}
+
+int ServoJoint::restoreVelocity(){
+	if(entry->speed == SERVO_DEFAULT_SPEED) return 0;
+	return setGoalVelocity(SERVO_DEFAULT_SPEED);
 }
 
 int ServoJoint::setGoalTorque(int torque){
-#ifndef SIMULATION
+	waitBus();
+	if(bus != NULL) bus->countDirect(2);
 	return dnx_ptr->setGoalTorque(ID, torque);
-#else
-	return 0;
-#endif
 }
 
 int ServoJoint::setPunch(int punch){
-#ifndef SIMULATION
+	waitBus();
+	if(bus != NULL) bus->countDirect(2);
 	return dnx_ptr->setPunch(ID, punch);
-#else
-	return 0;
-#endif
 }
 
 int ServoJoint::action(int arg){
-#ifndef SIMULATION
+	waitBus();
+	if(bus != NULL) bus->countDirect(0);
 	return dnx_ptr->action(ID);
-#else
-	return 0;
-#endif
+}
+
+/*  @ Notes:
+	Called by SetpointStream inside DnxBus::beginSync()/endSync(). Bypasses the deadband and does not change the last
+	written goal - that is already the end of the track
+*/
+void ServoJoint::writeSetpoint(int raw){
+	Trace::log(TR_SETPOINT, ID, raw);
+	bus->queueGoalRaw(ID, raw);
+}
+
+void ServoJoint::invalidatePosition(){
+	entry->last_raw = -1;
+}
+
+unsigned long ServoJoint::getSuppressedWrites() const{
+	return suppressed_writes;
+}
+
+void ServoJoint::setDeadband(int raw_units){
+	deadband = (raw_units > 0) ? raw_units : 0;
+}
+
+unsigned long ServoJoint::getTotalSuppressedWrites(){
+	return total_suppressed_writes;
+}
+
+
+void ServoJoint::waitBus() const{
+	if(bus != NULL) bus->waitIdle();
 }
 
 void ServoJoint::operator=(const ServoJoint& obj_in){
 	if(this != &obj_in){
 		this->ID 			= obj_in.ID;
-		this->servo_name 	= obj_in.servo_name;
-#ifndef SIMULATION
+		this->bus 			= obj_in.bus;
+		this->entry 		= obj_in.entry;
 		this->dnx_ptr 		= obj_in.dnx_ptr;
-#endif
 	}
 }
-
-
-#ifdef SIMULATION
-void wait(int time){}
-void wait_ms(int time){}
-#endif
-
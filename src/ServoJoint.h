@@ -2,27 +2,29 @@
 #define SERVOJOINT_H
 
 #include <string>
-#include <unordered_map>
 using std::string;
-using std::unordered_map;
 
 #include "wkq.h"
+#include "DnxBus.h"
+#include "ServoMap.h"
+#include "Trace.h"
 
 #ifndef SIMULATION
 #include "../libdnx/DnxHAL.h"
 #else
-typedef int DnxHAL;
-void wait(int time);
-void wait_ms(int time);
+#include "SimDnxHAL.h"
 #endif
 
+#define SERVO_DEFAULT_SPEED 	250 			// moving speed set on construction and restored after velocity control
+
 class ServoJoint{
 
 public:
 
-	ServoJoint(int ID_in, unordered_map<int, DnxHAL*>& servo_map);
+	ServoJoint(int ID_in, ServoMap& servo_map);
 
 	int getID() const;
+	const char* getName() const;
 
     int setID(int newID);
 	int getValue(int address);
@@ -32,24 +34,40 @@ public:
 	int setGoalPosition(int angle, bool cash=false);
 	int setGoalPosition(double angle, bool cash=false);
 	int setGoalVelocity(int velocity);
+	int setGoalVelocity(double velocity);
+	int restoreVelocity();							// Back to SERVO_DEFAULT_SPEED; nothing is written if already there
 	int setGoalTorque(int torque);
 	int setPunch(int punch);
     int action(int arg);
 
 	void operator=(const ServoJoint& obj_in);
 
+	/* ------------------------------------ WRITE SUPPRESSION ----------------------------------- */
+
+	void invalidatePosition();						// Next goal position is written even if unchanged
+	unsigned long getSuppressedWrites() const;
+
+	static void setDeadband(int raw_units); 		// Goals within raw_units of the last written goal are not sent
+	static unsigned long getTotalSuppressedWrites();
+
+	/* ------------------------------------ SETPOINT STREAMING ----------------------------------- */
+
+	void writeSetpoint(int raw);					// Intermediate goal of a SetpointStream; only for servos on a DnxBus
+
 private:
 
+	void waitBus() const;			// Direct DnxHAL writes must not interleave with a SYNC_WRITE in progress
+
     int ID;
-    string servo_name;
-    bool debug_ = true;
 
-#ifndef SIMULATION
+	DnxBus* bus;					// Bus that batches the goal positions of this servo; NULL if not batched
+	ServoEntry* entry; 				// Entry of the servo in the ServoMap: last goal written and name
+	unsigned long suppressed_writes;
+
+	static int deadband;
+	static unsigned long total_suppressed_writes;
+
 	DnxHAL* dnx_ptr;		     // Pointer to the object associated with the right serial port
-#else
-    //double angle = 0;
-    //GeomView* robot_view;
-#endif
 
 };
 
@@ -0,0 +1,53 @@
+#include "ServoMap.h"
+#include "wkq.h"
+
+ServoMap::ServoMap(){
+	for(int i=0; i<SERVO_MAP_SIZE; i++){
+		entries[i].hal 		= NULL;
+		entries[i].bus 		= NULL;
+		entries[i].last_raw = -1;
+		entries[i].speed 	= -1;
+		entries[i].name 	= "unknown";
+	}
+
+	entry(wkq::KNEE_LEFT_FRONT).name 	= "knee_left_front";
+	entry(wkq::KNEE_LEFT_MIDDLE).name 	= "knee_left_middle";
+	entry(wkq::KNEE_LEFT_BACK).name 	= "knee_left_back";
+	entry(wkq::KNEE_RIGHT_FRONT).name 	= "knee_right_front";
+	entry(wkq::KNEE_RIGHT_MIDDLE).name 	= "knee_right_middle";
+	entry(wkq::KNEE_RIGHT_BACK).name 	= "knee_right_back";
+
+	entry(wkq::HIP_LEFT_FRONT).name 	= "hip_left_front";
+	entry(wkq::HIP_LEFT_MIDDLE).name 	= "hip_left_middle";
+	entry(wkq::HIP_LEFT_BACK).name 		= "hip_left_back";
+	entry(wkq::HIP_RIGHT_FRONT).name 	= "hip_right_front";
+	entry(wkq::HIP_RIGHT_MIDDLE).name 	= "hip_right_middle";
+	entry(wkq::HIP_RIGHT_BACK).name 	= "hip_right_back";
+
+	entry(wkq::WING_LEFT_FRONT).name 	= "wing_left_front";
+	entry(wkq::WING_LEFT_MIDDLE).name 	= "wing_left_middle";
+	entry(wkq::WING_LEFT_BACK).name 	= "wing_left_back";
+	entry(wkq::WING_RIGHT_FRONT).name 	= "wing_right_front";
+	entry(wkq::WING_RIGHT_MIDDLE).name 	= "wing_right_middle";
+	entry(wkq::WING_RIGHT_BACK).name 	= "wing_right_back";
+
+	entry(wkq::ARM_LEFT_FRONT).name 	= "arm_left_front";
+	entry(wkq::ARM_LEFT_MIDDLE).name 	= "arm_left_middle";
+	entry(wkq::ARM_LEFT_BACK).name 		= "arm_left_back";
+	entry(wkq::ARM_RIGHT_FRONT).name 	= "arm_right_front";
+	entry(wkq::ARM_RIGHT_MIDDLE).name 	= "arm_right_middle";
+	entry(wkq::ARM_RIGHT_BACK).name 	= "arm_right_back";
+}
+
+
+bool ServoMap::contains(int ID) const{
+	return ID >= 0 && ID < SERVO_MAP_SIZE && entries[ID].hal != NULL;
+}
+
+int ServoMap::size() const{
+	int count = 0;
+	for(int i=0; i<SERVO_MAP_SIZE; i++){
+		if(entries[i].hal != NULL) count++;
+	}
+	return count;
+}
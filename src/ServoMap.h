@@ -0,0 +1,73 @@
+/*
+
+ServoMap Class: Fixed-size registry of the servos indexed by ID
+===========================================================================================
+
+FUNCTIONALITY:
+	1. Tells which DnxHAL (serial port) every servo ID is on. Filled in the main with servo_map[ID] = hal, like the
+		unordered_map it replaces, and passed to the Robot, Tripod, Leg and ServoJoint constructors
+	2. Holds per servo the DnxBus that batches its goals, the last goal position and moving speed written in raw units
+		and its name
+	3. Lookup is one masked array index - no hashing, no branches and no heap
+
+-------------------------------------------------------------------------------------------
+
+FRAMEWORK:
+	1. SERVO_MAP_SIZE is a power of 2 above the highest ID in wkq.h. IDs are masked with SERVO_MAP_SIZE-1, so an ID
+		outside the range aliases another entry - contains() checks the range where it matters
+	2. Declare it static (or global): entries are only reached through pointers kept by the ServoJoints, so the map
+		must outlive the Robot
+	3. The bus of an entry is resolved by the ServoJoint constructor, after the DnxBus objects exist
+	4. Names of the IDs of wkq.h are set by the constructor; any other ID is "unknown"
+
+-------------------------------------------------------------------------------------------
+
+*/
+
+#ifndef SERVOMAP_H
+#define SERVOMAP_H
+
+#include <cstddef>
+
+#define SERVO_MAP_SIZE 		64
+
+class DnxHAL;
+class DnxBus;
+
+
+struct ServoEntry{
+	DnxHAL* hal;							// NULL if no servo has this ID
+	DnxBus* bus;							// NULL if the goals of the servo are not batched
+	int last_raw;							// Last goal position written in raw units; -1 if unknown
+	int speed;								// Last moving speed written in raw units; -1 if unknown
+	const char* name;
+};
+
+
+class ServoMap{
+
+public:
+
+	ServoMap();
+
+	DnxHAL*& operator[](int ID){ 						// servo_map[ID] = hal
+		return entries[ID & (SERVO_MAP_SIZE-1)].hal;
+	}
+
+	ServoEntry& entry(int ID){
+		return entries[ID & (SERVO_MAP_SIZE-1)];
+	}
+
+	const ServoEntry& entry(int ID) const{
+		return entries[ID & (SERVO_MAP_SIZE-1)];
+	}
+
+	bool contains(int ID) const; 						// ID in range and on a DnxHAL
+	int size() const; 									// servos on a DnxHAL
+
+private:
+
+	ServoEntry entries[SERVO_MAP_SIZE];
+};
+
+#endif
@@ -0,0 +1,94 @@
+#include "SetpointStream.h"
+#include "ServoJoint.h"
+
+// Initialize static variables
+SetpointStream::Track SetpointStream::tracks[STREAM_MAX_JOINTS];
+int SetpointStream::track_count = 0;
+bool SetpointStream::capturing = false;
+int SetpointStream::rate = STREAM_DEFAULT_RATE;
+int SetpointStream::steps = 0;
+int SetpointStream::steps_done = 0;
+unsigned long SetpointStream::setpoints_sent = 0;
+
+
+void SetpointStream::begin(int rate_in){
+	if(rate_in <= 0){
+		printf("ERROR: SetpointStream::begin - rate must be positive\n\r");
+		return;
+	}
+	rate 		= rate_in;
+	track_count = 0;
+	steps 		= 0;
+	steps_done 	= 0;
+	capturing 	= true;
+}
+
+void SetpointStream::end(){
+	DnxBus::beginSync();
+	for(int i=0; i<track_count; i++) tracks[i].joint->writeSetpoint(tracks[i].to);
+	DnxBus::endSync();
+
+	track_count = 0;
+	steps 		= 0;
+	steps_done 	= 0;
+	capturing 	= false;
+}
+
+bool SetpointStream::active(){
+	return capturing;
+}
+
+
+bool SetpointStream::capture(ServoJoint* joint, int from_raw, int to_raw){
+	if(!capturing || from_raw < 0 || from_raw == to_raw) return false;
+
+	for(int i=0; i<track_count; i++){
+		if(tracks[i].joint == joint){
+			tracks[i].to = to_raw;
+			return true;
+		}
+	}
+	if(track_count == STREAM_MAX_JOINTS) return false;
+
+	Track& track = tracks[track_count++];
+	track.joint = joint;
+	track.from 	= from_raw;
+	track.to 	= to_raw;
+	return true;
+}
+
+
+// Called after the goals of a movement, before the ControlLoop runs the wait that follows them
+void SetpointStream::plan(double duration){
+	steps = (int)(duration * rate + 0.5);
+	if(steps < 1) steps = 1;
+	steps_done = 0;
+}
+
+/*  @ Notes:
+	Setpoint k of n is from + (to - from)*k/n. A joint whose raw value did not change since the last period is left
+	out of the SYNC_WRITE. The tracks are dropped after the last period
+*/
+void SetpointStream::step(){
+	if(steps_done == steps || track_count == 0) return;
+	int k = ++steps_done;
+
+	DnxBus::beginSync();
+	for(int i=0; i<track_count; i++){
+		const Track& track = tracks[i];
+		int raw 		= track.from + ((track.to - track.from) * k) / steps;
+		int previous 	= track.from + ((track.to - track.from) * (k-1)) / steps;
+		if(raw == previous) continue;
+
+		track.joint->writeSetpoint(raw);
+		setpoints_sent++;
+	}
+	DnxBus::endSync();
+
+	if(steps_done == steps) track_count = 0;
+}
+
+
+unsigned long SetpointStream::setpoints(){
+	return setpoints_sent;
+}
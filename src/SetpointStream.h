@@ -0,0 +1,70 @@
+/*
+
+SetpointStream Class: Interpolated goal positions streamed at a fixed rate
+===========================================================================================
+
+FUNCTIONALITY:
+	1. While a stream is open, the goal positions written through ServoJoint::setGoalPosition(double) are captured
+		instead of sent: the last goal written to the servo and the new one form the track of the joint
+	2. plan() spreads the tracks over the wait after a movement and step() sends the next setpoints, linearly
+		interpolated along every track in joint space, so the servos follow the trajectory instead of jumping to the
+		final target with their internal controller. The target is the last setpoint, one period before the wait ends
+	3. The setpoints of one period leave together - one SYNC_WRITE per bus, or REG_WRITE + ACTION in DNX_SYNC_STAGED
+	4. end() sends the targets of the tracks that were not run and closes the stream
+
+-------------------------------------------------------------------------------------------
+
+FRAMEWORK:
+	1. All methods are static - there is one stream for the whole robot. Robot::makeMovement() opens it when
+		streaming is enabled with Robot::setStreaming()
+	2. step() is the write task of the ControlLoop and runs once per cycle; the stream rate is the rate of the loop
+	3. A joint is not captured if its last goal is unknown, it is not on a DnxBus or the goal is unchanged - the goal
+		is then written as usual. A second goal for a captured joint moves the end of its track
+	4. rate is in Hz. The number of setpoints is duration*rate rounded, at least one
+
+-------------------------------------------------------------------------------------------
+
+*/
+
+#ifndef SETPOINTSTREAM_H
+#define SETPOINTSTREAM_H
+
+#define STREAM_MAX_JOINTS 		24
+#define STREAM_DEFAULT_RATE 	100 		// Hz
+
+class ServoJoint;
+
+
+class SetpointStream{
+
+public:
+
+	static void begin(int rate_in);							// Capture goal positions from now on
+	static void end(); 										// Send what was not run and stop capturing
+	static bool active();
+
+	static bool capture(ServoJoint* joint, int from_raw, int to_raw);
+	static void plan(double duration); 						// Stream the captured tracks over duration seconds
+	static void step(); 									// Send the setpoints of the next period
+
+	static unsigned long setpoints(); 						// Interpolated goals sent since the start
+
+private:
+
+	struct Track{
+		ServoJoint* joint;
+		int from;
+		int to;
+	};
+
+	static Track tracks[STREAM_MAX_JOINTS];
+	static int track_count;
+
+	static bool capturing;
+	static int rate;
+	static int steps; 										// periods of the planned tracks
+	static int steps_done;
+	static unsigned long setpoints_sent;
+};
+
+#endif
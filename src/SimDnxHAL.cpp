@@ -0,0 +1,395 @@
+#include "SimDnxHAL.h"
+
+#ifdef SIMULATION
+
+#include <cstdio>
+#include <cstring>
+
+// Initialize static variables
+double DnxHAL::clock = 0;
+
+// Control table addresses the simulated servos use
+struct SimControlTable{
+	int model;
+	int ID;
+	int baud;
+	int return_delay;
+	int return_level;
+	int led;
+	int goal_position;
+	int goal_velocity;
+	int goal_torque;
+	int present_position;
+	int present_voltage;
+	int present_temperature;
+	int registered;
+	int punch;
+	int model_number;
+	int voltage;
+	const int* wide; 						// 2 byte registers
+	int wide_count;
+};
+
+static const int ax12_wide[] 	= { 0, 6, 8, 14, 30, 32, 34, 36, 38, 40, 48 };
+static const int xl320_wide[] 	= { 0, 6, 8, 15, 30, 32, 35, 37, 39, 41, 51 };
+
+static const SimControlTable ax12_table 	= { 0, 3, 4, 5, 16, 25, 30, 32, 34, 36, 42, 43, 44, 48, 12, 120, ax12_wide, 11 };
+static const SimControlTable xl320_table 	= { 0, 3, 4, 5, 17, 25, 30, 32, 35, 37, 45, 46, 47, 51, 350, 74, xl320_wide, 11 };
+
+static const SimControlTable& controlTable(DnxProtocol_t protocol){
+	return (protocol == DNX_PROTOCOL_1) ? ax12_table : xl320_table;
+}
+
+
+DnxHAL::DnxHAL(DnxProtocol_t protocol_in, int baud_in) :
+	protocol(protocol_in), baud(baud_in), servo_count(0), status_count(0), status_next(0), line_free(0), tx_end(0),
+	packets(0), status_packets(0), bytes(0), busy_time(0){}
+
+DnxHAL::~DnxHAL(){}
+
+
+/* ================================================= SERVO METHODS ================================================= */
+
+int DnxHAL::setID(int ID, int newID){
+	return writeRegister(ID, controlTable(protocol).ID, newID);
+}
+
+int DnxHAL::getValue(int ID, int address){
+	return readRegister(ID, address);
+}
+
+int DnxHAL::setBaud(int ID, int rate){
+	return writeRegister(ID, controlTable(protocol).baud, rate);
+}
+
+int DnxHAL::setReturnLevel(int ID, int lvl){
+	return writeRegister(ID, controlTable(protocol).return_level, lvl);
+}
+
+int DnxHAL::setLED(int ID, int colour){
+	return writeRegister(ID, controlTable(protocol).led, colour);
+}
+
+// angle is already in raw units
+int DnxHAL::setGoalPosition(int ID, int angle, bool cash/*=false*/){
+	return writeRegister(ID, controlTable(protocol).goal_position, angle, cash);
+}
+
+int DnxHAL::setGoalPosition(int ID, double angle, bool cash/*=false*/){
+	return writeRegister(ID, controlTable(protocol).goal_position, DnxBus::positionToRaw(angle), cash);
+}
+
+int DnxHAL::setGoalVelocity(int ID, int velocity){
+	return writeRegister(ID, controlTable(protocol).goal_velocity, velocity);
+}
+
+int DnxHAL::setGoalTorque(int ID, int torque){
+	return writeRegister(ID, controlTable(protocol).goal_torque, torque);
+}
+
+int DnxHAL::setPunch(int ID, int punch){
+	return writeRegister(ID, controlTable(protocol).punch, punch);
+}
+
+int DnxHAL::action(int ID){
+	uint8_t buf[DNX_BUS_MAX_PACKET];
+	write(buf, DnxBus::encodePacket(protocol, ID, DNX_INS_ACTION, NULL, 0, buf));
+	waitIdle();
+	read(buf, DNX_BUS_MAX_PACKET);
+	return 0;
+}
+
+
+/* ================================================= LINE ================================================= */
+
+/*  @ Notes:
+	The transmission starts once the line is free. Status packets are scheduled after the end of the instruction
+	packet and of any status packet before them
+*/
+void DnxHAL::write(const uint8_t* buf, int size){
+	uint8_t ID, instruction;
+	uint8_t params[DNX_BUS_MAX_PACKET];
+	int param_count, used;
+	int offset = 0;
+
+	double start = (line_free > clock) ? line_free : clock;
+	tx_end = start;
+	line_free = start;
+
+	while((used = DnxBus::decodePacket(protocol, buf + offset, size - offset, &ID, &instruction, params, &param_count)) > 0){
+		offset += used;
+		tx_end += used * byteTime();
+		packets++;
+		execute(ID, instruction, params, param_count);
+	}
+	tx_end += (size - offset) * byteTime(); 			// bytes that are not a valid packet still take the line
+
+	if(line_free < tx_end) line_free = tx_end;
+	bytes += size;
+	busy_time += line_free - start;
+}
+
+int DnxHAL::read(uint8_t* buf, int max_size){
+	if(status_next == status_count) return 0;
+
+	const SimStatus& packet = status[status_next++];
+	int size = (packet.size < max_size) ? packet.size : max_size;
+	waitUntil(packet.time);
+	memcpy(buf, packet.data, size);
+
+	if(status_next == status_count) status_next = status_count = 0;
+	return size;
+}
+
+bool DnxHAL::busy() const{
+	return clock < line_free;
+}
+
+void DnxHAL::waitIdle() const{
+	waitUntil(line_free);
+}
+
+
+/* ================================================= CLOCK ================================================= */
+
+double DnxHAL::now(){
+	return clock;
+}
+
+void DnxHAL::advance(double us){
+	clock += us;
+}
+
+void DnxHAL::waitUntil(double time_us){
+	if(time_us > clock) clock = time_us;
+}
+
+
+/* ================================================= STATISTICS ================================================= */
+
+double DnxHAL::busyTime() const{
+	return busy_time;
+}
+
+int DnxHAL::getBaud() const{
+	return baud;
+}
+
+void DnxHAL::printStats() const{
+	printf("DnxHAL simulation protocol %d at %d baud: %lu packets, %lu status packets, %lu bytes, line busy %.2f ms\n\r",
+		(int)protocol, baud, packets, status_packets, bytes, busy_time/1000.0);
+}
+
+
+/* ================================================= PRIVATE METHODS ================================================= */
+
+// Blocks like the libdnx call: until the packet is sent and the status packet, if any, is back
+int DnxHAL::writeRegister(int ID, int address, int value, bool registered/*=false*/){
+	uint8_t buf[DNX_BUS_MAX_PACKET];
+	uint8_t params[6];
+	int n = 0;
+
+	params[n++] = address & 0xFF;
+	if(protocol == DNX_PROTOCOL_2) params[n++] = (address >> 8) & 0xFF;
+	params[n++] = value & 0xFF;
+	if(registerSize(address) == 2) params[n++] = (value >> 8) & 0xFF;
+
+	write(buf, DnxBus::encodePacket(protocol, ID, registered ? DNX_INS_REG_WRITE : DNX_INS_WRITE_DATA, params, n, buf));
+	waitIdle();
+	read(buf, DNX_BUS_MAX_PACKET);
+	return 0;
+}
+
+int DnxHAL::readRegister(int ID, int address){
+	uint8_t buf[DNX_BUS_MAX_PACKET];
+	uint8_t params[4];
+	uint8_t data[2] = { 0, 0 };
+	uint8_t error;
+	int size = registerSize(address);
+	int n = 0;
+
+	params[n++] = address & 0xFF;
+	if(protocol == DNX_PROTOCOL_2) params[n++] = (address >> 8) & 0xFF;
+	params[n++] = size;
+	if(protocol == DNX_PROTOCOL_2) params[n++] = 0;
+
+	write(buf, DnxBus::encodePacket(protocol, ID, DNX_INS_READ_DATA, params, n, buf));
+	int received = read(buf, DNX_BUS_MAX_PACKET);
+	if(received == 0 || !DnxBus::decodeStatus(protocol, buf, received, ID, data, size, &error)){
+		advance(DNX_BUS_TIMEOUT_US);
+		return -1;
+	}
+	return data[0] | (data[1] << 8);
+}
+
+
+/*  @ Notes:
+	Broadcast WRITE_DATA, REG_WRITE and ACTION apply to every servo without an answer. SYNC_WRITE and SYNC_READ address
+	the servos listed in the parameters
+*/
+void DnxHAL::execute(uint8_t ID, uint8_t instruction, const uint8_t* params, int param_count){
+	int address_size = (protocol == DNX_PROTOCOL_1) ? 1 : 2;
+	int address = (param_count > 0) ? params[0] : 0;
+	if(protocol == DNX_PROTOCOL_2 && param_count > 1) address |= params[1] << 8;
+
+	if(instruction == DNX_INS_SYNC_WRITE || instruction == DNX_INS_SYNC_READ){
+		if(param_count < 2*address_size) return;
+		int length = (protocol == DNX_PROTOCOL_1) ? params[1] : (params[2] | (params[3] << 8));
+		int stride = (instruction == DNX_INS_SYNC_WRITE) ? 1 + length : 1;
+
+		for(int i=2*address_size; i + stride <= param_count; i += stride){
+			SimServo* target = servo(params[i]);
+			if(target == NULL) continue;
+			if(instruction == DNX_INS_SYNC_WRITE) 	writeTable(target, address, params + i + 1, length);
+			else if(address + length <= DNX_SIM_REGISTERS) 	answer(target, target->regs + address, length);
+		}
+		return;
+	}
+
+	int first = 0, last = 0;
+	if(ID == DNX_ID_BROADCAST) last = servo_count;
+	else{
+		SimServo* target = servo(ID);
+		if(target == NULL) return;
+		first = target - servos;
+		last = first + 1;
+	}
+
+	for(int i=first; i<last; i++){
+		SimServo* target = &servos[i];
+		const uint8_t* data = params + address_size;
+		int data_size = param_count - address_size;
+
+		switch(instruction){
+			case DNX_INS_PING:
+				if(protocol == DNX_PROTOCOL_1) 	answer(target, NULL, 0);
+				else 							answer(target, target->regs + controlTable(protocol).model, 3);
+				continue;
+			case DNX_INS_READ_DATA:
+				data_size = (protocol == DNX_PROTOCOL_1) ? params[1] : (params[2] | (params[3] << 8));
+				if(address + data_size <= DNX_SIM_REGISTERS) answer(target, target->regs + address, data_size);
+				continue;
+			case DNX_INS_WRITE_DATA:
+				writeTable(target, address, data, data_size);
+				break;
+			case DNX_INS_REG_WRITE:
+				memcpy(target->registered, params, param_count);
+				target->registered_size = param_count;
+				target->regs[controlTable(protocol).registered] = 1;
+				break;
+			case DNX_INS_ACTION:
+				if(target->regs[controlTable(protocol).registered] == 0) break;
+				address = target->registered[0];
+				if(protocol == DNX_PROTOCOL_2) address |= target->registered[1] << 8;
+				writeTable(target, address, target->registered + address_size, target->registered_size - address_size);
+				target->regs[controlTable(protocol).registered] = 0;
+				break;
+			default:
+				continue;
+		}
+		if(ID != DNX_ID_BROADCAST && answers(target, instruction)) answer(target, NULL, 0);
+	}
+}
+
+
+// A goal position is reached at once
+void DnxHAL::writeTable(SimServo* target, int address, const uint8_t* data, int size){
+	const SimControlTable& table = controlTable(protocol);
+	if(size <= 0 || address + size > DNX_SIM_REGISTERS) return;
+
+	memcpy(target->regs + address, data, size);
+	if(address <= table.goal_position + 1 && address + size > table.goal_position){
+		target->regs[table.present_position] 		= target->regs[table.goal_position];
+		target->regs[table.present_position + 1] 	= target->regs[table.goal_position + 1];
+	}
+	target->ID = target->regs[table.ID];
+}
+
+
+void DnxHAL::answer(SimServo* target, const uint8_t* data, int size){
+	uint8_t params[DNX_BUS_MAX_PACKET];
+
+	if(status_count == DNX_SIM_MAX_SERVOS || size + 1 > DNX_BUS_MAX_PACKET) return;
+	SimStatus& packet = status[status_count++];
+
+	if(protocol == DNX_PROTOCOL_1){
+		packet.size = DnxBus::encodePacket(protocol, target->ID, 0, data, size, packet.data);
+	}
+	else{
+		params[0] = 0; 								// no error
+		if(size > 0) memcpy(params + 1, data, size);
+		packet.size = DnxBus::encodePacket(protocol, target->ID, DNX_INS_STATUS, params, size + 1, packet.data);
+	}
+
+	double start = ((line_free > tx_end) ? line_free : tx_end) + 2.0*target->regs[controlTable(protocol).return_delay];
+	packet.time = start + packet.size * byteTime();
+	line_free = packet.time;
+
+	status_packets++;
+	bytes += packet.size;
+}
+
+
+// Status return level 0: only PING, 1: PING and READ, 2: all instructions
+bool DnxHAL::answers(const SimServo* target, uint8_t instruction) const{
+	int level = target->regs[controlTable(protocol).return_level];
+	if(instruction == DNX_INS_PING) return true;
+	if(instruction == DNX_INS_READ_DATA || instruction == DNX_INS_SYNC_READ) return level >= 1;
+	return level >= 2;
+}
+
+
+DnxHAL::SimServo* DnxHAL::servo(int ID){
+	const SimControlTable& table = controlTable(protocol);
+
+	for(int i=0; i<servo_count; i++){
+		if(servos[i].ID == ID) return &servos[i];
+	}
+	if(ID >= DNX_ID_BROADCAST || servo_count == DNX_SIM_MAX_SERVOS) return NULL;
+
+	SimServo& created = servos[servo_count++];
+	memset(&created, 0, sizeof(SimServo));
+	created.ID 								= ID;
+	created.regs[table.model] 				= table.model_number & 0xFF;
+	created.regs[table.model + 1] 			= (table.model_number >> 8) & 0xFF;
+	created.regs[table.ID] 					= ID;
+	created.regs[table.return_delay] 		= 250;
+	created.regs[table.return_level] 		= 2;
+	created.regs[table.goal_position + 1] 	= 2; 		// 512
+	created.regs[table.present_position + 1] = 2;
+	created.regs[table.present_voltage] 	= table.voltage;
+	created.regs[table.present_temperature] = 30;
+	return &created;
+}
+
+
+int DnxHAL::registerSize(int address) const{
+	const SimControlTable& table = controlTable(protocol);
+	for(int i=0; i<table.wide_count; i++){
+		if(table.wide[i] == address) return 2;
+	}
+	return 1;
+}
+
+
+// 1 start bit, 8 data bits, 1 stop bit
+double DnxHAL::byteTime() const{
+	return 10.0 * 1000000.0 / baud;
+}
+
+
+/* ================================================= WAIT ================================================= */
+
+void wait(float s){
+	DnxHAL::advance(s * 1000000.0);
+}
+
+void wait_ms(int ms){
+	DnxHAL::advance(ms * 1000.0);
+}
+
+void wait_us(int us){
+	DnxHAL::advance(us);
+}
+
+#endif
@@ -0,0 +1,144 @@
+/*
+
+DnxHAL Simulation Class: Timing-accurate model of a Dynamixel bus for the SIMULATION build
+===========================================================================================
+
+FUNCTIONALITY:
+	1. Stands in for the libdnx DnxHAL in SIMULATION. Has the same servo methods - each call encodes the real protocol
+		1.0/2.0 instruction packet, puts it on the simulated line and blocks until the status packet (if any) is back,
+		like the libdnx call does on the mbed
+	2. Also acts as the line of a DnxBus: write() takes any stream of instruction packets without blocking and read()
+		returns the status packets they produced
+	3. Models the servos behind the line: a control table per ID, status return level, return delay time, REG_WRITE/ACTION,
+		SYNC_WRITE and SYNC_READ (2.0). A goal position is reached at once
+	4. Accounts for time: 10 bits per byte at the configured baud, the return delay of the servo before every status
+		packet and the status packet itself. The simulated clock is advanced by wait() and by everything that blocks
+		on the line
+	5. Counts packets, status packets, bytes and the time the line was busy
+
+-------------------------------------------------------------------------------------------
+
+FRAMEWORK:
+	1. Compiled only in SIMULATION. ServoJoint.h and DnxBus.cpp include it instead of ../libdnx/DnxHAL.h
+	2. The clock is static - all simulated buses share it. now() is in microseconds
+	3. A servo exists as soon as a packet is addressed to it. Factory defaults: status return level 2, return delay
+		250 (500 us), 12.0 V on 1.0 buses and 7.4 V on 2.0 buses, 30 C
+	4. A transmission starts when the line is free. The line stays reserved until the last status packet it caused
+		has arrived, so a DnxBus packet never collides with a status packet
+	5. wait(), wait_ms() and wait_us() have the signatures of the mbed functions and advance the clock
+
+-------------------------------------------------------------------------------------------
+
+*/
+
+#ifndef SIMDNXHAL_H
+#define SIMDNXHAL_H
+
+#ifdef SIMULATION
+
+#include <stdint.h>
+
+#include "DnxBus.h"
+
+#define DNX_SIM_MAX_SERVOS 		32
+#define DNX_SIM_REGISTERS 		64 			// control table bytes modelled per servo
+
+#define DNX_INS_PING 			0x01
+
+
+class DnxHAL{
+
+public:
+
+	DnxHAL(DnxProtocol_t protocol_in, int baud_in);
+	~DnxHAL();
+
+	/* ------------------------------------ SERVO METHODS ----------------------------------- */
+
+	int setID(int ID, int newID);
+	int getValue(int ID, int address);
+	int setBaud(int ID, int rate);
+	int setReturnLevel(int ID, int lvl);
+	int setLED(int ID, int colour);
+	int setGoalPosition(int ID, int angle, bool cash=false);
+	int setGoalPosition(int ID, double angle, bool cash=false); 	// radians
+	int setGoalVelocity(int ID, int velocity);
+	int setGoalTorque(int ID, int torque);
+	int setPunch(int ID, int punch);
+	int action(int ID);
+
+	/* ------------------------------------ LINE ----------------------------------- */
+
+	void write(const uint8_t* buf, int size);		// Instruction packets; does not block
+	int read(uint8_t* buf, int max_size);			// Next status packet, waits for it; 0 if none is expected
+	bool busy() const;
+	void waitIdle() const;
+
+	/* ------------------------------------ CLOCK ----------------------------------- */
+
+	static double now();
+	static void advance(double us);
+	static void waitUntil(double time_us);
+
+	/* ------------------------------------ STATISTICS ----------------------------------- */
+
+	double busyTime() const;						// us
+	int getBaud() const;
+	void printStats() const;
+
+private:
+
+	struct SimServo{
+		int ID;
+		uint8_t regs[DNX_SIM_REGISTERS];
+		uint8_t registered[DNX_BUS_MAX_PACKET];	// parameters of the last REG_WRITE
+		int registered_size;
+	};
+
+	struct SimStatus{
+		uint8_t data[DNX_BUS_MAX_PACKET];
+		int size;
+		double time;								// arrival of the last byte
+	};
+
+	int writeRegister(int ID, int address, int value, bool registered=false);
+	int readRegister(int ID, int address);
+
+	void execute(uint8_t ID, uint8_t instruction, const uint8_t* params, int param_count);
+	void writeTable(SimServo* servo, int address, const uint8_t* data, int size);
+	void answer(SimServo* servo, const uint8_t* data, int size);
+	bool answers(const SimServo* servo, uint8_t instruction) const;
+
+	SimServo* servo(int ID);
+	int registerSize(int address) const;
+	double byteTime() const;
+
+	DnxProtocol_t protocol;
+	int baud;
+
+	SimServo servos[DNX_SIM_MAX_SERVOS];
+	int servo_count;
+
+	SimStatus status[DNX_SIM_MAX_SERVOS];			// status packets on their way back
+	int status_count;
+	int status_next;
+
+	double line_free;								// end of the last transmission incl. its status packets
+	double tx_end;									// end of the instruction packet being executed
+
+	unsigned long packets;
+	unsigned long status_packets;
+	unsigned long bytes;
+	double busy_time;
+
+	static double clock;
+};
+
+
+void wait(float s);
+void wait_ms(int ms);
+void wait_us(int us);
+
+#endif
+
+#endif
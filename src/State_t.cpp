@@ -12,9 +12,16 @@ LegAngles State_t::angle_limits_min(wkq::radians(150), wkq::radians(-(90-20)), w
 LegAngles State_t::default_pos_angles;
 DynamicVars State_t::default_pos_vars;
 bool State_t::default_pos_calculated = false;
-double State_t::max_step_size = 0;
-double State_t::max_rotation_angle = 0;
-double State_t::ef_raise = 3.0;
+wkq::real_t State_t::max_step_size = 0;
+wkq::real_t State_t::max_rotation_angle = 0;
+wkq::real_t State_t::ef_raise = 3.0;
+#ifdef LEG_BATCH
+LegBatch State_t::batch;
+#endif
+int State_t::batch_depth = 0;
+#ifdef IK_TABLES
+IKTables State_t::ik_tables;
+#endif
 
 
 /*  @ Notes:
@@ -26,6 +33,12 @@ State_t::State_t(double height_in, const BodyParams& robot_params) : /*servo_ang
     // Calculate defaultPoss only if not calculated already - note defaultPoss are static members for the class
     if(!default_pos_calculated){
         default_pos_calculated = true;
+#ifdef LEG_BATCH
+        batch.setParams(params);
+#endif
+#ifdef IK_TABLES
+        ik_tables.build(params);
+#endif
 
         // Find defaultPos servo_angles for Hip and Knee. Automatically computes the state and sets the height
         centerLeg(height_in);
@@ -97,86 +110,86 @@ void State_t::legFlatten(){
 /* ================================================= MAINTAINING LEG STATE ================================================= */
 
 /*  @ Notes:
-    Update the specified memeber of vars and automatically compute the related vars that change
+    Typed updates of vars. Each setter assigns one variable and its square/root pair, derives the dependent vars
+    directly and calls configureAngles() once. Setters taking both value and value_sq are used when the caller 
+    already computed both, so no pow()/sqrt() is repeated
 */
-void State_t::updateVar(double* address, double value, bool update_state /*=true*/){
-    *address = value;
-
-    if     (address == &(vars.height))               vars.height_sq = pow(value, 2);
-    else if(address == &(vars.height_sq))            vars.height = sqrt(value);
-    else if(address == &(vars.ef_center))            vars.ef_center_sq = pow(value, 2);
-    else if(address == &(vars.ef_center_sq))         vars.ef_center = sqrt(value);
-#ifdef DOF3    
-    else if(address == &(vars.hip_to_end))           vars.hip_to_end_sq = pow(value, 2);
-    else if(address == &(vars.hip_to_end_sq))        vars.hip_to_end = sqrt(value);
-    else if(address == &(vars.arm_ground_to_ef))     vars.arm_ground_to_ef_sq = pow(value, 2);
-    else if(address == &(vars.arm_ground_to_ef_sq))  vars.arm_ground_to_ef = sqrt(value);
-#else
-    else if(address == &(vars.hip_ground_to_ef))     vars.hip_ground_to_ef_sq = pow(value, 2);
-    else if(address == &(vars.hip_ground_to_ef_sq))  vars.hip_ground_to_ef = sqrt(value);
-    /*
-        FILL IN
-    */
+void State_t::setHeight(wkq::real_t height){
+    vars.height = height;
+    vars.height_sq = height*height;
+#ifdef DOF3
+    // Only ef_center and hip_to_end affected. arm_ground_to_ef is not affected by height change
+    resolveHipToEnd();
+    vars.ef_center = vars.arm_ground_to_ef + params.DIST_CENTER;
+    vars.ef_center_sq = vars.ef_center*vars.ef_center;
 #endif
-    else                                             printf("ERROR in State_t::updateVar\n\r");
+    configureAngles();
+}
 
-    if(update_state) update(address);  
+#ifdef DOF3
+// Assumed that change is in END EFFECTOR and only arm_ground_to_ef is affected
+void State_t::setHipToEnd(wkq::real_t hip_to_end){
+    vars.hip_to_end = hip_to_end;
+    vars.hip_to_end_sq = hip_to_end*hip_to_end;
+    resolveArmGroundToEf();
+    configureAngles();
 }
 
+void State_t::setHipToEndSq(wkq::real_t hip_to_end_sq){
+    vars.hip_to_end_sq = hip_to_end_sq;
+    vars.hip_to_end = wkq::math::sqrt(hip_to_end_sq);
+    resolveArmGroundToEf();
+    configureAngles();
+}
 
-void State_t::updateVar(double* address, double value, double* address_sq, double value_sq){
-    *address = value;
-    *address_sq = value_sq;
-    update(address);    
+// Only hip_to_end is affected
+void State_t::setArmGroundToEf(wkq::real_t arm_ground_to_ef, wkq::real_t arm_ground_to_ef_sq){
+    vars.arm_ground_to_ef = arm_ground_to_ef;
+    vars.arm_ground_to_ef_sq = arm_ground_to_ef_sq;
+    resolveHipToEnd();
+    configureAngles();
 }
 
+void State_t::setArmGroundToEfSq(wkq::real_t arm_ground_to_ef_sq){
+    setArmGroundToEf(wkq::math::sqrt(arm_ground_to_ef_sq), arm_ground_to_ef_sq);
+}
 
-void State_t::update(double* address){
-#ifdef DOF3
-    if(address == &(vars.hip_to_end))
-        // Assumed that change is in END EFFECTOR and only arm_ground_to_ef is affected
-        updateVar(&vars.arm_ground_to_ef, sqrt(vars.hip_to_end_sq - vars.height_sq) + params.COXA, false);
-    
-    else if(address == &(vars.arm_ground_to_ef))
-        // Only hip_to_end is affected
-        updateVar(&vars.hip_to_end_sq, pow((vars.arm_ground_to_ef - params.COXA),2) + vars.height_sq, false);
-    
-    else if(address == &(vars.height)){
-        // Only ef_center and hip_to_end affected. arm_ground_to_ef is not affected by height change
-        vars.hip_to_end_sq = pow((vars.arm_ground_to_ef - params.COXA),2) + vars.height_sq;
-        vars.hip_to_end = sqrt(vars.hip_to_end_sq); 
-        
-        vars.ef_center = vars.arm_ground_to_ef + params.DIST_CENTER;
-        vars.ef_center_sq = pow(vars.ef_center, 2); 
+void State_t::resolveHipToEnd(){
+    wkq::real_t arm_to_ef = vars.arm_ground_to_ef - params.COXA;
+    vars.hip_to_end_sq = arm_to_ef*arm_to_ef + vars.height_sq;
+    vars.hip_to_end = wkq::math::sqrt(vars.hip_to_end_sq); 
+}
 
-    }
-    
-    else printf("ERROR in State_t::update\n\r");
+void State_t::resolveArmGroundToEf(){
+    vars.arm_ground_to_ef = wkq::math::sqrt(vars.hip_to_end_sq - vars.height_sq) + params.COXA;
+    vars.arm_ground_to_ef_sq = vars.arm_ground_to_ef*vars.arm_ground_to_ef;
+}
 
-    // All parameters that can be changed require the update of HIP and KNEE servo_angles
-    configureAngles();         
 #else
-    /*
-        FILL IN
-        
-        FIX - put condition for when height is updated
-    */
-
-    // All parameters that can be changed require the update of HIP and KNEE servo_angles
-    configureAngles();         
-#endif
+/*  @ Notes:
+    In DOF2 no other var depends on hip_ground_to_ef, so only the angles are recomputed
+*/
+void State_t::setHipGroundToEf(wkq::real_t hip_ground_to_ef, wkq::real_t hip_ground_to_ef_sq){
+    vars.hip_ground_to_ef = hip_ground_to_ef;
+    vars.hip_ground_to_ef_sq = hip_ground_to_ef_sq;
+    configureAngles();
+}
+
+void State_t::setHipGroundToEfSq(wkq::real_t hip_ground_to_ef_sq){
+    setHipGroundToEf(wkq::math::sqrt(hip_ground_to_ef_sq), hip_ground_to_ef_sq);
 }
+#endif
 
 
 #ifdef DOF3
-void State_t::setAngles(double knee, double hip, double arm){
+void State_t::setAngles(wkq::real_t knee, wkq::real_t hip, wkq::real_t arm){
     servo_angles.knee = knee;
     servo_angles.hip = hip;
     servo_angles.arm = arm;
     configureVars();
 }
 #else
-void State_t::setAngles(double knee, double hip){
+void State_t::setAngles(wkq::real_t knee, wkq::real_t hip){
     servo_angles.knee = knee;
     servo_angles.hip = hip;
     configureVars();
@@ -188,24 +201,24 @@ void State_t::setAngles(double knee, double hip){
     height should be 0.0 when the current vars.height should be used; if this variable has not been set to a meaningful value, 
     the height that needs to be used should be passed as parameter - configureEFVars() will set the value in StateVar[HEIGHT]
 */
-void State_t::centerLeg(double height /*=0.0*/){
+void State_t::centerLeg(wkq::real_t height /*=0.0*/){
 
-    if(height == 0.0) height = vars.height;
+    if(height == 0) height = vars.height;
     if      (height < params.MIN_HEIGHT) height = params.MIN_HEIGHT;
     else if (height > params.MAX_HEIGHT) height = params.MAX_HEIGHT;
 
-#ifdef DOF3
+#if defined(IK_TABLES) && defined(DOF3)
     servo_angles.arm = 0.0;
-    servo_angles.hip = asin( (height - params.TIBIA) / params.FEMUR );
-    servo_angles.knee = wkq::PI/2 - servo_angles.hip;
-
-    configureVars(height);          // Update vars - needs to be passed the same argument
-#else
+    servo_angles.hip = ik_tables.center_hip.lookup(height);
+    servo_angles.knee = wkq::real_t(wkq::PI/2) - servo_angles.hip;
+#elif defined(IK_TABLES)
     servo_angles.hip = 0.0;
-    servo_angles.knee = wkq::PI/2 - acos( height / params.TIBIA);
+    servo_angles.knee = ik_tables.center_knee.lookup(height);
+#else
+    Kinematics<wkq::real_t>::centerAngles(params, height, servo_angles);
+#endif
 
     configureVars(height);          // Update vars - needs to be passed the same argument
-#endif
 }
 
 
@@ -214,23 +227,22 @@ void State_t::centerLeg(double height /*=0.0*/){
     DOF2 - Update servo_angles.knee based on the current vars
 */
 void State_t::configureAngles(){
-#ifdef DOF3
-    double knee_tmp, hip_tmp;
-
-    // Cosine Rule to find new Knee Servo Angle
-    knee_tmp = acos( (params.FEMUR_SQ + params.TIBIA_SQ - vars.hip_to_end_sq ) / ( 2 * params.FEMUR * params.TIBIA) );
-    // Convert to actual angle for the servo
-    servo_angles.knee = wkq::PI - knee_tmp;                                                 // Input valid for a LEFT LEG
+#ifdef LEG_BATCH
+    if(batch_depth > 0){
+        batch.queue(vars, &servo_angles);
+        return;
+    }
+#endif
 
-    // Cosine Rule to find new Hip Servo Angle
-    hip_tmp = acos( (params.FEMUR_SQ + vars.hip_to_end_sq - params.TIBIA_SQ ) / ( 2 * params.FEMUR * vars.hip_to_end) );
-    // Convert to actual angle for the servo
-    servo_angles.hip = (wkq::PI)/2 - hip_tmp - acos(vars.height/vars.hip_to_end);       // Input valid for a LEFT LEG
+#ifdef IK_TABLES
+#ifdef DOF3
+    servo_angles.knee = ik_tables.knee.lookup(vars.hip_to_end);
+    servo_angles.hip = ik_tables.hip.lookup(vars.hip_to_end) - ik_tables.acos_ratio.lookup(vars.height/vars.hip_to_end);
 #else
-    servo_angles.knee = wkq::PI/2 - asin((vars.hip_ground_to_ef - params.FEMUR) / params.TIBIA );
-    //servo_angles.knee = wkq::PI/2;
-    
-    //servo_angles.knee = wkq::PI/2 - acos( vars.height / params.TIBIA);        -- WRONG--
+    servo_angles.knee = ik_tables.knee.lookup(vars.hip_ground_to_ef);
+#endif
+#else
+    Kinematics<wkq::real_t>::configureAngles(params, vars, servo_angles);
 #endif
 }
 
@@ -242,47 +254,64 @@ void State_t::configureAngles(){
         - if not specified, it will be deduced based on servo_angles
         - if specified, vars.height will be updated and will be used for the computations
 */
-void State_t::configureVars(double height/*=0.0*/){
+void State_t::configureVars(wkq::real_t height/*=0.0*/){
+    using std::fabs;
+    const wkq::real_t pi = wkq::PI;
 #ifdef DOF3
-    double hip_to_end_sq, arm_ground_to_ef;
-    
-    if(height==0.0){
-        double knee_height = params.TIBIA*cos(wkq::PI/2 - fabs(servo_angles.hip) - (wkq::PI - servo_angles.knee) );
-        height = knee_height - params.FEMUR*sin(fabs(servo_angles.hip));
+    if(height==0){
+        wkq::real_t knee_height = params.TIBIA*wkq::math::cos(pi/2 - fabs(servo_angles.hip) - (pi - servo_angles.knee) );
+        height = knee_height - params.FEMUR*wkq::math::sin(fabs(servo_angles.hip));
     }
-    updateVar(&vars.height, height, false);                 // Update only HEIGHT
+    vars.height = height;
+    vars.height_sq = vars.height*vars.height;
     
-    hip_to_end_sq = pow(params.FEMUR,2) + pow(params.TIBIA,2) - 2*params.FEMUR*params.TIBIA*cos(wkq::PI - servo_angles.knee);
-    updateVar(&vars.hip_to_end_sq, hip_to_end_sq, false);       // Updates only hip_to_end
+    vars.hip_to_end_sq = params.FEMUR_SQ + params.TIBIA_SQ - 2*params.FEMUR*params.TIBIA*wkq::math::cos(pi - servo_angles.knee);
+    vars.hip_to_end = wkq::math::sqrt(vars.hip_to_end_sq);
 
-    arm_ground_to_ef = sqrt(vars.hip_to_end_sq - vars.height_sq) + params.COXA;
-    updateVar(&vars.arm_ground_to_ef, arm_ground_to_ef, false);     // Update only arm_ground_to_ef
+    resolveArmGroundToEf();
 
     // Note that servo_angles are already centered so ef_center will be fine
-    updateVar(&vars.ef_center, vars.arm_ground_to_ef + params.DIST_CENTER, false);
+    vars.ef_center = vars.arm_ground_to_ef + params.DIST_CENTER;
 #else
-    double hip_ground_to_ef;
-    
-    if(height==0.0) height = params.TIBIA * cos(wkq::PI/2 - servo_angles.knee);
-    updateVar(&vars.height, height, false);                 // Update only HEIGHT
+    if(height==0) height = params.TIBIA * wkq::math::cos(pi/2 - servo_angles.knee);
+    vars.height = height;
+    vars.height_sq = vars.height*vars.height;
 
-    hip_ground_to_ef = params.FEMUR + params.TIBIA * sin(wkq::PI/2 - servo_angles.knee);
-    updateVar(&vars.hip_ground_to_ef, hip_ground_to_ef, false);     // Update only hip_ground_to_ef
+    vars.hip_ground_to_ef = params.FEMUR + params.TIBIA * wkq::math::sin(pi/2 - servo_angles.knee);
+    vars.hip_ground_to_ef_sq = vars.hip_ground_to_ef*vars.hip_ground_to_ef;
     
     // Note that servo_angles are already set so ef_center that is computed is valid for this height
-    updateVar(&vars.ef_center, vars.hip_ground_to_ef + params.DIST_CENTER, false);
+    vars.ef_center = vars.hip_ground_to_ef + params.DIST_CENTER;
+#endif
+    vars.ef_center_sq = vars.ef_center*vars.ef_center;
+}
 
+
+
+void State_t::beginBatch(){
+    batch_depth++;
+}
+
+// Only the outermost endBatch() solves, so a Tripod movement inside a batch of the Robot joins it
+void State_t::endBatch(){
+    if(batch_depth == 0) return;
+    if(--batch_depth > 0) return;
+#ifdef LEG_BATCH
+    batch.solve();
 #endif
 }
 
+bool State_t::inBatch(){
+    return batch_depth > 0;
+}
 
 
 void State_t::clear(){
     vars =  -1.0;
 }
 
-double State_t::computeMaxStepSize(){
-    return 0.4 * (vars.ef_center / sqrt(3)); 
+wkq::real_t State_t::computeMaxStepSize(){
+    return wkq::real_t(0.4) * (vars.ef_center / wkq::math::sqrt(wkq::real_t(3))); 
 }
 
 /*
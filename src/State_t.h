@@ -33,12 +33,12 @@ FUNCTIONALITY:
 FRAMEWORK:
 	1. Algorithms work only for LEFT LEG. Values for RIGHT LEG are computed at the time of writing as opposite to Left Leg
 
-	2. vars[]		-	Use updateVar(). Function automatically updates square value for the variable
-							and the rest of the variables by calling StateUpdate()
-	3. updateVar() 		- 	When you use this to update hip_to_end it is assumed the change is in ENDEFFECTOR
-							rather than in the HEIGHT of the robot. If change is in the HEIGHT, the vars.height
-							will not be updates
-	4. configureAngles()	-	Function automatically called when updateVar() is called. Basing on vars[]
+	2. vars[]		-	Use the typed setters - setHeight(), setHipToEnd(), setArmGroundToEf(), setHipGroundToEf() and
+							their Sq versions. Each one updates the square value for the variable and the rest of the 
+							variables that depend on it
+	3. setHipToEnd() 	- 	It is assumed the change is in ENDEFFECTOR rather than in the HEIGHT of the robot. If change is
+							in the HEIGHT, the vars.height will not be updates
+	4. configureAngles()	-	Function automatically called once by every setter. Basing on vars[]
 							function computes new servo_angles for Hip and Knee
 	5. center()			-	Assumes Leg is already lifted up, otherwise robot will probably fall down
 	6. configureVars() 	- 	Used when state changes and new vars[] need to be computed. Computes all vars[] based on the current 
@@ -49,6 +49,20 @@ FRAMEWORK:
 							Calls configureEFVars automatically in order to keep state consistent
 	9. setAngles() 		- 	Should be called only on complete state change because automatically calls configureVars() and this
 							updates all vars, including ef_center
+	10. beginBatch() 	- 	Opens a batch that ends with the outermost endBatch(); the calls nest, so the Robot can open
+							one batch around the movements of both Tripods and write their angles once it ends. With
+							LEG_BATCH defined at build time (make LEG_BATCH=1) configureAngles() only queues the leg in
+							the shared LegBatch in between and endBatch() solves all queued legs in one kernel call, so
+							servo_angles.knee and servo_angles.hip must not be read before it. Without LEG_BATCH
+							configureAngles() solves at once and the batch only scopes the writes. The batch kernel is
+							opt-in because bin/bench does not show it cheaper than the per-leg path on the host
+	11. IK_TABLES 		- 	When defined at build time configureAngles() and centerLeg() use the interpolated IKTables
+							built from params[] instead of the exact computations. With LEG_BATCH, LegBatch runs the
+							same lookups
+	12. Kinematics 		- 	The exact equations live in the scalar-templated Kinematics core. vars[], servo_angles[] and
+							params[] are stored in wkq::real_t: double by default, float with SINGLE_PRECISION. The
+							State_t methods and the limits (max_step_size, max_rotation_angle, ef_raise) use the same
+							type, so a float build never promotes to double in between
 
 -------------------------------------------------------------------------------------------
 
@@ -60,6 +74,11 @@ FRAMEWORK:
 #include "wkq.h"
 #include <cmath>
 #include "robot_types.h"
+#include "LegBatch.h"
+#include "Kinematics.h"
+#ifdef IK_TABLES
+#include "IKTable.h"
+#endif
 #include <stddef.h>
 
 
@@ -82,18 +101,32 @@ public:
 
 	/* ------------------------------------ MAINTAINING LEG STATE ----------------------------------- */
 
-	void updateVar(double* address, double value, bool update_state=true);
-	void updateVar(double* address, double value, double* address_sq, double value_sq);
+	// Typed updates of vars[]: derive the square/root and the dependent vars once, then call configureAngles()
+	void setHeight(wkq::real_t height);
+#ifdef DOF3
+	void setHipToEnd(wkq::real_t hip_to_end);				// Change assumed to be in the END EFFECTOR - height is kept
+	void setHipToEndSq(wkq::real_t hip_to_end_sq);
+	void setArmGroundToEf(wkq::real_t arm_ground_to_ef, wkq::real_t arm_ground_to_ef_sq);
+	void setArmGroundToEfSq(wkq::real_t arm_ground_to_ef_sq);
+#else
+	void setHipGroundToEf(wkq::real_t hip_ground_to_ef, wkq::real_t hip_ground_to_ef_sq);
+	void setHipGroundToEfSq(wkq::real_t hip_ground_to_ef_sq);
+#endif
 
-	void centerLeg(double height =0.0); 					// Compute median HIP, KNEE based on params[] and HEIGHT/height. Calls configureEFVars()
+	void configureAngles();									// Update KNEE and HIP servo_angles basing on the current vars[]; called by every setter
+	void centerLeg(wkq::real_t height =0.0); 					// Compute median HIP, KNEE based on params[] and HEIGHT/height. Calls configureEFVars()
 	void clear();											// Clears vars[] - needed for flight-related actions
 	//void StateVerify();									// Verifies the current leg state is physically possible and accurate
 
+	static void beginBatch();								// Defer configureAngles() of all legs to the shared LegBatch
+	static void endBatch();									// Solve all deferred legs in a single kernel call
+	static bool inBatch();
+
 
 #ifdef DOF3
-	void setAngles(double knee, double hip, double arm);	// Calls configureVars()
+	void setAngles(wkq::real_t knee, wkq::real_t hip, wkq::real_t arm);	// Calls configureVars()
 #else
-	void setAngles(double knee, double hip);				// Calls configureVars()
+	void setAngles(wkq::real_t knee, wkq::real_t hip);		// Calls configureVars()
 #endif
 
 
@@ -108,21 +141,26 @@ public:
 	//static Leg_Joints 	angle_limits_max;				// Store max angle limits of the robot
 	//static Leg_Joints 	angle_limits_min;				// Store min angle limits of the robot
 
-	static double 			max_step_size;					// max_step_size that will be used by Robot - must be half of the actual input that is fed to Leg
-	static double 			max_rotation_angle;  			// max_rotation_angle that will be used by Robot - must be half of the actual input that is fed to Leg
-	static double 			ef_raise; 						// amount to raise the end effector by when lifting a leg
+	static wkq::real_t 		max_step_size;					// max_step_size that will be used by Robot - must be half of the actual input that is fed to Leg
+	static wkq::real_t 		max_rotation_angle;  			// max_rotation_angle that will be used by Robot - must be half of the actual input that is fed to Leg
+	static wkq::real_t 		ef_raise; 						// amount to raise the end effector by when lifting a leg
+#ifdef IK_TABLES
+	static IKTables 		ik_tables;						// Interpolated IK tables built from params[] on first construction
+#endif
 
 private:
 
 	/* ------------------------------------ MAINTAINING LEG STATE ----------------------------------- */
 
-	void update(double* address);							// Auto-invoked when any vars[] changes in order to keep leg state consistent
-	void configureAngles();									// Update KNEE and HIP servo_angles basing on the current hip_to_end and HEIGHT
+#ifdef DOF3
+	void resolveHipToEnd();									// hip_to_end from arm_ground_to_ef and height
+	void resolveArmGroundToEf();							// arm_ground_to_ef from hip_to_end and height
+#endif
 	//void configureEFVars(double height=0.0); 				// Compute hip_to_end, arm_ground_to_ef based on KNEE, HEIGHT/height; called by centerLeg()
 	//void configureVars();									// Computes valid vars basing on servo_angles
-	void configureVars(double height=0.0);					// Compute valid vars basing on servo_angles
+	void configureVars(wkq::real_t height=0.0);				// Compute valid vars basing on servo_angles
 
-	double computeMaxStepSize();
+	wkq::real_t computeMaxStepSize();
 
 	/* ------------------------------------ PRIVATE MEMBER DATA ------------------------------------ */
 	
@@ -130,6 +168,11 @@ private:
 	static DynamicVars		default_pos_vars; 				// Store default values for servo_angles[VAR_COUNT]
 
 	static bool 			default_pos_calculated;			// Needed to know whether to calculate defaultPoss
+
+#ifdef LEG_BATCH
+	static LegBatch 		batch;							// Shared kernel that solves the angles of all legs at once
+#endif
+	static int 				batch_depth;					// Nesting depth of beginBatch() - batch mode while > 0
 };
 
 
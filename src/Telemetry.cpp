@@ -0,0 +1,106 @@
+#include "Telemetry.h"
+
+#include <cstdio>
+#include "wkq.h"
+
+Telemetry::Telemetry() : count(0), update_count(0){}
+
+Telemetry::~Telemetry(){}
+
+
+void Telemetry::beginUpdate(){
+	update_count++;
+}
+
+void Telemetry::publish(const ServoTelemetry& servo){
+	ServoTelemetry* entry = find(servo.ID);
+	if(entry == NULL){
+		if(count == TELEMETRY_MAX_SERVOS){
+			printf("ERROR: Telemetry - too many servos, increase TELEMETRY_MAX_SERVOS\n\r");
+			return;
+		}
+		entry = &servos[count++];
+	}
+	*entry = servo;
+	entry->valid = true;
+	entry->update_count = update_count;
+}
+
+void Telemetry::fail(int ID){
+	ServoTelemetry* entry = find(ID);
+	if(entry == NULL){
+		if(count == TELEMETRY_MAX_SERVOS) return;
+		entry = &servos[count++];
+		entry->ID 			= ID;
+		entry->position 	= 0;
+		entry->load 		= 0;
+		entry->voltage 		= 0;
+		entry->temperature 	= 0;
+		entry->error 		= 0;
+	}
+	entry->valid = false;
+	entry->update_count = update_count;
+}
+
+
+const ServoTelemetry* Telemetry::get(int ID) const{
+	for(int i=0; i<count; i++){
+		if(servos[i].ID == ID) return &servos[i];
+	}
+	return NULL;
+}
+
+double Telemetry::position(int ID) const{
+	const ServoTelemetry* servo = get(ID);
+	if(servo == NULL || !servo->valid) return 0;
+	return wkq::radians((servo->position - 512) * 300.0/1024.0);
+}
+
+
+int Telemetry::maxTemperature() const{
+	int max_temperature = 0;
+	for(int i=0; i<count; i++){
+		if(servos[i].valid && servos[i].temperature > max_temperature) max_temperature = servos[i].temperature;
+	}
+	return max_temperature;
+}
+
+int Telemetry::minVoltage() const{
+	int min_voltage = 0;
+	for(int i=0; i<count; i++){
+		if(servos[i].valid && (min_voltage == 0 || servos[i].voltage < min_voltage)) min_voltage = servos[i].voltage;
+	}
+	return min_voltage;
+}
+
+int Telemetry::errorCount() const{
+	int errors = 0;
+	for(int i=0; i<count; i++){
+		if(servos[i].update_count == update_count && (!servos[i].valid || servos[i].error != 0)) errors++;
+	}
+	return errors;
+}
+
+
+unsigned long Telemetry::updates() const{
+	return update_count;
+}
+
+void Telemetry::print() const{
+	printf("\n\rTELEMETRY: pass %lu, max temperature %d C, min voltage %.1f V, %d errors\n\r", update_count,
+		maxTemperature(), minVoltage()/10.0, errorCount());
+	for(int i=0; i<count; i++){
+		const ServoTelemetry& servo = servos[i];
+		if(!servo.valid) printf("servo %2d: no answer\n\r", servo.ID);
+		else printf("servo %2d: position %4d load %5d voltage %.1f V temperature %d C error 0x%02X\n\r", servo.ID,
+			servo.position, servo.load, servo.voltage/10.0, servo.temperature, servo.error);
+	}
+}
+
+
+ServoTelemetry* Telemetry::find(int ID){
+	for(int i=0; i<count; i++){
+		if(servos[i].ID == ID) return &servos[i];
+	}
+	return NULL;
+}
@@ -0,0 +1,74 @@
+/*
+
+Telemetry Class: Snapshot of the state read back from all servos of the robot
+===========================================================================================
+
+FUNCTIONALITY:
+	1. Holds the last present position, load, voltage, temperature and error flags of every servo
+	2. Filled by DnxBus::readTelemetry(), which reads all servos of every bus in one transaction per bus. Queried by
+		Robot and Master without any bus traffic
+	3. Gives the extremes the Master cares about - hottest servo, lowest voltage, servos with errors
+
+-------------------------------------------------------------------------------------------
+
+FRAMEWORK:
+	1. Values are in the servo units: position in raw goal units (512 at the center, 1024 units over 300 degrees), load
+		in 0.1% of the max torque (positive counterclockwise), voltage in 0.1 V, temperature in degrees Celsius
+	2. A servo that did not answer keeps its last values with valid set to false
+	3. update_count is the number of the readTelemetry() pass the values come from, so that stale entries can be
+		recognized
+	4. Memory is static: TELEMETRY_MAX_SERVOS entries, looked up by ID
+
+-------------------------------------------------------------------------------------------
+
+*/
+
+#ifndef TELEMETRY_H
+#define TELEMETRY_H
+
+#include <stdint.h>
+
+#define TELEMETRY_MAX_SERVOS 	24
+
+struct ServoTelemetry{
+	int ID;
+	int position;
+	int load;
+	int voltage;
+	int temperature;
+	uint8_t error;						// error byte of the status packet
+	bool valid;
+	unsigned long update_count;
+};
+
+
+class Telemetry{
+
+public:
+	Telemetry();
+	~Telemetry();
+
+	void beginUpdate();									// Start of a readTelemetry() pass
+	void publish(const ServoTelemetry& servo);
+	void fail(int ID);									// servo did not answer in this pass
+
+	const ServoTelemetry* get(int ID) const; 			// NULL if the servo was never read
+	double position(int ID) const;						// radians; 0 if unknown
+
+	int maxTemperature() const;
+	int minVoltage() const;
+	int errorCount() const;								// servos with an error or no answer in the last pass
+
+	unsigned long updates() const;
+	void print() const;
+
+private:
+
+	ServoTelemetry* find(int ID);
+
+	ServoTelemetry servos[TELEMETRY_MAX_SERVOS];
+	int count;
+	unsigned long update_count;
+};
+
+#endif
@@ -0,0 +1,76 @@
+#include "Trace.h"
+
+#ifdef SIMULATION
+#include "SimDnxHAL.h"
+#endif
+
+// Initialize static variables
+mbed::CircularBuffer<TraceRecord, TRACE_BUFFER_SIZE> Trace::buffer;
+bool Trace::enabled = true;
+unsigned long Trace::dropped_ = 0;
+
+static const char* event_names[TR_EVENT_COUNT] = { "?", "goal", "unchanged", "velocity", "SYNC_WRITE", "REG_WRITE", "ACTION", "READ", "setpoint" };
+
+
+void Trace::log(TraceEvent_t event, int ID, int value){
+	if(!enabled) return;
+
+	TraceRecord record;
+	record.event 	= event;
+	record.ID 		= ID;
+	record.value 	= value;
+
+#ifndef SIMULATION
+	record.time 	= us_ticker_read();
+	__disable_irq();
+	if(buffer.full()) dropped_++;
+	buffer.push(record);
+	__enable_irq();
+#else
+	record.time 	= (uint32_t)DnxHAL::now();
+	if(buffer.full()) drain();
+	buffer.push(record);
+#endif
+}
+
+
+void Trace::drain(){
+	TraceRecord record;
+	while(buffer.pop(record)) decode(record);
+}
+
+void Trace::dump(FILE* stream){
+	TraceRecord record;
+	while(buffer.pop(record)) fwrite(&record, sizeof(TraceRecord), 1, stream);
+}
+
+
+/*  @ Notes:
+	Servo values are printed raw and in degrees of the goal position
+*/
+void Trace::decode(const TraceRecord& record){
+	const char* name = (record.event < TR_EVENT_COUNT) ? event_names[record.event] : event_names[0];
+
+	switch(record.event){
+		case TR_GOAL_POSITION:
+		case TR_GOAL_SUPPRESSED:
+		case TR_SETPOINT:
+			printf("%10lu servo %2d %-10s %4d (%.2f deg)\n\r", (unsigned long)record.time, record.ID, name, record.value,
+				(record.value - 512) * 300.0/1024.0);
+			break;
+		case TR_GOAL_VELOCITY:
+			printf("%10lu servo %2d %-10s %4d\n\r", (unsigned long)record.time, record.ID, name, record.value);
+			break;
+		default:
+			printf("%10lu bus P%d   %-10s %4d\n\r", (unsigned long)record.time, record.ID, name, record.value);
+	}
+}
+
+
+void Trace::enable(bool enabled_in){
+	enabled = enabled_in;
+}
+
+unsigned long Trace::dropped(){
+	return dropped_;
+}
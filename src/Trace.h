@@ -0,0 +1,87 @@
+/*
+
+Trace Class: Binary ring buffer of fixed-size trace records for the servo hot path
+===========================================================================================
+
+FUNCTIONALITY:
+	1. log() stores one 8 byte TraceRecord - timestamp, servo or bus ID, raw value and event code - in a ring buffer
+		built on mbed::CircularBuffer. No formatting and no I/O, so it can be called on every servo write
+	2. drain() pops the records and prints them decoded. Called from the background (e.g. the main loop between
+		movements) on the mbed and after every step of the simulation on the host
+	3. dump() writes the records as they are in memory, for decoding on the host when the serial port is too slow
+		for the text form
+	4. Counts the records lost because the buffer was full
+
+-------------------------------------------------------------------------------------------
+
+FRAMEWORK:
+	1. All methods are static - there is one trace for the whole program
+	2. Timestamps are us_ticker_read() microseconds on the mbed and microseconds of the simulated clock of
+		SimDnxHAL.h in SIMULATION
+	3. On the mbed a full buffer overwrites the oldest record (CircularBuffer::push()). In SIMULATION the buffer is
+		drained when it fills instead, so that no record is lost on the host
+	4. log() disables the interrupts around the push on the mbed, so records can also be logged from an ISR. drain()
+		and dump() must be called from the main context
+	5. Servo goal values are stored raw (0-1023, 512 at the center, 1024 units over 300 degrees)
+
+-------------------------------------------------------------------------------------------
+
+*/
+
+#ifndef TRACE_H
+#define TRACE_H
+
+#include <stdint.h>
+#include <cstdio>
+
+#ifndef SIMULATION
+#include "mbed.h"
+#include "CircularBuffer.h"
+#include "us_ticker_api.h"
+#else
+#include "../mbed/CircularBuffer.h"
+#endif
+
+#define TRACE_BUFFER_SIZE 		256 		// records, 2 KB
+
+enum TraceEvent_t{
+	TR_GOAL_POSITION 	= 1, 		// goal position sent or queued; ID = servo, value = raw goal
+	TR_GOAL_SUPPRESSED 	= 2, 		// goal position not sent, unchanged; ID = servo, value = raw goal
+	TR_GOAL_VELOCITY 	= 3, 		// ID = servo, value = raw moving speed
+	TR_BUS_SYNC_WRITE 	= 4, 		// ID = bus protocol, value = servos in the packet
+	TR_BUS_REG_WRITE 	= 5, 		// ID = bus protocol, value = servos staged
+	TR_BUS_ACTION 		= 6, 		// ID = bus protocol
+	TR_BUS_READ 		= 7, 		// ID = bus protocol, value = servos that answered
+	TR_SETPOINT 		= 8, 		// interpolated goal position of a SetpointStream; ID = servo, value = raw goal
+	TR_EVENT_COUNT 		= 9
+};
+
+struct TraceRecord{
+	uint32_t time;
+	uint8_t event;
+	uint8_t ID;
+	int16_t value;
+};
+
+
+class Trace{
+
+public:
+
+	static void log(TraceEvent_t event, int ID, int value);
+
+	static void drain();								// Print and remove all records
+	static void dump(FILE* stream);						// Write and remove all records in binary
+	static void decode(const TraceRecord& record); 		// Print a single record
+
+	static void enable(bool enabled_in);
+	static unsigned long dropped();					// records overwritten since the start
+
+private:
+
+	static mbed::CircularBuffer<TraceRecord, TRACE_BUFFER_SIZE> buffer;
+	static bool enabled;
+	static unsigned long dropped_;
+};
+
+#endif
@@ -3,13 +3,13 @@
 const double Tripod::leg_lift = 10.0; 
 
 #ifdef DOF3
-Tripod::Tripod (int ID_front_knee, int ID_middle_knee, int ID_back_knee, unordered_map<int, DnxHAL*>& servo_map, double height_in, const BodyParams& robot_params) :
+Tripod::Tripod (int ID_front_knee, int ID_middle_knee, int ID_back_knee, ServoMap& servo_map, double height_in, const BodyParams& robot_params) :
 	legs{	Leg(ID_front_knee, 	ID_front_knee+6, 	ID_front_knee+18, 	servo_map, height_in, robot_params),
 			Leg(ID_middle_knee, ID_middle_knee+6, 	ID_middle_knee+18, 	servo_map, height_in, robot_params),
 			Leg(ID_back_knee, 	ID_back_knee+6, 	ID_back_knee+18, 	servo_map, height_in, robot_params)
 		} {}
 #else
-Tripod::Tripod (int ID_front_knee, int ID_middle_knee, int ID_back_knee, unordered_map<int, DnxHAL*>& servo_map, double height_in, const BodyParams& robot_params) :
+Tripod::Tripod (int ID_front_knee, int ID_middle_knee, int ID_back_knee, ServoMap& servo_map, double height_in, const BodyParams& robot_params) :
 	legs{	Leg(ID_front_knee, 	ID_front_knee+6, 	servo_map, height_in, robot_params),
 			Leg(ID_middle_knee, ID_middle_knee+6, 	servo_map, height_in, robot_params),
 			Leg(ID_back_knee, 	ID_back_knee+6, 	servo_map, height_in, robot_params)
@@ -30,12 +30,14 @@ void Tripod::setPosition(wkq::RobotState_t robot_state){
 
 void Tripod::center(){
 	liftUp(leg_lift);
+	DnxBus::beginSync();
 	for(int i=0; i<LEG_COUNT; i++){
 		if(i==0) legs[i].setPosition(wkq::RS_CENTERED);
 		// All legs have same center positions so save computations by copying states
 		else legs[i].copyState(legs[0]);
 		legs[i].writeAngles();
 	}
+	DnxBus::endSync();
 }
 
 /* ================================================= WALKING MOVEMENTS ================================================= */
@@ -81,6 +83,39 @@ void Tripod::finishStepRectangularGait(){
 	setPosition(wkq::RS_RECTANGULAR);
 }
 
+/* ================================================= VELOCITY MOVEMENTS ================================================= */
+
+void Tripod::bodyVelocity(double velocity, double dt){
+	if(debug_) printf("\n\rTripod: bodyVelocity\n\r");
+
+	State_t::beginBatch();
+	for(int i=0; i<LEG_COUNT; i++){
+		legs[i].bodyVelocity(velocity, dt);
+	}
+	State_t::endBatch();
+	if(State_t::inBatch()) return; 		// The owner of the batch writes once it is solved
+	// Velocities are written first, the goal positions follow in one SYNC_WRITE per bus
+	DnxBus::beginSync();
+	writeVelocities();
+	writeAngles();
+	DnxBus::endSync();
+}
+
+void Tripod::writeVelocities(){
+	for(int i=0; i<LEG_COUNT; i++){
+		legs[i].writeVelocities();
+	}
+}
+
+// Only the servos whose speed was changed are written, in one SYNC_WRITE per bus
+void Tripod::restoreVelocities(){
+	DnxBus::beginSync();
+	for(int i=0; i<LEG_COUNT; i++){
+		legs[i].restoreVelocities();
+	}
+	DnxBus::endSync();
+}
+
 /* ================================================= RAISE AND LOWER ================================================= */
 
 void Tripod::raiseBody(double hraise){
@@ -100,6 +135,25 @@ void Tripod::copyState(const Tripod& tripod_in){
 	writeAngles();
 }
 
+void Tripod::saveState(TripodSnapshot& snapshot) const{
+	for(int i=0; i<LEG_COUNT; i++){
+		legs[i].saveState(snapshot.legs[i]);
+	}
+}
+
+void Tripod::replay(const TripodSnapshot& snapshot){
+	if(debug_) printf("\n\rTripod: replay\n\r");
+	for(int i=0; i<LEG_COUNT; i++){
+		legs[i].loadState(snapshot.legs[i]);
+	}
+	writeAngles();
+}
+
+// All Legs are constructed with the same parameters
+const BodyParams& Tripod::getParams() const{
+	return legs[0].getParams();
+}
+
 
 
 /* ================================================= PRIVATE FUNCTIONALITY ================================================= */
@@ -108,16 +162,21 @@ void Tripod::copyState(const Tripod& tripod_in){
 void Tripod::makeMovement(void (Leg::*leg_action)(double), double arg, const string debug_msg /*=""*/ ){
 	if(debug_msg!="" && debug_) printf("\n\r%s\n\r", debug_msg.c_str());
 	
+	State_t::beginBatch();
 	for(int i=0; i<LEG_COUNT; i++){
 		(legs[i].*leg_action)(arg);
 	}
-	writeAngles();
+	State_t::endBatch();				// With LEG_BATCH solves the angles of all legs in a single kernel call
+	if(!State_t::inBatch()) writeAngles(); 		// Otherwise the owner of the batch writes once it is solved
 }
 
+// All goal positions of the Tripod go in a single SYNC_WRITE per bus
 void Tripod::writeAngles(){
+	DnxBus::beginSync();
 	for(int i=0; i<LEG_COUNT; i++){
 		legs[i].writeAngles();
 	}
+	DnxBus::endSync();
 }
 
 
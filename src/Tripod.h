@@ -20,6 +20,9 @@ FRAMEWORK:
 		OR IT IS RELATED TO THE OTHER TRIPOD AND TO THE ROBOT ITSELF
 	2. ALWAYS THINK ABOUT WHAT COMPUTATIONS DOES THE CALLED FUNCTION PERFORM - IF THE RESULTING STATE OF EACH LEG
 		IS THE SAME, DO COMPUTATIONS FOR FIRST LEG AND USE copyState()
+	3. The movements run their legs in one State_t batch - one LegBatch kernel call with LEG_BATCH. Inside a batch
+		opened by the caller (e.g. Robot::gaitBody() for both Tripods) they do not write to the servos - the caller
+		calls writeAngles()/writeVelocities() after State_t::endBatch()
 
 -------------------------------------------------------------------------------------------
 
@@ -38,13 +41,21 @@ using wkq::RobotState_t;
 #define LEG_COUNT	3
 
 
+struct TripodSnapshot{
+	LegSnapshot legs[LEG_COUNT];
+};
+
+
 class Tripod{
 
 public:
-	Tripod(int ID_front_knee, int ID_middle_knee, int ID_back_knee, unordered_map<int, DnxHAL*>& servo_map, double height_in, const BodyParams& robot_params);
+	Tripod(int ID_front_knee, int ID_middle_knee, int ID_back_knee, ServoMap& servo_map, double height_in, const BodyParams& robot_params);
 	~Tripod ();
 
 	void copyState(const Tripod& tripod_in);
+	void saveState(TripodSnapshot& snapshot) const;
+	void replay(const TripodSnapshot& snapshot); 		// Load a stored state in all Legs and write it to the servos
+	const BodyParams& getParams() const;
 
 	/* ------------------------------------ STATIC POSITIONS ----------------------------------- */
 
@@ -70,10 +81,19 @@ public:
 
 	void raiseBody(double hraise);
 
+	/* ------------------------------------ VELOCITY MOVEMENTS ----------------------------------- */
+
+	void bodyVelocity(double velocity, double dt); 	// Move the body forward at velocity for dt; servo speeds from the Leg Jacobians
+
+	/* ------------------------------------ WRITING TO THE SERVOS ----------------------------------- */
+
+	void writeAngles();
+	void writeVelocities(); 			// Servo speeds computed by the last bodyVelocity()
+	void restoreVelocities(); 			// Default servo speeds once the velocity commands are over
+
 private:
 	void makeMovement(void (Leg::*leg_action)(double), double arg, const string debug_msg=""); 		// Wrapper for calling a function from Leg that makes any moevement
 
-	void writeAngles();
 	void writeHipKneeAngles();
 
 	template<typename MemberFnPtr, typename FnArg>
@@ -84,7 +104,7 @@ private:
 
 	static const double leg_lift;
 
-	bool debug_ = true;
+	bool debug_ = false;
 };
 
 
@@ -0,0 +1,123 @@
+#include "fixed_math.h"
+
+#define FX_CORDIC_ITERATIONS 	30
+#define FX_SIN_TABLE_SHIFT 		22 			// 30 bits per quarter wave - log2(FX_SIN_TABLE_SIZE)
+
+static q31_t sin_table[FX_SIN_TABLE_SIZE + 1]; 				// sin() over [0, PI/2], last entry is sin(PI/2)
+static q31_t atan_table[FX_CORDIC_ITERATIONS];				// atan(2^-i) as q31 angles
+static bool initialized = false;
+
+
+void wkq::fx::init(){
+	if(initialized) return;
+	initialized = true;
+
+	for(int i=0; i<=FX_SIN_TABLE_SIZE; i++){
+		sin_table[i] = saturate((q63_t)(::sin(i * wkq::PI/2 / FX_SIN_TABLE_SIZE) * 2147483648.0));
+	}
+	for(int i=0; i<FX_CORDIC_ITERATIONS; i++){
+		atan_table[i] = (q31_t)(::atan(::pow(2.0, -i)) / wkq::PI * 2147483648.0);
+	}
+}
+
+
+/*  @ Notes:
+	sqrt(x / 2^31) * 2^31 = isqrt(x * 2^31), computed bit by bit on 64 bits
+*/
+q31_t wkq::fx::sqrt(q31_t x){
+	if(x <= 0) return 0;
+
+	uint64_t op = (uint64_t)x << 31;
+	uint64_t res = 0;
+	uint64_t one = (uint64_t)1 << 62;
+
+	while(one > op) one >>= 2;
+	while(one != 0){
+		if(op >= res + one){
+			op -= res + one;
+			res = (res >> 1) + one;
+		}
+		else res >>= 1;
+		one >>= 2;
+	}
+	return saturate(res);
+}
+
+
+// pos is the offset inside a quarter wave: [0, 2^30]
+static inline q31_t quarterSin(uint32_t pos){
+	uint32_t idx = pos >> FX_SIN_TABLE_SHIFT;
+	if(idx >= FX_SIN_TABLE_SIZE) return sin_table[FX_SIN_TABLE_SIZE];
+
+	int32_t frac = pos & ((1 << FX_SIN_TABLE_SHIFT) - 1);
+	q31_t delta = sin_table[idx+1] - sin_table[idx];
+	return sin_table[idx] + (q31_t)(((q63_t)delta * frac) >> FX_SIN_TABLE_SHIFT);
+}
+
+q31_t wkq::fx::sin(q31_t angle){
+	uint32_t u = (uint32_t)angle;
+	uint32_t quadrant = u >> 30;
+	uint32_t pos = u & 0x3FFFFFFF;
+
+	switch(quadrant){
+		case 0: 	return quarterSin(pos);
+		case 1: 	return quarterSin(0x40000000 - pos);
+		case 2: 	return -quarterSin(pos);
+		default: 	return -quarterSin(0x40000000 - pos);
+	}
+}
+
+q31_t wkq::fx::cos(q31_t angle){
+	return sin(add(angle, ANGLE_PI_2));
+}
+
+
+/*  @ Notes:
+	CORDIC in vectoring mode. Inputs are pre-scaled by 1/4 to leave room for the CORDIC gain (1.647)
+	Vectors in the left half plane are first rotated by -+PI/2 so that the iterations converge
+*/
+q31_t wkq::fx::atan2(q31_t y, q31_t x){
+	if(x == 0 && y == 0) return 0;
+
+	int32_t xs = x >> 2;
+	int32_t ys = y >> 2;
+	q31_t angle = 0;
+
+	if(xs < 0){
+		int32_t tmp = xs;
+		if(ys >= 0){
+			xs = ys;
+			ys = -tmp;
+			angle = ANGLE_PI_2;
+		}
+		else{
+			xs = -ys;
+			ys = tmp;
+			angle = -ANGLE_PI_2;
+		}
+	}
+
+	for(int i=0; i<FX_CORDIC_ITERATIONS; i++){
+		int32_t xn;
+		if(ys > 0){
+			xn = xs + (ys >> i);
+			ys = ys - (xs >> i);
+			angle = add(angle, atan_table[i]);
+		}
+		else{
+			xn = xs - (ys >> i);
+			ys = ys + (xs >> i);
+			angle = sub(angle, atan_table[i]);
+		}
+		xs = xn;
+	}
+	return angle;
+}
+
+q31_t wkq::fx::asin(q31_t x){
+	return atan2(x, sqrt(Q31_MAX - mul(x, x)));
+}
+
+q31_t wkq::fx::acos(q31_t x){
+	return atan2(sqrt(Q31_MAX - mul(x, x)), x);
+}
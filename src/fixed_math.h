@@ -0,0 +1,122 @@
+/*
+
+Fixed-Point Math
+===========================================================================================
+
+	Q31 arithmetic behind the transcendental functions of the Q16.16 Fixed type (see Fixed.h and bin/precision).
+	Integer-only equivalents of the soft-float double routines of the FPU-less Cortex-M3. Only the math is integer:
+	the conversions from and to double below are floating point
+
+-------------------------------------------------------------------------------------------
+
+FRAMEWORK:
+	1. Types are the CMSIS q31_t/q15_t from arm_math.h. On the host the same typedefs are provided here
+	2. Lengths 		- 	q31 value v represents v * FX_LENGTH_SCALE cm. Squared lengths use the same representation,
+						i.e. mul(a, a) is the square of a in units of FX_LENGTH_SCALE^2
+	3. Angles 		- 	q31 value v represents v * PI radians, same as CMSIS arm_sin_cos_q31(). Addition and
+						subtraction therefore wrap modulo 2*PI - always use add() and sub() on angles
+	4. Ratios 		- 	Results of div() are plain q31 fractions, saturated to [-1, 1)
+	5. sin()/cos() 	- 	Quarter-wave table of FX_SIN_TABLE_SIZE intervals with linear interpolation, max error ~5e-6
+	6. atan2() 		- 	CORDIC in vectoring mode. asin()/acos() are computed through atan2() and sqrt()
+	7. init() 		- 	Must be called once before sin()/cos(); the Fixed functions do this on every call
+	8. The CMSIS-DSP library (arm_sin_cos_q31, arm_sqrt_q31) is not linked by the mbed export, so the same functionality
+		is implemented here on top of the header types only
+
+-------------------------------------------------------------------------------------------
+
+*/
+
+#ifndef FIXED_MATH_H
+#define FIXED_MATH_H
+
+#include <stdint.h>
+#include "wkq.h"
+
+#ifndef SIMULATION
+#include "cmsis.h"
+#include "arm_math.h"
+#undef PI 									// arm_math.h defines PI as a macro, which would break wkq::PI
+#else
+typedef int16_t q15_t;
+typedef int32_t q31_t;
+typedef int64_t q63_t;
+#endif
+
+#define FX_SIN_TABLE_SIZE 	256
+
+namespace wkq{
+namespace fx{
+
+	const double FX_LENGTH_SCALE = 128.0; 				// cm represented by q31 1.0
+
+	const q31_t Q31_MAX 	= 0x7FFFFFFF;
+	const q31_t Q31_MIN 	= (q31_t)0x80000000;
+	const q31_t ANGLE_PI 	= Q31_MIN; 					// -PI and PI are the same angle
+	const q31_t ANGLE_PI_2 	= 0x40000000;
+
+	void init();
+
+	/* ------------------------------------------------- CONVERSIONS ------------------------------------------------- */
+
+	inline q31_t saturate(q63_t value){
+		if(value > Q31_MAX) return Q31_MAX;
+		if(value < Q31_MIN) return Q31_MIN;
+		return (q31_t)value;
+	}
+
+	// Scale factors are powers of two or folded into one constant: one multiplication per conversion
+	inline q31_t fromLength(double cm){
+		return saturate((q63_t)(cm * (2147483648.0 / FX_LENGTH_SCALE)));
+	}
+
+	inline double toLength(q31_t value){
+		return value * (FX_LENGTH_SCALE / 2147483648.0);
+	}
+
+	inline double toLengthSq(q31_t value){
+		return value * (FX_LENGTH_SCALE * FX_LENGTH_SCALE / 2147483648.0);
+	}
+
+	inline q31_t fromAngle(double rad){
+		// Wrap through int64 so that angles outside [-PI, PI) map to the equivalent angle
+		return (q31_t)(uint32_t)(int64_t)(rad * (2147483648.0 / wkq::PI));
+	}
+
+	inline double toAngle(q31_t value){
+		return value * (wkq::PI / 2147483648.0);
+	}
+
+	/* ------------------------------------------------- ARITHMETIC ------------------------------------------------- */
+
+	// Wrapping addition and subtraction - the right operations for angles
+	inline q31_t add(q31_t a, q31_t b){
+		return (q31_t)((uint32_t)a + (uint32_t)b);
+	}
+
+	inline q31_t sub(q31_t a, q31_t b){
+		return (q31_t)((uint32_t)a - (uint32_t)b);
+	}
+
+	inline q31_t mul(q31_t a, q31_t b){
+		return (q31_t)(((q63_t)a * b) >> 31);
+	}
+
+	// a / b as a q31 fraction, saturated. Division by zero saturates in the direction of a
+	inline q31_t div(q31_t a, q31_t b){
+		if(b == 0) return (a >= 0) ? Q31_MAX : Q31_MIN;
+		return saturate(((q63_t)a << 31) / b);
+	}
+
+	/* ------------------------------------------------- TRANSCENDENTALS ------------------------------------------------- */
+
+	q31_t sqrt(q31_t x); 								// Negative input returns 0
+	q31_t sin(q31_t angle);
+	q31_t cos(q31_t angle);
+	q31_t atan2(q31_t y, q31_t x);						// Angle in [-PI, PI)
+	q31_t asin(q31_t x);								// Angle in [-PI/2, PI/2]
+	q31_t acos(q31_t x);								// Angle in [0, PI), PI saturates to -PI
+
+}
+}
+
+#endif
@@ -1,6 +1,8 @@
 #include "robot_types.h"
+#include "Fixed.h"
 
-void LegAngles::operator=(const LegAngles& obj_in){
+template<typename T>
+void LegAnglesT<T>::operator=(const LegAnglesT& obj_in){
     if( this != &obj_in){
         this->knee  = obj_in.knee;
         this->hip   = obj_in.hip;
@@ -11,7 +13,8 @@ void LegAngles::operator=(const LegAngles& obj_in){
 }
 
 
-void LegAngles::operator=(double value){
+template<typename T>
+void LegAnglesT<T>::operator=(T value){
     knee    = value;
     hip     = value;
 #ifdef DOF3
@@ -19,15 +22,17 @@ void LegAngles::operator=(double value){
 #endif
 }
 
-void LegAngles::print(){
-    printf("LegAngles: knee(degrees) %f\n\r", wkq::degrees(knee));
-    printf("LegAngles: hip(degrees) %f\n\r", wkq::degrees(hip));
+template<typename T>
+void LegAnglesT<T>::print(){
+    printf("LegAngles: knee(degrees) %f\n\r", wkq::degrees((double)knee));
+    printf("LegAngles: hip(degrees) %f\n\r", wkq::degrees((double)hip));
 #ifdef DOF3
-    printf("LegAngles: arm(degrees) %f\n\r", wkq::degrees(arm));
+    printf("LegAngles: arm(degrees) %f\n\r", wkq::degrees((double)arm));
 #endif
 }
 
-void DynamicVars::operator=(const DynamicVars& obj_in){
+template<typename T>
+void DynamicVarsT<T>::operator=(const DynamicVarsT& obj_in){
     if( this != &obj_in){
         this->height                = obj_in.height;
         this->height_sq             = obj_in.height_sq;
@@ -46,7 +51,8 @@ void DynamicVars::operator=(const DynamicVars& obj_in){
 }
 
 
-void DynamicVars::operator=(double value){
+template<typename T>
+void DynamicVarsT<T>::operator=(T value){
     height              = value;
     height_sq           = value;
 #ifdef DOF3
@@ -59,18 +65,28 @@ void DynamicVars::operator=(double value){
 #endif
 }
 
-void DynamicVars::print(){
-    printf("DynamicVars: height %f\n\r", height);                          
-    printf("DynamicVars: height_sq %f\n\r", height_sq);
-    printf("DynamicVars: ef_center %f\n\r", ef_center);                       
-    printf("DynamicVars: ef_center_sq %f\n\r", ef_center_sq);
+template<typename T>
+void DynamicVarsT<T>::print(){
+    printf("DynamicVars: height %f\n\r", (double)height);                          
+    printf("DynamicVars: height_sq %f\n\r", (double)height_sq);
+    printf("DynamicVars: ef_center %f\n\r", (double)ef_center);                       
+    printf("DynamicVars: ef_center_sq %f\n\r", (double)ef_center_sq);
 #ifdef DOF3
-    printf("DynamicVars: hip_to_end %f\n\r", hip_to_end);                      
-    printf("DynamicVars: hip_to_end_sq %f\n\r", hip_to_end_sq);
-    printf("DynamicVars: arm_ground_to_ef %f\n\r", arm_ground_to_ef);                
-    printf("DynamicVars: arm_ground_to_ef_sq %f\n\r", arm_ground_to_ef_sq);
+    printf("DynamicVars: hip_to_end %f\n\r", (double)hip_to_end);                      
+    printf("DynamicVars: hip_to_end_sq %f\n\r", (double)hip_to_end_sq);
+    printf("DynamicVars: arm_ground_to_ef %f\n\r", (double)arm_ground_to_ef);                
+    printf("DynamicVars: arm_ground_to_ef_sq %f\n\r", (double)arm_ground_to_ef_sq);
 #else
-    printf("DynamicVars: hip_ground_to_ef %f\n\r", hip_ground_to_ef);                
-    printf("DynamicVars: hip_ground_to_ef_sq %f\n\r", hip_ground_to_ef_sq);
+    printf("DynamicVars: hip_ground_to_ef %f\n\r", (double)hip_ground_to_ef);                
+    printf("DynamicVars: hip_ground_to_ef_sq %f\n\r", (double)hip_ground_to_ef_sq);
 #endif
 }
+
+
+// Scalar types used by the firmware, bin/sim and the precision benchmark
+template struct LegAnglesT<double>;
+template struct LegAnglesT<float>;
+template struct LegAnglesT<wkq::Fixed>;
+template struct DynamicVarsT<double>;
+template struct DynamicVarsT<float>;
+template struct DynamicVarsT<wkq::Fixed>;
@@ -6,92 +6,129 @@
 #include "ServoJoint.h"
 #include "wkq.h"
 
-struct BodyParams{
+/*
+    @ BodyParams, DynamicVars and LegAngles are templated on the scalar type for the Kinematics core. The rest of the 
+    code uses the wkq::real_t instantiations through the typedefs below
+*/
+template<typename T>
+struct BodyParamsT{
 
 #ifdef DOF3
-    double COXA;
-    double COXA_SQ;
+    T COXA;
+    T COXA_SQ;
 #endif
-    double FEMUR;
-    double FEMUR_SQ;
-    double TIBIA;
-    double TIBIA_SQ;
-    double DIST_CENTER;                 // Direct distance from the center of the robot to the mounting point of a leg - center of arm or center of hip depending on configuration
-    double DIST_CENTER_SQ;
-    double KNEE_TO_MOTOR_DIST;          // Distance from the knee to the brushless DC motor
-    double KNEE_TO_MOTOR_DIST_SQ;
-    //double KNEE_TO_TIBIA;               // Distance from the knee to the point where tibia starts
-    //double KNEE_TO_TIBIA_SQ;
+    T FEMUR;
+    T FEMUR_SQ;
+    T TIBIA;
+    T TIBIA_SQ;
+    T DIST_CENTER;                      // Direct distance from the center of the robot to the mounting point of a leg - center of arm or center of hip depending on configuration
+    T DIST_CENTER_SQ;
+    T KNEE_TO_MOTOR_DIST;               // Distance from the knee to the brushless DC motor
+    T KNEE_TO_MOTOR_DIST_SQ;
+    //T KNEE_TO_TIBIA;                    // Distance from the knee to the point where tibia starts
+    //T KNEE_TO_TIBIA_SQ;
 
-    double MAX_HEIGHT;
-    double MIN_HEIGHT;
+    T MAX_HEIGHT;
+    T MIN_HEIGHT;
 
 
     void compute_squares(){
 #ifdef DOF3
-        COXA_SQ = pow(COXA, 2);
+        COXA_SQ = COXA*COXA;
 #endif        
-        FEMUR_SQ = pow(FEMUR, 2);
-        TIBIA_SQ = pow(TIBIA, 2);
-        DIST_CENTER_SQ = pow(DIST_CENTER, 2);
-        KNEE_TO_MOTOR_DIST_SQ = pow(KNEE_TO_MOTOR_DIST, 2);
+        FEMUR_SQ = FEMUR*FEMUR;
+        TIBIA_SQ = TIBIA*TIBIA;
+        DIST_CENTER_SQ = DIST_CENTER*DIST_CENTER;
+        KNEE_TO_MOTOR_DIST_SQ = KNEE_TO_MOTOR_DIST*KNEE_TO_MOTOR_DIST;
+    }
+
+    // Copy the parameters of another scalar instantiation
+    template<typename U>
+    void convert(const BodyParamsT<U>& params_in){
+#ifdef DOF3
+        COXA                = T((double)params_in.COXA);
+#endif
+        FEMUR               = T((double)params_in.FEMUR);
+        TIBIA               = T((double)params_in.TIBIA);
+        DIST_CENTER         = T((double)params_in.DIST_CENTER);
+        KNEE_TO_MOTOR_DIST  = T((double)params_in.KNEE_TO_MOTOR_DIST);
+        MAX_HEIGHT          = T((double)params_in.MAX_HEIGHT);
+        MIN_HEIGHT          = T((double)params_in.MIN_HEIGHT);
+        compute_squares();
     }
 };
 
+typedef BodyParamsT<wkq::real_t> BodyParams;
+
 
 /*
-    @ Remember to update State_t::updateVar and State_t::update if you add or remove any members
+    @ Remember to update the State_t setters and State_t::configureVars if you add or remove any members
 */
-struct DynamicVars{
+template<typename T>
+struct DynamicVarsT{
 
     void print();
-    void operator=(const DynamicVars& obj_in);
-    void operator=(double value);
+    void operator=(const DynamicVarsT& obj_in);
+    void operator=(T value);
 
-    double height;                          // Vertical distance from hip mount point to ground
-    double height_sq;
-    double ef_center;                       // Distance from End Effector to robot center for centered leg
-    double ef_center_sq;
+    T height;                               // Vertical distance from hip mount point to ground
+    T height_sq;
+    T ef_center;                            // Distance from End Effector to robot center for centered leg
+    T ef_center_sq;
 #ifdef DOF3
-    double hip_to_end;                      // Direct distance from hip mount point to the point where the end effector touches ground
-    double hip_to_end_sq;
-    double arm_ground_to_ef;                // Distance from arm ground projection to end effector
-    double arm_ground_to_ef_sq;
+    T hip_to_end;                           // Direct distance from hip mount point to the point where the end effector touches ground
+    T hip_to_end_sq;
+    T arm_ground_to_ef;                     // Distance from arm ground projection to end effector
+    T arm_ground_to_ef_sq;
 #else
-    double hip_ground_to_ef;                // Distance from the ground projection of the hip mount point to the end effector
-    double hip_ground_to_ef_sq;
-    //double center_ground_to_ef;             // Direct distance from the center ground projection to the end effector
-    //double height;                          // Height of the robot center as it stays invariant
-    //double hip_ground_to_ef;                // Distance from the hip ground projection to the end_effector  
+    T hip_ground_to_ef;                     // Distance from the ground projection of the hip mount point to the end effector
+    T hip_ground_to_ef_sq;
+    //T center_ground_to_ef;                  // Direct distance from the center ground projection to the end effector
+    //T height;                               // Height of the robot center as it stays invariant
+    //T hip_ground_to_ef;                     // Distance from the hip ground projection to the end_effector  
 #endif
 };  
 
+typedef DynamicVarsT<wkq::real_t> DynamicVars;
+
 
 /*  @Configuration:
         - with 3 DOF  there are arm, hip and knee joints
         - with 2 DOF  there hip and knee joints
 */
-struct LegAngles{
+template<typename T>
+struct LegAnglesT{
     
     void print();
-    void operator=(const LegAngles& obj_in);
-    void operator=(double value);
+    void operator=(const LegAnglesT& obj_in);
+    void operator=(T value);
   
-    double knee;
-    double hip;
+    T knee;
+    T hip;
 #ifdef DOF3
-    double arm;
+    T arm;
 #endif
 };
 
+typedef LegAnglesT<wkq::real_t> LegAngles;
+
+
+/*
+    Kinematic state of a Leg - everything State_t needs apart from the constant params
+*/
+struct LegSnapshot{
+    LegAngles angles;
+    DynamicVars vars;
+};
+
 
 struct LegJoints{
 
 #ifdef DOF3
-    LegJoints(int ID_knee, int ID_hip, int ID_arm, unordered_map<int, DnxHAL*>& servo_map) :
+    LegJoints(int ID_knee, int ID_hip, int ID_arm, ServoMap& servo_map) :
         knee(ID_knee, servo_map), hip(ID_hip, servo_map), arm(ID_arm, servo_map) {}
 #else    
-    LegJoints(int ID_knee, int ID_hip, unordered_map<int, DnxHAL*>& servo_map) :
+    LegJoints(int ID_knee, int ID_hip, ServoMap& servo_map) :
         knee(ID_knee, servo_map), hip(ID_hip, servo_map) {}
 #endif
 
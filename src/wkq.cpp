@@ -1,75 +1,98 @@
+
 #include "wkq.h"
+#include "Fixed.h"
 
 
-wkq::Point::Point(double x_in, double y_in) : x(x_in), y(y_in) {
-	update_polar_coord();
-}
+template<typename T>
+wkq::PointT<T>::PointT(T x_in, T y_in) : x(x_in), y(y_in), polar_valid(false) {}
 
-wkq::Point::Point(const Point& p_in) : x(p_in.x), y(p_in.y) {
-	update_polar_coord();
-}
+template<typename T>
+wkq::PointT<T>::PointT(const Vec2T<T>& v_in) : x(v_in.x), y(v_in.y), polar_valid(false) {}
 
-//wkq::Point::Point() : x(0.0), y(0.0) {}
-//wkq::Point::Point(double x_in, double y_in, double mag_in, double arg_in) : mag(mag_in), arg(arg_in) {}
+// Copies the polar cache as well, so a copy of a point whose polar form is known does not recompute it
+template<typename T>
+wkq::PointT<T>::PointT(const PointT& p_in) : x(p_in.x), y(p_in.y), mag(p_in.mag), arg(p_in.arg), polar_valid(p_in.polar_valid) {}
 
-wkq::Point::~Point(){}
+//template<typename T>
+//wkq::PointT<T>::PointT() : x(0.0), y(0.0) {}
+//wkq::PointT<T>::PointT(T x_in, T y_in, T mag_in, T arg_in) : mag(mag_in), arg(arg_in) {}
 
+template<typename T>
+wkq::PointT<T>::~PointT(){}
 
 
-double wkq::Point::origin_dist() const{
-	return sqrt(x*x + y*y);
+
+template<typename T>
+T wkq::PointT<T>::origin_dist() const{
+	return math::sqrt(x*x + y*y);
 }
 
-double wkq::Point::dist(const Point& p_in) const{
-	return sqrt(dist_sq(p_in));
+template<typename T>
+T wkq::PointT<T>::dist(const PointT& p_in) const{
+	return math::sqrt(dist_sq(p_in));
 }
 
-double wkq::Point::dist_sq(const Point& p_in) const{
-	return pow((x-p_in.x),2) + pow((y-p_in.y),2);
+template<typename T>
+T wkq::PointT<T>::dist_sq(const PointT& p_in) const{
+	return (x-p_in.x)*(x-p_in.x) + (y-p_in.y)*(y-p_in.y);
 }
 
-double wkq::Point::line_arg(const Point& p_in){
+template<typename T>
+T wkq::PointT<T>::line_arg(const PointT& p_in){
 	//return atan( (p_in.y - y) / (p_in.x - x) );
-	return atan2( p_in.y - y, p_in.x - x );
+	return math::atan2( p_in.y - y, p_in.x - x );
 }
 
 
-void wkq::Point::translate_y(double delta_y){
+template<typename T>
+void wkq::PointT<T>::translate_y(T delta_y){
 	y += delta_y;
-	update_polar_coord();
+	polar_valid = false;
 }
 
-void wkq::Point::translate_x(double delta_x){
+template<typename T>
+void wkq::PointT<T>::translate_x(T delta_x){
 	x += delta_x;
-	update_polar_coord();
+	polar_valid = false;
 }
 
-void wkq::Point::translate(const Point& p2){
+template<typename T>
+void wkq::PointT<T>::translate(const PointT& p2){
 	x += p2.x;
 	y += p2.y;
-	update_polar_coord();
+	polar_valid = false;
 }
 
 
-void wkq::Point::rotate(double delta_arg){
+template<typename T>
+void wkq::PointT<T>::rotate(T delta_arg){
+	if(!polar_valid) update_polar_coord();
 	arg -= delta_arg;
 	//arg += delta_arg;
 	update_rect_coord();
 }
 
 
-void wkq::Point::update_rect_coord(){
-	x = mag * cos(arg);
-	y = mag * sin(arg);
+template<typename T>
+void wkq::PointT<T>::update_rect_coord(){
+	x = mag * math::cos(arg);
+	y = mag * math::sin(arg);
 }
 
-void wkq::Point::update_polar_coord(){
+template<typename T>
+void wkq::PointT<T>::update_polar_coord() const{
 	//arg = atan(y/x);
-	arg = atan2(y, x);
-	mag = sqrt(y*y + x*x);
+	arg = math::atan2(y, x);
+	mag = math::sqrt(y*y + x*x);
+	polar_valid = true;
 }
 
 
+// Scalar types used by the firmware, bin/sim and the precision benchmark
+template struct wkq::PointT<double>;
+template struct wkq::PointT<float>;
+template struct wkq::PointT<wkq::Fixed>;
+
 
 
 /*
@@ -97,7 +120,3 @@ bool operator==(const Point& p1, const Point& p2){
 	return (p1.x==p2.x)&&(p1.y==p2.y);
 }
 */
-
-
-
-
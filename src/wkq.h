@@ -13,6 +13,7 @@ Walking Quadcopter Namespace
 #define WKQ_NAMESPACE_H
 
 #include <cmath>
+#include "MathStats.h"
 
 namespace wkq{
 
@@ -20,6 +21,14 @@ namespace wkq{
 
 	const double PI = 3.14159265358979323846264338327950288419716939937510;
 
+	/* 	Scalar type of the geometry core: BodyParams, DynamicVars, LegAngles, Point and the Kinematics algorithms.
+		double by default (and always in bin/sim unless requested); make SINGLE_PRECISION=1 selects float */
+#ifdef SINGLE_PRECISION
+	typedef float real_t;
+#else
+	typedef double real_t;
+#endif
+
 	inline double radians(double degrees){	
 		return degrees/180.0*wkq::PI; 
 	}
@@ -129,6 +138,7 @@ namespace wkq{
 		RM_RECTANGULAR_GAIT 	= 1,
 		RM_ROTATION_HEXAPOD 	= 2,
 		RM_ROTATION_RECTANGULAR = 3,
+		RM_HEXAPOD_GAIT_VELOCITY = 4, 			// RM_HEXAPOD_GAIT with the body moved by continuous velocity commands
 
 
 		/*RM_BODY_FORWARD 		= 0,
@@ -157,66 +167,146 @@ namespace wkq{
 	}; 
 
 
+/* ------------------------------------------------- VECTOR ------------------------------------------------- */ 
+
+	/* 	Plain 2D vector for purely Cartesian math. POD - no constructors, no cached state, brace-initialize it:
+		wkq::Vec2 v = { x, y }. Only polar() and line_arg() call transcendental functions */
+	template<typename T>
+	struct Vec2T{
+		T x;
+		T y;
+	};
+
+	typedef Vec2T<real_t> Vec2;
+
+	template<typename T>
+	inline Vec2T<T> operator+(const Vec2T<T>& a, const Vec2T<T>& b){
+		Vec2T<T> out = { a.x + b.x, a.y + b.y };
+		return out;
+	}
+	template<typename T>
+	inline Vec2T<T> operator-(const Vec2T<T>& a, const Vec2T<T>& b){
+		Vec2T<T> out = { a.x - b.x, a.y - b.y };
+		return out;
+	}
+	template<typename T>
+	inline Vec2T<T> operator*(T k, const Vec2T<T>& a){
+		Vec2T<T> out = { k * a.x, k * a.y };
+		return out;
+	}
+
+	template<typename T>
+	inline T dot(const Vec2T<T>& a, const Vec2T<T>& b){
+		return a.x*b.x + a.y*b.y;
+	}
+	template<typename T>
+	inline T norm_sq(const Vec2T<T>& a){
+		return a.x*a.x + a.y*a.y;
+	}
+	template<typename T>
+	inline T dist_sq(const Vec2T<T>& a, const Vec2T<T>& b){
+		return norm_sq(b - a);
+	}
+
+	// Vector of magnitude mag at angle arg from the X-axis
+	template<typename T>
+	inline Vec2T<T> polar(T mag, T arg){
+		using namespace std;
+		Vec2T<T> out = { mag * math::cos(arg), mag * math::sin(arg) };
+		return out;
+	}
+
+	// Angle of the line from a to b relative to the X-axis
+	template<typename T>
+	inline T line_arg(const Vec2T<T>& a, const Vec2T<T>& b){
+		using namespace std;
+		return math::atan2(b.y - a.y, b.x - a.x);
+	}
+
+
 /* ------------------------------------------------- POINT ------------------------------------------------- */ 
 
-	struct Point{
+	/* 	Templated on the scalar type. Definitions are in wkq.cpp and instantiated for double, float and wkq::Fixed 
+		Polar coordinates are computed lazily - only when get_mag(), get_arg() or rotate() need them. Cartesian 
+		operations just mark them stale. Use Vec2 when the polar form is never read */
+	template<typename T>
+	struct PointT{
+
+		PointT();
+		//PointT(T x_in, T y_in, T mod_in, T arg_in);
+		PointT(T x_in, T y_in);
+		PointT(const Vec2T<T>& v_in);
+		PointT(const PointT& p_in);
+		~PointT();
 
-		Point();
-		//Point(double x_in, double y_in, double mod_in, double arg_in);
-		Point(double x_in, double y_in);
-		Point(const Point& p_in);
-		~Point();
+		PointT& operator=(const PointT& p_in) = default;
 
 		// Getters		
-		inline double get_x() const;
-		inline double get_y() const;
-		inline double get_mag() const;
-		inline double get_arg() const;
+		inline T get_x() const;
+		inline T get_y() const;
+		inline T get_mag() const;
+		inline T get_arg() const;
+		inline Vec2T<T> get_vec() const;
 		
-		double origin_dist() const;
-		double dist(const Point& p_in) const;
-		double dist_sq(const Point& p_in) const;
-		double line_arg(const Point& p_in);
+		T origin_dist() const;
+		T dist(const PointT& p_in) const;
+		T dist_sq(const PointT& p_in) const;
+		T line_arg(const PointT& p_in);
 
-		void translate_y(double delta_y);
-		void translate_x(double delta_x);
-		void translate(const Point& p2);
+		void translate_y(T delta_y);
+		void translate_x(T delta_x);
+		void translate(const PointT& p2);
 
-		void rotate(double delta_arg);
+		void rotate(T delta_arg);
 		
 	
-		//void set_arg(double arg_in);
-		//void set_mag(double mag_in);
+		//void set_arg(T arg_in);
+		//void set_mag(T mag_in);
 	/*
-		friend bool operator<(const Point& p1, const Point& p2);
-		friend bool operator==(const Point& p1, const Point& p2);
+		friend bool operator<(const PointT& p1, const PointT& p2);
+		friend bool operator==(const PointT& p1, const PointT& p2);
 	*/
 
 	private:
 
 		void update_rect_coord();
-		void update_polar_coord();
+		void update_polar_coord() const;
 
-		double x = 0;
-		double y = 0;
+		T x = 0.0;
+		T y = 0.0;
 
-		double mag = 0;
-		double arg = 0;
+		// Polar cache - valid only when polar_valid is set
+		mutable T mag = 0.0;
+		mutable T arg = 0.0;
+		mutable bool polar_valid = true;
 	};
 
+	typedef PointT<real_t> Point;
 
-	double Point::get_x() const{
+
+	template<typename T>
+	T PointT<T>::get_x() const{
 		return x;
 	}
-	double Point::get_y() const{
+	template<typename T>
+	T PointT<T>::get_y() const{
 		return y;
 	}
-	double Point::get_arg() const{
+	template<typename T>
+	T PointT<T>::get_arg() const{
+		if(!polar_valid) update_polar_coord();
 		return arg;
 	}
-	double Point::get_mag() const{
+	template<typename T>
+	T PointT<T>::get_mag() const{
+		if(!polar_valid) update_polar_coord();
 		return mag;
 	}
+	template<typename T>
+	Vec2T<T> PointT<T>::get_vec() const{
+		Vec2T<T> out = { x, y };
+		return out;
+	}
 
 
 